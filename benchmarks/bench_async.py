@@ -0,0 +1,59 @@
+#! /usr/bin/env python3
+# -*- coding: utf-8 -*-
+
+# Copyright (C) 2012 Deepin, Inc.
+# 
+# This program is free software: you can redistribute it and/or modify
+# it under the terms of the GNU General Public License as published by
+# the Free Software Foundation, either version 3 of the License, or
+# any later version.
+# 
+# This program is distributed in the hope that it will be useful,
+# but WITHOUT ANY WARRANTY; without even the implied warranty of
+# MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+# GNU General Public License for more details.
+# 
+# You should have received a copy of the GNU General Public License
+# along with this program.  If not, see <http://www.gnu.org/licenses/>.
+'''
+Writes from an event loop thread: blocking set_int against set_value_async,
+as time spent in the caller and as time until the backend has everything.
+Takes the backend as its argument, memory by default.
+'''
+
+from __future__ import print_function
+
+import sys
+import time
+
+import common
+
+deepin_gsettings = common.setup(sys.argv[1] if len(sys.argv) > 1 else "memory")
+
+COUNT = 2000
+
+settings = deepin_gsettings.new(common.SCHEMA_ID)
+
+def blocking():
+    start = time.time()
+    for i in range(COUNT):
+        settings.set_int("count", i)
+    elapsed = time.time() - start
+    return elapsed, elapsed
+
+def queued():
+    start = time.time()
+    futures = [settings.set_value_async("count", i) for i in range(COUNT)]
+    caller = time.time() - start
+    for future in futures:
+        future.result()
+    return caller, time.time() - start
+
+def run(name, func):
+    caller, done = func()
+    print("%-30s caller %8.2f us/write   all written %8.2f ms" %
+          (name, caller / COUNT * 1e6, done * 1e3))
+
+if __name__ == "__main__":
+    run("set_int", blocking)
+    run("set_value_async", queued)
@@ -0,0 +1,72 @@
+#! /usr/bin/env python3
+# -*- coding: utf-8 -*-
+
+# Copyright (C) 2012 Deepin, Inc.
+# 
+# This program is free software: you can redistribute it and/or modify
+# it under the terms of the GNU General Public License as published by
+# the Free Software Foundation, either version 3 of the License, or
+# any later version.
+# 
+# This program is distributed in the hope that it will be useful,
+# but WITHOUT ANY WARRANTY; without even the implied warranty of
+# MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+# GNU General Public License for more details.
+# 
+# You should have received a copy of the GNU General Public License
+# along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+'''
+A profile switch writing 30 keys: one set_int per key, set_many() and
+a batch() block, plus how many "changed" and "change-event" callbacks
+each of them costs.
+'''
+
+from __future__ import print_function
+
+import common
+
+deepin_gsettings = common.setup()
+
+KEYS = ["profile-%d" % i for i in range(30)]
+COUNT = 200
+
+settings = deepin_gsettings.new(common.SCHEMA_ID)
+calls = {"changed": 0, "change-event": 0}
+
+def on_changed(key):
+    calls["changed"] += 1
+
+def on_change_event(keys):
+    calls["change-event"] += 1
+
+settings.connect("changed", on_changed)
+settings.connect("change-event", on_change_event)
+
+def per_key_loop(value=[0]):
+    value[0] += 1
+    for key in KEYS:
+        settings.set_int(key, value[0])
+
+def set_many(value=[0]):
+    value[0] += 1
+    settings.set_many(dict.fromkeys(KEYS, value[0]))
+
+def batch(value=[0]):
+    value[0] += 1
+    with settings.batch():
+        for key in KEYS:
+            settings.set_int(key, value[0])
+
+def run(name, func):
+    calls["changed"] = calls["change-event"] = 0
+    seconds = common.measure(func, COUNT)
+    common.report(name, seconds)
+    print("%-40s %d changed, %d change-event per switch" % 
+          ("", calls["changed"] // (3 * COUNT), 
+           calls["change-event"] // (3 * COUNT)))
+
+if __name__ == "__main__":
+    run("set_int x %d" % len(KEYS), per_key_loop)
+    run("set_many(%d keys)" % len(KEYS), set_many)
+    run("batch() of %d set_int" % len(KEYS), batch)
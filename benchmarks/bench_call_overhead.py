@@ -0,0 +1,88 @@
+#! /usr/bin/env python3
+# -*- coding: utf-8 -*-
+
+# Copyright (C) 2012 Deepin, Inc.
+# 
+# This program is free software: you can redistribute it and/or modify
+# it under the terms of the GNU General Public License as published by
+# the Free Software Foundation, either version 3 of the License, or
+# any later version.
+# 
+# This program is distributed in the hope that it will be useful,
+# but WITHOUT ANY WARRANTY; without even the implied warranty of
+# MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+# GNU General Public License for more details.
+# 
+# You should have received a copy of the GNU General Public License
+# along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+'''
+Per-call overhead of method lookup and dispatch on deepin_gsettings objects.
+get_int hits the read cache so that GIO stays out of the measurement, and
+the methods near the end of the method table are the worst case for a
+linear name lookup. The per-method table runs the typed getters on the
+read cache (get_value always reads GIO) and every setter under SYNC_MANUAL,
+so that what remains is argument passing, key resolution and conversion.
+'''
+
+from __future__ import print_function
+
+import common
+
+deepin_gsettings = common.setup()
+
+COUNT = 200000
+
+settings = deepin_gsettings.new(common.SCHEMA_ID)
+settings.set_read_cache(True)
+settings.tag = "dock"
+
+def lookup_get_int():
+    settings.get_int
+
+def lookup_get_sync_policy():
+    settings.get_sync_policy
+
+def lookup_attribute():
+    settings.tag
+
+def call_get_int():
+    settings.get_int("count")
+
+def call_get_sync_policy():
+    settings.get_sync_policy()
+
+writer = deepin_gsettings.new(common.SCHEMA_ID)
+writer.set_sync_policy(deepin_gsettings.SYNC_MANUAL)
+
+# (method, key, value to write)
+TYPED = [
+    ("boolean", "active", True),
+    ("int", "count", 7),
+    ("uint", "ucount", 7),
+    ("double", "brightness", 0.25),
+    ("string", "name", "deepin"),
+    ("strv", "apps", ["a", "b", "c"]),
+    ("value", "pair", (1, 2)),
+]
+
+def per_method():
+    for kind, key, value in TYPED:
+        getter = getattr(settings, "get_" + kind)
+        setter = getattr(writer, "set_" + kind)
+        getter(key)
+        common.report("get_%s(k)" % kind,
+                      common.measure(lambda: getter(key), COUNT))
+        common.report("set_%s(k, v), SYNC_MANUAL" % kind,
+                      common.measure(lambda: setter(key, value), COUNT))
+
+if __name__ == "__main__":
+    common.report("s.get_int (lookup)", common.measure(lookup_get_int, COUNT))
+    common.report("s.get_sync_policy (lookup)",
+                  common.measure(lookup_get_sync_policy, COUNT))
+    common.report("s.tag (instance attribute)",
+                  common.measure(lookup_attribute, COUNT))
+    common.report("s.get_int(k), cached", common.measure(call_get_int, COUNT))
+    common.report("s.get_sync_policy()",
+                  common.measure(call_get_sync_policy, COUNT))
+    per_method()
@@ -0,0 +1,62 @@
+#! /usr/bin/env python3
+# -*- coding: utf-8 -*-
+
+# Copyright (C) 2012 Deepin, Inc.
+# 
+# This program is free software: you can redistribute it and/or modify
+# it under the terms of the GNU General Public License as published by
+# the Free Software Foundation, either version 3 of the License, or
+# any later version.
+# 
+# This program is distributed in the hope that it will be useful,
+# but WITHOUT ANY WARRANTY; without even the implied warranty of
+# MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+# GNU General Public License for more details.
+# 
+# You should have received a copy of the GNU General Public License
+# along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+'''
+A brightness slider drag: a burst of writes to one key plus a few others,
+heard through per-key "changed" callbacks or through coalesced "changes"
+deliveries, with the main loop run once after every frame of writes.
+'''
+
+from __future__ import print_function
+
+import time
+
+import common
+
+deepin_gsettings = common.setup()
+
+FRAMES = 100
+WRITES_PER_FRAME = 50
+
+writer = deepin_gsettings.new(common.SCHEMA_ID)
+listener = deepin_gsettings.new(common.SCHEMA_ID)
+
+def drag():
+    for frame in range(FRAMES):
+        for i in range(WRITES_PER_FRAME):
+            writer.set_double("brightness", i / float(WRITES_PER_FRAME))
+        writer.set_int("count", frame)
+        common.iterate_main_loop()
+
+def run(name, signal):
+    calls = []
+    handler = listener.connect(signal, lambda *args: calls.append(args))
+    start = time.time()
+    drag()
+    elapsed = time.time() - start
+    # Let a rate-limited delivery still pending go out
+    time.sleep(0.06)
+    common.iterate_main_loop()
+    listener.disconnect(handler)
+    print("%-40s %12.2f ms %8d callbacks" % (name, elapsed * 1e3, len(calls)))
+
+if __name__ == "__main__":
+    run("changed, per key", "changed")
+    run("changes, next idle", "changes")
+    listener.set_changes_interval(50)
+    run("changes, 50 ms interval", "changes")
@@ -0,0 +1,110 @@
+#! /usr/bin/env python3
+# -*- coding: utf-8 -*-
+
+# Copyright (C) 2012 Deepin, Inc.
+# 
+# This program is free software: you can redistribute it and/or modify
+# it under the terms of the GNU General Public License as published by
+# the Free Software Foundation, either version 3 of the License, or
+# any later version.
+# 
+# This program is distributed in the hope that it will be useful,
+# but WITHOUT ANY WARRANTY; without even the implied warranty of
+# MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+# GNU General Public License for more details.
+# 
+# You should have received a copy of the GNU General Public License
+# along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+'''
+Many paths of one relocatable schema: a new_with_path() object per path
+against a single collection(), which keeps a GSettings per path it got,
+and against bulk get_many() reads, which keep nothing. Each way runs in a
+process of its own so that the resident memory it adds can be told apart.
+
+    bench_collection.py [paths] [objects|collection|bulk]
+'''
+
+from __future__ import print_function
+
+import os
+import subprocess
+import sys
+import time
+
+import common
+
+PATHS = int(sys.argv[1]) if len(sys.argv) > 1 else 10000
+MODES = ["objects", "collection", "bulk"]
+
+PAGE_KB = os.sysconf("SC_PAGE_SIZE") // 1024
+
+def rss_kb():
+    with open("/proc/self/statm") as statm:
+        return int(statm.read().split()[1]) * PAGE_KB
+
+def timed(func):
+    start = time.time()
+    result = func()
+    return time.time() - start, result
+
+def run_objects(deepin_gsettings, paths):
+    def open_all():
+        objects = [deepin_gsettings.new_with_path(common.RELOC_SCHEMA_ID, path)
+                   for path in paths]
+        for settings in objects:
+            settings.get_int("level")
+        return objects
+
+    open_time, objects = timed(open_all)
+    read_time, _ = timed(lambda: [settings.get_int("level")
+                                  for settings in objects])
+    return open_time, read_time, objects
+
+def run_collection(deepin_gsettings, paths):
+    collection = deepin_gsettings.collection(common.RELOC_SCHEMA_ID)
+    open_time, _ = timed(lambda: [collection.get(path, "level")
+                                  for path in paths])
+    read_time, _ = timed(lambda: collection.get_many("level", paths))
+    return open_time, read_time, collection
+
+def run_bulk(deepin_gsettings, paths):
+    collection = deepin_gsettings.collection(common.RELOC_SCHEMA_ID)
+    open_time, _ = timed(lambda: collection.get_many("level", paths))
+    read_time, _ = timed(lambda: collection.get_many("level", paths))
+    return open_time, read_time, collection
+
+def run(mode):
+    deepin_gsettings = common.setup()
+    paths = ["/bench/collection/%d/" % i for i in range(PATHS)]
+
+    # Loads GIO and the schema before the baseline
+    deepin_gsettings.new_with_path(common.RELOC_SCHEMA_ID, "/bench/warmup/")
+    before = rss_kb()
+    if mode == "objects":
+        open_time, read_time, keep = run_objects(deepin_gsettings, paths)
+    elif mode == "collection":
+        open_time, read_time, keep = run_collection(deepin_gsettings, paths)
+    else:
+        open_time, read_time, keep = run_bulk(deepin_gsettings, paths)
+
+    print("%-10s %12.1f %12.1f %12.2f %12d" %
+          (mode, open_time * 1e3, read_time * 1e3,
+           read_time / PATHS * 1e6, rss_kb() - before))
+    sys.stdout.flush()
+    del keep
+
+def main():
+    if len(sys.argv) > 2:
+        run(sys.argv[2])
+        return
+
+    print("%d paths of %s" % (PATHS, common.RELOC_SCHEMA_ID))
+    print("%-10s %12s %12s %12s %12s" %
+          ("mode", "open ms", "reread ms", "us/path", "rss KB"))
+    sys.stdout.flush()
+    for mode in MODES:
+        subprocess.check_call([sys.executable, __file__, str(PATHS), mode])
+
+if __name__ == "__main__":
+    main()
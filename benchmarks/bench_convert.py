@@ -0,0 +1,59 @@
+#! /usr/bin/env python3
+# -*- coding: utf-8 -*-
+
+# Copyright (C) 2012 Deepin, Inc.
+# 
+# This program is free software: you can redistribute it and/or modify
+# it under the terms of the GNU General Public License as published by
+# the Free Software Foundation, either version 3 of the License, or
+# any later version.
+# 
+# This program is distributed in the hope that it will be useful,
+# but WITHOUT ANY WARRANTY; without even the implied warranty of
+# MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+# GNU General Public License for more details.
+# 
+# You should have received a copy of the GNU General Public License
+# along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+'''
+GVariant <-> Python conversion cost of get_value/set_value per key type,
+from scalars up to nested arrays, tuples and dictionaries.
+'''
+
+from __future__ import print_function
+
+import common
+
+deepin_gsettings = common.setup()
+
+COUNT = 2000
+
+VALUES = [
+    ("active", True),
+    ("count", 42),
+    ("big", 1 << 40),
+    ("brightness", 0.75),
+    ("name", "deepin"),
+    ("apps", ["app-%d.desktop" % i for i in range(20)]),
+    ("pair", (1920, 1080)),
+    ("maybe-name", "dock"),
+    ("blob", b"\x00\x01\x02\x03" * 256),
+    ("options", {"size": 48, "position": "bottom", "hide": False,
+                 "apps": ["a", "b"], "scale": 1.25}),
+    ("matrix", [list(range(16)) for _ in range(16)]),
+    ("monitors", [("HDMI-%d" % i, 1920, 1080, 60) for i in range(8)]),
+    ("table", dict(("group-%d" % i, ["item-%d" % j for j in range(8)])
+                   for i in range(16))),
+]
+
+settings = deepin_gsettings.new(common.SCHEMA_ID)
+
+if __name__ == "__main__":
+    for key, value in VALUES:
+        settings.set_value(key, value)
+        assert settings.get_value(key) == value, key
+        common.report("get_value %s" % key,
+                      common.measure(lambda: settings.get_value(key), COUNT))
+        common.report("set_value %s" % key,
+                      common.measure(lambda: settings.set_value(key, value), COUNT))
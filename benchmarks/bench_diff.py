@@ -0,0 +1,105 @@
+#! /usr/bin/env python3
+# -*- coding: utf-8 -*-
+
+# Copyright (C) 2012 Deepin, Inc.
+# 
+# This program is free software: you can redistribute it and/or modify
+# it under the terms of the GNU General Public License as published by
+# the Free Software Foundation, either version 3 of the License, or
+# any later version.
+# 
+# This program is distributed in the hope that it will be useful,
+# but WITHOUT ANY WARRANTY; without even the implied warranty of
+# MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+# GNU General Public License for more details.
+# 
+# You should have received a copy of the GNU General Public License
+# along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+'''
+A daemon applying the same monitor layout again and again, one write in
+ten a new one, with a subscriber on the dispatcher thread that only cares
+about real changes. It either listens to "changed::monitors" and compares
+get_value() with what it saw last, or listens to "diff::monitors". Python
+callbacks, GIL acquisitions of the dispatcher and the writes suppressed
+before the GIL are counted.
+
+    bench_diff.py [keyfile|memory]
+
+The memory backend drops equal writes itself, keyfile notifies each one
+like dconf does.
+'''
+
+from __future__ import print_function
+
+import sys
+import threading
+import time
+
+import common
+
+BACKEND = sys.argv[1] if len(sys.argv) > 1 else "keyfile"
+WRITES = 2000
+NEW_EVERY = 10
+
+deepin_gsettings = common.setup(BACKEND)
+
+def layout(i):
+    return [("HDMI-%d" % i, 1920, 1080, 60), ("eDP-1", 1366, 768, 60)]
+
+def run(name, subscribe):
+    deepin_gsettings.start_dispatcher()
+    writer = deepin_gsettings.new(common.SCHEMA_ID)
+    listener = deepin_gsettings.new(common.SCHEMA_ID)
+    writer.set_value("monitors", layout(-1))
+
+    done = threading.Event()
+    last = layout(WRITES // NEW_EVERY)
+    seen = {"callbacks": 0, "changes": 0}
+    handler = subscribe(listener, seen, last, done)
+
+    deepin_gsettings.enable_stats(True)
+    deepin_gsettings.reset_stats()
+    start = time.time()
+    for i in range(WRITES):
+        writer.set_value("monitors", layout(i // NEW_EVERY))
+    writer.set_value("monitors", last)
+    done.wait(10)
+    elapsed = time.time() - start
+    stats = deepin_gsettings.stats()
+    deepin_gsettings.enable_stats(False)
+    listener.disconnect(handler)
+    deepin_gsettings.stop_dispatcher()
+
+    print("%-26s %10.2f %10d %10d %10d %12d" %
+          (name, elapsed * 1e3, seen["callbacks"], seen["changes"],
+           stats["probes"]["gil_wait"]["calls"], stats["diff_suppressed"]))
+
+def subscribe_changed(listener, seen, last, done):
+    previous = [listener.get_value("monitors")]
+    def changed(key):
+        seen["callbacks"] += 1
+        value = listener.get_value("monitors")
+        if value != previous[0]:
+            previous[0] = value
+            seen["changes"] += 1
+            if value == last:
+                done.set()
+    return listener.connect("changed::monitors", changed)
+
+def subscribe_diff(listener, seen, last, done):
+    def diff(key, old, new):
+        seen["callbacks"] += 1
+        seen["changes"] += 1
+        if new == last:
+            done.set()
+    return listener.connect("diff::monitors", diff)
+
+if __name__ == "__main__":
+    print("%s backend, %d writes, a new layout every %d" %
+          (BACKEND, WRITES + 1, NEW_EVERY))
+    print("%-26s %10s %10s %10s %10s %12s" %
+          ("subscriber", "ms", "callbacks", "changes", "gil takes",
+           "suppressed"))
+    run("changed + get_value", subscribe_changed)
+    run("diff", subscribe_diff)
@@ -0,0 +1,84 @@
+#! /usr/bin/env python3
+# -*- coding: utf-8 -*-
+
+# Copyright (C) 2012 Deepin, Inc.
+# 
+# This program is free software: you can redistribute it and/or modify
+# it under the terms of the GNU General Public License as published by
+# the Free Software Foundation, either version 3 of the License, or
+# any later version.
+# 
+# This program is distributed in the hope that it will be useful,
+# but WITHOUT ANY WARRANTY; without even the implied warranty of
+# MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+# GNU General Public License for more details.
+# 
+# You should have received a copy of the GNU General Public License
+# along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+'''
+A headless service without a GLib main loop waiting for a key that
+changes every 100 ms: polling the getter every 5 ms, against blocking in
+wait_changes(). Reports the process CPU time and the time from a write to
+the listener noticing it.
+'''
+
+from __future__ import print_function
+
+import os
+import threading
+import time
+
+import common
+
+deepin_gsettings = common.setup()
+
+DURATION = 2.0
+PERIOD = 0.1
+
+def writer(settings, stamps, stop):
+    i = 0
+    while not stop.is_set():
+        i += 1
+        stamps[i] = time.time()
+        settings.set_int("count", i)
+        time.sleep(PERIOD)
+
+def run(name, listen):
+    settings = deepin_gsettings.new(common.SCHEMA_ID)
+    stamps = {}
+    latencies = []
+    stop = threading.Event()
+    thread = threading.Thread(target=writer, args=(settings, stamps, stop))
+    cpu = sum(os.times()[:2])
+    thread.start()
+    end = time.time() + DURATION
+    listen(settings, stamps, latencies, end)
+    stop.set()
+    thread.join()
+    cpu = sum(os.times()[:2]) - cpu
+    latencies.sort()
+    print("%-30s cpu %6.3f s  median latency %7.2f ms" %
+          (name, cpu, latencies[len(latencies) // 2] * 1e3))
+
+def poll(settings, stamps, latencies, end):
+    last = settings.get_int("count")
+    while time.time() < end:
+        value = settings.get_int("count")
+        if value != last:
+            latencies.append(time.time() - stamps[value])
+            last = value
+        time.sleep(0.005)
+
+def wait(settings, stamps, latencies, end):
+    # Only keys something listens to are queued
+    settings.connect("changed::count", lambda key: None)
+    while time.time() < end:
+        for schema_id, path, key in deepin_gsettings.wait_changes(end - time.time()):
+            latencies.append(time.time() - stamps[settings.get_int("count")])
+
+if __name__ == "__main__":
+    run("poll every 5 ms", poll)
+    deepin_gsettings.start_dispatcher(queue=True)
+    run("wait_changes()", wait)
+    deepin_gsettings.stop_dispatcher()
@@ -0,0 +1,126 @@
+#! /usr/bin/env python3
+# -*- coding: utf-8 -*-
+
+# Copyright (C) 2012 Deepin, Inc.
+# 
+# This program is free software: you can redistribute it and/or modify
+# it under the terms of the GNU General Public License as published by
+# the Free Software Foundation, either version 3 of the License, or
+# any later version.
+# 
+# This program is distributed in the hope that it will be useful,
+# but WITHOUT ANY WARRANTY; without even the implied warranty of
+# MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+# GNU General Public License for more details.
+# 
+# You should have received a copy of the GNU General Public License
+# along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+'''
+Time to first value of a login daemon that reads every key of a few dozen
+settings objects before its first paint, each variant in a fresh process:
+
+    live        new() and new_with_path(), every read from the backend
+    lazy        the same objects with lazy=True
+    snapshot    load_snapshot() of a file saved by the parent, then lazy
+                objects that read it without loading the backend
+    preload     snapshot, with preload() warming the backend meanwhile;
+                the snapshot must still be loaded once preload() is done
+
+    bench_first_value.py [rounds] [backend]
+'''
+
+from __future__ import print_function
+
+import os
+import re
+import subprocess
+import sys
+import time
+
+import common
+
+ROUNDS = int(sys.argv[1]) if len(sys.argv) > 1 else 10
+BACKEND = sys.argv[2] if len(sys.argv) > 2 else "memory"
+VARIANTS = ["live", "lazy", "snapshot", "preload"]
+
+PATHS = ["/bench/first-value/%d/" % i for i in range(25)]
+
+def schema_keys():
+    '''
+    Key names of the bench schema and of its relocatable one, read from the
+    XML so that the children need not ask GSettings
+    '''
+    with open(os.path.join(common.HERE, common.SCHEMA_ID + ".gschema.xml")) as xml:
+        text = xml.read()
+    main, reloc = text.split('id="%s"' % common.RELOC_SCHEMA_ID)
+    return (re.findall(r'<key name="([^"]+)"', main),
+            re.findall(r'<key name="([^"]+)"', reloc))
+
+def child(variant, schema_dir, snapshot):
+    deepin_gsettings = common.setup(BACKEND, schema_dir)
+    keys, reloc_keys = schema_keys()
+
+    start = time.time()
+    if (variant in ("snapshot", "preload") and
+        not deepin_gsettings.load_snapshot(snapshot)):
+        raise SystemExit("the snapshot is stale")
+    if variant == "preload":
+        deepin_gsettings.preload([common.SCHEMA_ID, common.RELOC_SCHEMA_ID])
+    lazy = variant != "live"
+    objects = [(deepin_gsettings.new(common.SCHEMA_ID, lazy=lazy), keys)]
+    objects += [(deepin_gsettings.new_with_path(common.RELOC_SCHEMA_ID, path,
+                                                lazy=lazy), reloc_keys)
+                for path in PATHS]
+
+    settings, names = objects[0]
+    settings.get_value(names[0])
+    first = time.time()
+    reads = 0
+    for settings, names in objects:
+        for name in names:
+            settings.get_value(name)
+            reads += 1
+    done = time.time()
+
+    if variant == "preload":
+        deepin_gsettings.wait_preload()
+        if not deepin_gsettings.drop_snapshot():
+            raise SystemExit("preload() dropped the snapshot")
+
+    print("%f %f %d" % (first - start, done - start, reads))
+
+def main():
+    if len(sys.argv) > 4:
+        child(sys.argv[3], sys.argv[4], sys.argv[5])
+        return
+
+    deepin_gsettings = common.setup(BACKEND)
+    schema_dir = os.environ["GSETTINGS_SCHEMA_DIR"]
+    snapshot = os.path.join(schema_dir, "snapshot")
+    # Some values off their defaults, on disk for the keyfile backend
+    for i, path in enumerate(PATHS):
+        settings = deepin_gsettings.new_with_path(common.RELOC_SCHEMA_ID, path)
+        settings.set_int("level", i)
+    deepin_gsettings.wait_writes()
+    deepin_gsettings.save_snapshot(snapshot, [common.SCHEMA_ID] +
+                                   [(common.RELOC_SCHEMA_ID, path)
+                                    for path in PATHS])
+
+    print("%d objects, %s backend, best of %d processes, snapshot %d bytes" %
+          (len(PATHS) + 1, BACKEND, ROUNDS, os.path.getsize(snapshot)))
+    print("%-10s %14s %12s %8s" % ("variant", "first value ms", "all ms", "reads"))
+    for variant in VARIANTS:
+        best = None
+        for _ in range(ROUNDS):
+            output = subprocess.check_output([sys.executable, __file__,
+                                              str(ROUNDS), BACKEND, variant,
+                                              schema_dir, snapshot])
+            times = [float(field) for field in output.split()]
+            if best is None or times[0] < best[0]:
+                best = times
+        print("%-10s %14.3f %12.3f %8d" %
+              (variant, best[0] * 1e3, best[1] * 1e3, best[2]))
+
+if __name__ == "__main__":
+    main()
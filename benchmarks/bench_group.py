@@ -0,0 +1,122 @@
+#! /usr/bin/env python3
+# -*- coding: utf-8 -*-
+
+# Copyright (C) 2012 Deepin, Inc.
+# 
+# This program is free software: you can redistribute it and/or modify
+# it under the terms of the GNU General Public License as published by
+# the Free Software Foundation, either version 3 of the License, or
+# any later version.
+# 
+# This program is distributed in the hope that it will be useful,
+# but WITHOUT ANY WARRANTY; without even the implied warranty of
+# MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+# GNU General Public License for more details.
+# 
+# You should have received a copy of the GNU General Public License
+# along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+'''
+A profile switch across four schemas, standing in for the power, mouse,
+keyboard and xrandr schemas of example.py: the bench schema and three
+paths of the relocatable one. Each switch is written key by key, with
+set_many() per schema, or with one group.apply(). Syncs are counted by
+stats(), and so are the callbacks of a profile listener, which watches
+"changes" on every object or the group's merged list.
+
+    bench_group.py [keyfile|memory]
+'''
+
+from __future__ import print_function
+
+import sys
+import time
+
+import common
+
+BACKEND = sys.argv[1] if len(sys.argv) > 1 else "keyfile"
+SWITCHES = 200
+
+deepin_gsettings = common.setup(BACKEND)
+
+MEMBERS = [common.SCHEMA_ID] + [
+    (common.RELOC_SCHEMA_ID, "/bench/profile/%s/" % name)
+    for name in ("mouse", "keyboard", "xrandr")]
+
+def profile(i):
+    values = {common.SCHEMA_ID: {"brightness": 0.25 + 0.5 * (i % 2),
+                                 "volume": 30 + 40 * (i % 2),
+                                 "active": bool(i % 2),
+                                 "name": "profile %d" % (i % 2)}}
+    for member in MEMBERS[1:]:
+        values[member] = {"enabled": bool(i % 2), "level": i % 2,
+                          "label": "profile %d" % (i % 2)}
+    return values
+
+def open_objects():
+    objects = {}
+    for member in MEMBERS:
+        if isinstance(member, tuple):
+            objects[member] = deepin_gsettings.new_with_path(*member)
+        else:
+            objects[member] = deepin_gsettings.new(member)
+    return objects
+
+def run(name, switch, listen):
+    calls = [0]
+    def callback(changes):
+        calls[0] += 1
+    unlisten = listen(callback)
+    common.iterate_main_loop()
+
+    deepin_gsettings.enable_stats(True)
+    deepin_gsettings.reset_stats()
+    start = time.time()
+    for i in range(SWITCHES):
+        switch(profile(i))
+        common.iterate_main_loop()
+    elapsed = time.time() - start
+    syncs = deepin_gsettings.stats()["probes"]["sync"]["calls"]
+    deepin_gsettings.enable_stats(False)
+    unlisten()
+
+    print("%-22s %12.2f %10.1f %12.1f" %
+          (name, elapsed / SWITCHES * 1e6, float(syncs) / SWITCHES,
+           float(calls[0]) / SWITCHES))
+
+def listen_objects(objects):
+    def listen(callback):
+        handlers = [(settings, settings.connect("changes", callback))
+                    for settings in objects.values()]
+        def unlisten():
+            for settings, handler in handlers:
+                settings.disconnect(handler)
+        return unlisten
+    return listen
+
+def listen_group(group):
+    def listen(callback):
+        handler = group.connect(callback)
+        return lambda: group.disconnect(handler)
+    return listen
+
+if __name__ == "__main__":
+    objects = open_objects()
+    group = deepin_gsettings.group(MEMBERS)
+
+    def key_by_key(values):
+        for member, keys in values.items():
+            for key, value in keys.items():
+                objects[member].set_value(key, value)
+
+    def per_schema(values):
+        for member, keys in values.items():
+            objects[member].set_many(keys)
+
+    print("%s backend, %d switches of %d schemas" %
+          (BACKEND, SWITCHES, len(MEMBERS)))
+    print("%-22s %12s %10s %12s" %
+          ("way", "us/switch", "syncs", "callbacks"))
+    run("key by key", key_by_key, listen_objects(objects))
+    run("set_many per schema", per_schema, listen_objects(objects))
+    run("group.apply", group.apply, listen_group(group))
@@ -0,0 +1,50 @@
+#! /usr/bin/env python3
+# -*- coding: utf-8 -*-
+
+# Copyright (C) 2012 Deepin, Inc.
+# 
+# This program is free software: you can redistribute it and/or modify
+# it under the terms of the GNU General Public License as published by
+# the Free Software Foundation, either version 3 of the License, or
+# any later version.
+# 
+# This program is distributed in the hope that it will be useful,
+# but WITHOUT ANY WARRANTY; without even the implied warranty of
+# MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+# GNU General Public License for more details.
+# 
+# You should have received a copy of the GNU General Public License
+# along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+'''
+A busy key nobody cares about: cost of writing "brightness" while the
+process listens to every key, to "changed::name" only, or to nothing.
+The memory backend emits "changed" synchronously, so the listener's cost
+shows up in the write.
+'''
+
+from __future__ import print_function
+
+import common
+
+deepin_gsettings = common.setup()
+
+COUNT = 20000
+
+writer = deepin_gsettings.new(common.SCHEMA_ID)
+listener = deepin_gsettings.new(common.SCHEMA_ID)
+calls = []
+
+def write():
+    writer.set_double("brightness", 0.25)
+    writer.set_double("brightness", 0.75)
+
+if __name__ == "__main__":
+    common.report("no listener", common.measure(write, COUNT))
+    handler = listener.connect("changed", calls.append)
+    common.report("changed, every key", common.measure(write, COUNT))
+    listener.disconnect(handler)
+    del calls[:]
+    listener.connect("changed::name", calls.append)
+    common.report("changed::name only", common.measure(write, COUNT))
+    print("callbacks for name:", len(calls))
@@ -0,0 +1,70 @@
+#! /usr/bin/env python3
+# -*- coding: utf-8 -*-
+
+# Copyright (C) 2012 Deepin, Inc.
+# 
+# This program is free software: you can redistribute it and/or modify
+# it under the terms of the GNU General Public License as published by
+# the Free Software Foundation, either version 3 of the License, or
+# any later version.
+# 
+# This program is distributed in the hope that it will be useful,
+# but WITHOUT ANY WARRANTY; without even the implied warranty of
+# MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+# GNU General Public License for more details.
+# 
+# You should have received a copy of the GNU General Public License
+# along with this program.  If not, see <http://www.gnu.org/licenses/>.
+'''
+Key handling around the GIO calls: list_keys, lookups of literal and
+computed key names, a full snapshot, and writes the schema refuses, either
+out of range or of the wrong type.
+'''
+
+from __future__ import print_function
+
+import common
+
+deepin_gsettings = common.setup()
+
+COUNT = 20000
+
+settings = deepin_gsettings.new(common.SCHEMA_ID)
+names = ["profile-%d" % i for i in range(16)]
+
+def list_keys():
+    settings.list_keys()
+
+def get_int_literal():
+    settings.get_int("profile-3")
+
+def get_int_computed():
+    for name in names:
+        settings.get_int(name)
+
+def set_int_in_range():
+    settings.set_int("volume", 40)
+
+def set_int_out_of_range():
+    settings.set_int("volume", 400)
+
+def set_int_wrong_type():
+    try:
+        settings.set_int("name", 1)
+    except TypeError:
+        pass
+
+def snapshot():
+    settings.snapshot()
+
+if __name__ == "__main__":
+    common.report("list_keys()", common.measure(list_keys, COUNT))
+    common.report("get_int, literal key", common.measure(get_int_literal, COUNT))
+    common.report("get_int, 16 computed keys",
+                  common.measure(get_int_computed, COUNT // 16))
+    common.report("set_int, in range", common.measure(set_int_in_range, COUNT))
+    common.report("set_int, out of range",
+                  common.measure(set_int_out_of_range, COUNT))
+    common.report("set_int, wrong type",
+                  common.measure(set_int_wrong_type, COUNT))
+    common.report("snapshot()", common.measure(snapshot, COUNT // 10))
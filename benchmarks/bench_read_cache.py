@@ -0,0 +1,58 @@
+#! /usr/bin/env python3
+# -*- coding: utf-8 -*-
+
+# Copyright (C) 2012 Deepin, Inc.
+# 
+# This program is free software: you can redistribute it and/or modify
+# it under the terms of the GNU General Public License as published by
+# the Free Software Foundation, either version 3 of the License, or
+# any later version.
+# 
+# This program is distributed in the hope that it will be useful,
+# but WITHOUT ANY WARRANTY; without even the implied warranty of
+# MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+# GNU General Public License for more details.
+# 
+# You should have received a copy of the GNU General Public License
+# along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+'''
+A UI polling the same keys every frame, with and without the read cache.
+'''
+
+from __future__ import print_function
+
+import common
+
+deepin_gsettings = common.setup()
+
+COUNT = 2000
+
+settings = deepin_gsettings.new(common.SCHEMA_ID)
+settings.set_strv("apps", ["app-%d.desktop" % i for i in range(20)])
+
+def poll():
+    settings.get_boolean("active")
+    settings.get_int("count")
+    settings.get_uint("ucount")
+    settings.get_double("brightness")
+    settings.get_string("name")
+    settings.get_strv("apps")
+    for i in range(14):
+        settings.get_int("profile-%d" % i)
+
+def check_wrong_type():
+    # A cached key read through a getter of another type still raises
+    settings.get_int("count")
+    try:
+        settings.get_string("count")
+    except TypeError:
+        return
+    raise AssertionError("get_string() of a cached int key did not raise")
+
+if __name__ == "__main__":
+    common.report("poll 20 keys, no cache", common.measure(poll, COUNT))
+    settings.set_read_cache(True)
+    common.report("poll 20 keys, read cache", common.measure(poll, COUNT))
+    check_wrong_type()
+    print(settings.read_cache_stats())
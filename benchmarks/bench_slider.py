@@ -0,0 +1,144 @@
+#! /usr/bin/env python3
+# -*- coding: utf-8 -*-
+
+# Copyright (C) 2012 Deepin, Inc.
+# 
+# This program is free software: you can redistribute it and/or modify
+# it under the terms of the GNU General Public License as published by
+# the Free Software Foundation, either version 3 of the License, or
+# any later version.
+# 
+# This program is distributed in the hope that it will be useful,
+# but WITHOUT ANY WARRANTY; without even the implied warranty of
+# MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+# GNU General Public License for more details.
+# 
+# You should have received a copy of the GNU General Public License
+# along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+'''
+hello_gsettings' slider drag from C: a value-changed event every couple of
+milliseconds, each written with g_settings_set_double() and
+g_settings_sync() as the demo used to, or handed to libdeepin-gsettings
+with a deferred sync policy. Writes reaching the backend are counted by a
+"changed" handler on a second handle.
+
+    bench_slider.py [memory|keyfile]
+
+libdeepin-gsettings.so is looked up like any shared library, or taken
+from $DEEPIN_GSETTINGS_LIB.
+'''
+
+from __future__ import print_function
+
+import ctypes
+import os
+import sys
+import time
+
+import common
+
+BACKEND = sys.argv[1] if len(sys.argv) > 1 else "memory"
+EVENTS = 500
+EVENT_INTERVAL = 0.002
+FLUSH_INTERVAL = 100
+SYNC_DEFERRED = 1
+
+common.setup(BACKEND)
+
+gio = ctypes.CDLL("libgio-2.0.so.0")
+glib = ctypes.CDLL("libglib-2.0.so.0")
+lib = ctypes.CDLL(os.environ.get("DEEPIN_GSETTINGS_LIB",
+                                 "libdeepin-gsettings.so"))
+
+gio.g_settings_new.restype = ctypes.c_void_p
+gio.g_settings_new.argtypes = [ctypes.c_char_p]
+gio.g_settings_set_double.argtypes = [ctypes.c_void_p, ctypes.c_char_p,
+                                      ctypes.c_double]
+gio.g_signal_connect_data.argtypes = [ctypes.c_void_p, ctypes.c_char_p,
+                                      ctypes.c_void_p, ctypes.c_void_p,
+                                      ctypes.c_void_p, ctypes.c_int]
+gio.g_object_unref.argtypes = [ctypes.c_void_p]
+lib.deepin_gsettings_get.restype = ctypes.c_void_p
+lib.deepin_gsettings_get.argtypes = [ctypes.c_char_p, ctypes.c_char_p]
+lib.deepin_gsettings_set_sync_policy.argtypes = [ctypes.c_void_p,
+                                                 ctypes.c_int, ctypes.c_uint]
+lib.deepin_gsettings_set_double.argtypes = [ctypes.c_void_p, ctypes.c_char_p,
+                                            ctypes.c_double]
+lib.deepin_gsettings_release.argtypes = [ctypes.c_void_p]
+
+CHANGED_FUNC = ctypes.CFUNCTYPE(None, ctypes.c_void_p, ctypes.c_char_p,
+                                ctypes.c_void_p)
+
+SCHEMA_ID = common.SCHEMA_ID.encode()
+KEY = b"brightness"
+
+def iterate():
+    while glib.g_main_context_iteration(None, False):
+        pass
+
+def drag(write):
+    '''
+    Time spent in write() per event, the main loop run between events
+    '''
+    spent = 0.0
+    start = time.time()
+    for i in range(EVENTS):
+        before = time.time()
+        write(i / float(EVENTS))
+        spent += time.time() - before
+        deadline = start + (i + 1) * EVENT_INTERVAL
+        while time.time() < deadline:
+            iterate()
+            time.sleep(0.0002)
+    return spent / EVENTS, time.time() - start
+
+def run(name, open_writer, write, close_writer):
+    listener = gio.g_settings_new(SCHEMA_ID)
+    writes = [0]
+    def changed(settings, key, data):
+        if key == KEY:
+            writes[0] += 1
+    callback = CHANGED_FUNC(changed)
+    gio.g_signal_connect_data(listener, b"changed",
+                              ctypes.cast(callback, ctypes.c_void_p),
+                              None, None, 0)
+    iterate()
+
+    writer = open_writer()
+    cost, elapsed = drag(lambda value: write(writer, value))
+    # The last value of a deferred drag is still to be written
+    time.sleep(FLUSH_INTERVAL * 2 / 1e3)
+    iterate()
+    close_writer(writer)
+    iterate()
+    gio.g_object_unref(listener)
+
+    print("%-28s %10.0f %12.2f %10d %12.0f" %
+          (name, EVENTS / elapsed, cost * 1e6, writes[0],
+           writes[0] / elapsed))
+
+def open_raw():
+    return gio.g_settings_new(SCHEMA_ID)
+
+def write_raw(settings, value):
+    gio.g_settings_set_double(settings, KEY, value)
+    gio.g_settings_sync()
+
+def open_library():
+    settings = lib.deepin_gsettings_get(SCHEMA_ID, None)
+    lib.deepin_gsettings_set_sync_policy(settings, SYNC_DEFERRED,
+                                         FLUSH_INTERVAL)
+    return settings
+
+def write_library(settings, value):
+    lib.deepin_gsettings_set_double(settings, KEY, value)
+
+if __name__ == "__main__":
+    print("%s backend, %d events %.0f ms apart, flush every %d ms" %
+          (BACKEND, EVENTS, EVENT_INTERVAL * 1e3, FLUSH_INTERVAL))
+    print("%-28s %10s %12s %10s %12s" %
+          ("way", "events/s", "us/event", "writes", "writes/s"))
+    run("set_double + sync", open_raw, write_raw, gio.g_object_unref)
+    run("library, SYNC_DEFERRED", open_library, write_library,
+        lib.deepin_gsettings_release)
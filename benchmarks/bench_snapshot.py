@@ -0,0 +1,61 @@
+#! /usr/bin/env python3
+# -*- coding: utf-8 -*-
+
+# Copyright (C) 2012 Deepin, Inc.
+# 
+# This program is free software: you can redistribute it and/or modify
+# it under the terms of the GNU General Public License as published by
+# the Free Software Foundation, either version 3 of the License, or
+# any later version.
+# 
+# This program is distributed in the hope that it will be useful,
+# but WITHOUT ANY WARRANTY; without even the implied warranty of
+# MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+# GNU General Public License for more details.
+# 
+# You should have received a copy of the GNU General Public License
+# along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+'''
+Exporting whole schemas: list_keys() plus one get_value() per key against
+a single snapshot() call, for the bench schema and for many relocatable
+paths.
+'''
+
+from __future__ import print_function
+
+import common
+
+deepin_gsettings = common.setup()
+
+COUNT = 500
+PATHS = 1000
+
+settings = deepin_gsettings.new(common.SCHEMA_ID)
+relocs = [deepin_gsettings.new_with_path(common.RELOC_SCHEMA_ID,
+                                         "/com/deepin/gsettings/bench/reloc/%d/" % i)
+          for i in range(PATHS)]
+
+def export_by_key(settings):
+    return dict((key, settings.get_value(key)) for key in settings.list_keys())
+
+def export_paths_by_key():
+    return [export_by_key(reloc) for reloc in relocs]
+
+def export_paths_snapshot():
+    return [reloc.snapshot() for reloc in relocs]
+
+if __name__ == "__main__":
+    assert export_by_key(settings) == settings.snapshot()
+    common.report("list_keys + get_value",
+                  common.measure(lambda: export_by_key(settings), COUNT))
+    common.report("snapshot()",
+                  common.measure(settings.snapshot, COUNT))
+    common.report("snapshot(keys=[6 keys])",
+                  common.measure(lambda: settings.snapshot(["active", "count", "name",
+                                                            "apps", "pair", "options"]),
+                                 COUNT))
+    common.report("%d paths, list_keys + get_value" % PATHS,
+                  common.measure(export_paths_by_key, 5))
+    common.report("%d paths, snapshot()" % PATHS,
+                  common.measure(export_paths_snapshot, 5))
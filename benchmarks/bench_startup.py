@@ -0,0 +1,98 @@
+#! /usr/bin/env python3
+# -*- coding: utf-8 -*-
+
+# Copyright (C) 2012 Deepin, Inc.
+# 
+# This program is free software: you can redistribute it and/or modify
+# it under the terms of the GNU General Public License as published by
+# the Free Software Foundation, either version 3 of the License, or
+# any later version.
+# 
+# This program is distributed in the hope that it will be useful,
+# but WITHOUT ANY WARRANTY; without even the implied warranty of
+# MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+# GNU General Public License for more details.
+# 
+# You should have received a copy of the GNU General Public License
+# along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+
+'''
+Start-up cost of a session that creates dozens of settings objects and
+reads only a few of them. Every variant runs in a fresh process, as the
+schema source, the backend and the handles are only set up once:
+
+    eager       new_with_path() for every object
+    lazy        new_with_path(lazy=True), handles made by the first read
+    preload     preload() first, other start-up work, then lazy objects
+
+    bench_startup.py [rounds] [backend]
+'''
+
+from __future__ import print_function
+
+import subprocess
+import sys
+import time
+
+import common
+
+ROUNDS = int(sys.argv[1]) if len(sys.argv) > 1 else 10
+BACKEND = sys.argv[2] if len(sys.argv) > 2 else "memory"
+VARIANTS = ["eager", "lazy", "preload"]
+
+OBJECTS = 40
+READ = 3
+# Stands for the rest of a session's start-up, which preload() overlaps
+OTHER_WORK = 0.02
+
+def child(variant):
+    # Compiling the bench schema is not part of anyone's start-up
+    deepin_gsettings = common.setup(BACKEND)
+
+    start = time.time()
+    if variant == "preload":
+        deepin_gsettings.preload([common.SCHEMA_ID, common.RELOC_SCHEMA_ID])
+    preloaded = time.time()
+    time.sleep(OTHER_WORK)
+    other = time.time()
+
+    lazy = variant != "eager"
+    objects = [deepin_gsettings.new(common.SCHEMA_ID, lazy=lazy)]
+    objects += [deepin_gsettings.new_with_path(common.RELOC_SCHEMA_ID,
+                                               "/bench/startup/%d/" % i,
+                                               lazy=lazy)
+                for i in range(OBJECTS - 1)]
+    created = time.time()
+
+    for settings in objects[:READ]:
+        settings.get_value(settings.list_keys()[0])
+    first_read = time.time()
+
+    print("%f %f %f %f" % (preloaded - start, created - other,
+                           first_read - created,
+                           first_read - other + preloaded - start))
+
+def main():
+    if len(sys.argv) > 3:
+        child(sys.argv[3])
+        return
+
+    print("%d objects, %d read, %s backend, best of %d processes, "
+          "total leaves out the %d ms of other work" %
+          (OBJECTS, READ, BACKEND, ROUNDS, OTHER_WORK * 1e3))
+    print("%-8s %12s %12s %12s %12s" %
+          ("variant", "preload ms", "create ms", "read ms", "total ms"))
+    for variant in VARIANTS:
+        best = None
+        for _ in range(ROUNDS):
+            output = subprocess.check_output([sys.executable, __file__,
+                                              str(ROUNDS), BACKEND, variant])
+            times = [float(field) for field in output.split()]
+            if best is None or times[-1] < best[-1]:
+                best = times
+        print("%-8s %12.2f %12.2f %12.2f %12.2f" %
+              tuple([variant] + [t * 1e3 for t in best]))
+
+if __name__ == "__main__":
+    main()
@@ -0,0 +1,52 @@
+#! /usr/bin/env python3
+# -*- coding: utf-8 -*-
+
+# Copyright (C) 2012 Deepin, Inc.
+# 
+# This program is free software: you can redistribute it and/or modify
+# it under the terms of the GNU General Public License as published by
+# the Free Software Foundation, either version 3 of the License, or
+# any later version.
+# 
+# This program is distributed in the hope that it will be useful,
+# but WITHOUT ANY WARRANTY; without even the implied warranty of
+# MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+# GNU General Public License for more details.
+# 
+# You should have received a copy of the GNU General Public License
+# along with this program.  If not, see <http://www.gnu.org/licenses/>.
+'''
+Cost of the instrumentation on the cheapest calls: cached getters and
+SYNC_MANUAL setters, with stats off and on.
+'''
+
+from __future__ import print_function
+
+import common
+
+deepin_gsettings = common.setup()
+
+COUNT = 200000
+
+settings = deepin_gsettings.new(common.SCHEMA_ID)
+settings.set_read_cache(True)
+settings.set_sync_policy(deepin_gsettings.SYNC_MANUAL)
+
+def get_int():
+    settings.get_int("count")
+
+def set_int():
+    settings.set_int("count", 1)
+
+def run(label):
+    common.report("get_int(k), cached, stats %s" % label,
+                  common.measure(get_int, COUNT))
+    common.report("set_int(k, v), SYNC_MANUAL, stats %s" % label,
+                  common.measure(set_int, COUNT))
+
+if __name__ == "__main__":
+    run("off")
+    deepin_gsettings.enable_stats(True)
+    run("on")
+    probe = deepin_gsettings.stats()["probes"]["get_int"]
+    print("get_int: %d calls, %d ns" % (probe["calls"], probe["total_ns"]))
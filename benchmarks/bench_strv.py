@@ -0,0 +1,63 @@
+#! /usr/bin/env python3
+# -*- coding: utf-8 -*-
+
+# Copyright (C) 2012 Deepin, Inc.
+# 
+# This program is free software: you can redistribute it and/or modify
+# it under the terms of the GNU General Public License as published by
+# the Free Software Foundation, either version 3 of the License, or
+# any later version.
+# 
+# This program is distributed in the hope that it will be useful,
+# but WITHOUT ANY WARRANTY; without even the implied warranty of
+# MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+# GNU General Public License for more details.
+# 
+# You should have received a copy of the GNU General Public License
+# along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+'''
+set_strv/get_strv against the size of the list, for favourite-apps and
+keyboard options sized keys. Inputs other than lists and the tuple getter
+are skipped when the module does not support them.
+'''
+
+from __future__ import print_function
+
+import common
+
+deepin_gsettings = common.setup()
+
+SIZES = [10, 100, 1000]
+
+settings = deepin_gsettings.new(common.SCHEMA_ID)
+
+def count_for(size):
+    return max(200, 200000 // size)
+
+if __name__ == "__main__":
+    for size in SIZES:
+        apps = ["application-%d.desktop" % i for i in range(size)]
+        count = count_for(size)
+        common.report("set_strv list, %d" % size,
+                      common.measure(lambda: settings.set_strv("apps", apps), count))
+        if settings.set_strv("apps", tuple(apps)):
+            common.report("set_strv tuple, %d" % size,
+                          common.measure(lambda: settings.set_strv("apps", tuple(apps)),
+                                         count))
+            common.report("set_strv generator, %d" % size,
+                          common.measure(lambda: settings.set_strv("apps",
+                                                                   (a for a in apps)),
+                                         count))
+        settings.set_strv("apps", apps)
+        common.report("get_strv, %d" % size,
+                      common.measure(lambda: settings.get_strv("apps"), count))
+        if hasattr(settings, "get_strv_tuple"):
+            common.report("get_strv_tuple, %d" % size,
+                          common.measure(lambda: settings.get_strv_tuple("apps"), count))
+            settings.set_read_cache(True)
+            common.report("get_strv, read cache, %d" % size,
+                          common.measure(lambda: settings.get_strv("apps"), count))
+            common.report("get_strv_tuple, read cache, %d" % size,
+                          common.measure(lambda: settings.get_strv_tuple("apps"), count))
+            settings.set_read_cache(False)
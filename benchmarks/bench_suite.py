@@ -0,0 +1,192 @@
+#! /usr/bin/env python3
+# -*- coding: utf-8 -*-
+
+# Copyright (C) 2012 Deepin, Inc.
+# 
+# This program is free software: you can redistribute it and/or modify
+# it under the terms of the GNU General Public License as published by
+# the Free Software Foundation, either version 3 of the License, or
+# any later version.
+# 
+# This program is distributed in the hope that it will be useful,
+# but WITHOUT ANY WARRANTY; without even the implied warranty of
+# MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+# GNU General Public License for more details.
+# 
+# You should have received a copy of the GNU General Public License
+# along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+'''
+Benchmark suite of the whole binding, meant for tracking regressions:
+every getter and setter, strv size sweeps, object creation and
+change-callback delivery, with ops/s and p50/p99 latency for each.
+
+The backend is chosen before GIO is loaded, so each backend runs in a
+process of its own. Without --backend the suite runs itself once for the
+memory and once for the keyfile backend and merges the results.
+
+    bench_suite.py [--backend memory|keyfile] [--count N] [--json FILE]
+
+--json writes the results as JSON to FILE, "-" for stdout instead of the
+table.
+'''
+
+from __future__ import print_function
+
+import argparse
+import json
+import platform
+import subprocess
+import sys
+
+import common
+
+BACKENDS = ["memory", "keyfile"]
+
+# (method suffix, key, two values written in turn)
+TYPED = [
+    ("boolean", "active", (True, False)),
+    ("int", "count", (1, 2)),
+    ("uint", "ucount", (1, 2)),
+    ("double", "brightness", (0.25, 0.75)),
+    ("string", "name", ("deepin", "linux")),
+    ("strv", "apps", (["a", "b"], ["c"])),
+    ("value", "pair", ((1, 2), (3, 4))),
+]
+
+STRV_SIZES = [0, 1, 10, 100, 1000]
+
+def result(name, samples):
+    total = sum(samples)
+    return {
+        "name": name,
+        "count": len(samples),
+        "ops_per_sec": len(samples) / total if total else 0.0,
+        "p50_us": common.percentile(samples, 0.50) * 1e6,
+        "p99_us": common.percentile(samples, 0.99) * 1e6,
+    }
+
+def alternate(func, key, values):
+    '''
+    Call func(key, value) with each of values in turn, so that no write
+    repeats the value already stored
+    '''
+    state = [0]
+    def call():
+        state[0] ^= 1
+        func(key, values[state[0]])
+    return call
+
+def bench_typed(deepin_gsettings, count):
+    settings = deepin_gsettings.new(common.SCHEMA_ID)
+    for kind, key, values in TYPED:
+        getter = getattr(settings, "get_" + kind)
+        setter = getattr(settings, "set_" + kind)
+        yield result("get_" + kind, common.sample(lambda: getter(key), count))
+        yield result("set_" + kind,
+                     common.sample(alternate(setter, key, values), count))
+    yield result("reset", common.sample(lambda: settings.reset("count"), count))
+
+def bench_strv(deepin_gsettings, count):
+    settings = deepin_gsettings.new(common.SCHEMA_ID)
+    for size in STRV_SIZES:
+        # Fewer rounds for big lists, the keyfile backend rewrites them all
+        rounds = max(100, count * 10 // (size + 10))
+        values = (["app-%d" % i for i in range(size)],
+                  ["bin-%d" % i for i in range(size)])
+        yield result("set_strv[%d]" % size,
+                     common.sample(alternate(settings.set_strv, "apps", values),
+                                   rounds))
+        yield result("get_strv[%d]" % size,
+                     common.sample(lambda: settings.get_strv("apps"), rounds))
+        yield result("get_strv_tuple[%d]" % size,
+                     common.sample(lambda: settings.get_strv_tuple("apps"),
+                                   rounds))
+
+def bench_objects(deepin_gsettings, count):
+    keep = deepin_gsettings.new(common.SCHEMA_ID)
+    yield result("new, cached handle",
+                 common.sample(lambda: deepin_gsettings.new(common.SCHEMA_ID),
+                               count))
+
+    paths = iter(range(count))
+    def new_path():
+        deepin_gsettings.new_with_path(common.RELOC_SCHEMA_ID,
+                                       "/bench/suite/%d/" % next(paths))
+    yield result("new_with_path, new handle", common.sample(new_path, count))
+    del keep
+
+def bench_callbacks(deepin_gsettings, count):
+    writer = deepin_gsettings.new(common.SCHEMA_ID)
+    listener = deepin_gsettings.new(common.SCHEMA_ID)
+    calls = []
+    handler = listener.connect("changed::count", calls.append)
+
+    def roundtrip():
+        before = len(calls)
+        writer.set_int("count", before)
+        while len(calls) == before:
+            common.iterate_main_loop()
+
+    common.iterate_main_loop()
+    yield result("set_int to changed callback", common.sample(roundtrip, count))
+    listener.disconnect(handler)
+
+def run(backend, count):
+    deepin_gsettings = common.setup(backend)
+    results = []
+    for bench in (bench_typed, bench_strv, bench_objects, bench_callbacks):
+        for item in bench(deepin_gsettings, count):
+            item["backend"] = backend
+            results.append(item)
+    return results
+
+def run_all(count):
+    '''
+    One child process per backend, each writing JSON to our pipe
+    '''
+    results = []
+    for backend in BACKENDS:
+        output = subprocess.check_output([sys.executable, __file__,
+                                          "--backend", backend,
+                                          "--count", str(count),
+                                          "--json", "-"])
+        results.extend(json.loads(output.decode())["results"])
+    return results
+
+def print_table(results):
+    print("%-8s %-32s %12s %10s %10s" %
+          ("backend", "benchmark", "ops/s", "p50 us", "p99 us"))
+    for item in results:
+        print("%-8s %-32s %12.0f %10.2f %10.2f" %
+              (item["backend"], item["name"], item["ops_per_sec"],
+               item["p50_us"], item["p99_us"]))
+
+def main():
+    parser = argparse.ArgumentParser(description="deepin_gsettings benchmarks")
+    parser.add_argument("--backend", choices=BACKENDS)
+    parser.add_argument("--count", type=int, default=2000)
+    parser.add_argument("--json")
+    options = parser.parse_args()
+
+    if options.backend:
+        results = run(options.backend, options.count)
+    else:
+        results = run_all(options.count)
+
+    if options.json:
+        document = {
+            "python": platform.python_version(),
+            "count": options.count,
+            "results": results,
+        }
+        if options.json == "-":
+            json.dump(document, sys.stdout, indent=1)
+            sys.stdout.write("\n")
+            return
+        with open(options.json, "w") as out:
+            json.dump(document, out, indent=1)
+    print_table(results)
+
+if __name__ == "__main__":
+    main()
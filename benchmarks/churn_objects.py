@@ -0,0 +1,105 @@
+#! /usr/bin/env python3
+# -*- coding: utf-8 -*-
+
+# Copyright (C) 2012 Deepin, Inc.
+# 
+# This program is free software: you can redistribute it and/or modify
+# it under the terms of the GNU General Public License as published by
+# the Free Software Foundation, either version 3 of the License, or
+# any later version.
+# 
+# This program is distributed in the hope that it will be useful,
+# but WITHOUT ANY WARRANTY; without even the implied warranty of
+# MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+# GNU General Public License for more details.
+# 
+# You should have received a copy of the GNU General Public License
+# along with this program.  If not, see <http://www.gnu.org/licenses/>.
+'''
+Object churn as in a long-running session: objects on fixed and
+relocatable paths come and go with callbacks connected, some of them in
+reference cycles through their callbacks, some deleted explicitly and some
+left to the collector. Resident memory is sampled after every round and
+must stay flat once the caches are warm; the exit status is 1 when it
+keeps growing.
+
+    churn_objects.py [rounds] [backend]
+'''
+
+from __future__ import print_function
+
+import gc
+import os
+import sys
+import weakref
+
+import common
+
+ROUNDS = int(sys.argv[1]) if len(sys.argv) > 1 else 200
+deepin_gsettings = common.setup(sys.argv[2] if len(sys.argv) > 2 else "memory")
+
+OBJECTS = 100
+WARMUP = ROUNDS // 4
+# Allocator noise, well below what a leaked object per round would add up to
+SLACK_KB = 512
+
+PAGE_KB = os.sysconf("SC_PAGE_SIZE") // 1024
+
+def rss_kb():
+    with open("/proc/self/statm") as statm:
+        return int(statm.read().split()[1]) * PAGE_KB
+
+class Panel(object):
+    '''
+    Owns its settings object and is referenced back by its callbacks
+    '''
+    def __init__(self, path):
+        self.settings = deepin_gsettings.new_with_path(common.RELOC_SCHEMA_ID,
+                                                       path)
+        self.settings.connect("changed::level", self.on_level)
+        self.level = 0
+
+    def on_level(self, key):
+        self.level = self.settings.get_int(key)
+
+def one_round(index):
+    refs = []
+    panels = []
+    for i in range(OBJECTS):
+        # Fresh relocatable paths every round, so handles are created and
+        # released all the time
+        panel = Panel("/churn/%d/%d/" % (index % 8, i))
+        panel.settings.set_int("level", index)
+        refs.append(weakref.ref(panel.settings))
+        panels.append(panel)
+
+        settings = deepin_gsettings.new(common.SCHEMA_ID)
+        settings.set_read_cache(True)
+        settings.connect("changed", lambda key: None)
+        settings.connect("changes", lambda keys: None)
+        settings.get_int("count")
+        settings.set_int("count", i)
+        refs.append(weakref.ref(settings))
+        if i % 2:
+            settings.delete()
+
+    common.iterate_main_loop()
+    del panels, panel, settings
+    gc.collect()
+    alive = sum(1 for ref in refs if ref() is not None)
+    if alive:
+        print("round %d: %d objects still alive" % (index, alive))
+        sys.exit(1)
+
+if __name__ == "__main__":
+    samples = []
+    for index in range(ROUNDS):
+        one_round(index)
+        samples.append(rss_kb())
+
+    baseline = samples[WARMUP]
+    growth = samples[-1] - baseline
+    print("rss after warmup %d KB, after %d rounds %d KB, growth %d KB" %
+          (baseline, ROUNDS, samples[-1], growth))
+    print("cached handles: %d" % len(deepin_gsettings.handle_cache_info()))
+    sys.exit(1 if growth > SLACK_KB else 0)
@@ -0,0 +1,108 @@
+#! /usr/bin/env python3
+# -*- coding: utf-8 -*-
+
+# Copyright (C) 2012 Deepin, Inc.
+# 
+# This program is free software: you can redistribute it and/or modify
+# it under the terms of the GNU General Public License as published by
+# the Free Software Foundation, either version 3 of the License, or
+# any later version.
+# 
+# This program is distributed in the hope that it will be useful,
+# but WITHOUT ANY WARRANTY; without even the implied warranty of
+# MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+# GNU General Public License for more details.
+# 
+# You should have received a copy of the GNU General Public License
+# along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+'''
+Shared setup for the benchmarks: compiles the private bench schema into a
+temporary directory and selects the GSettings backend before GIO is loaded,
+so nothing depends on D-Bus, dconf or the org.gnome.* schemas.
+'''
+
+from __future__ import print_function
+
+import atexit
+import os
+import shutil
+import subprocess
+import tempfile
+import time
+
+HERE = os.path.dirname(os.path.abspath(__file__))
+SCHEMA_ID = "com.deepin.gsettings.bench"
+RELOC_SCHEMA_ID = SCHEMA_ID + ".reloc"
+
+def setup(backend="memory", schema_dir=None):
+    '''
+    Compile the bench schema and import deepin_gsettings against it
+    @para backend GSETTINGS_BACKEND to use
+    @para schema_dir directory of an earlier setup() to share, whose
+          compiled schema and keyfile are reused as they are
+    '''
+    if schema_dir is None:
+        schema_dir = tempfile.mkdtemp(prefix="deepin-gsettings-bench-")
+        atexit.register(shutil.rmtree, schema_dir, True)
+        shutil.copy(os.path.join(HERE, SCHEMA_ID + ".gschema.xml"), schema_dir)
+        subprocess.check_call(["glib-compile-schemas", schema_dir])
+
+    os.environ["GSETTINGS_SCHEMA_DIR"] = schema_dir
+    os.environ["GSETTINGS_BACKEND"] = backend
+    # The keyfile backend writes under $XDG_CONFIG_HOME/glib-2.0/settings
+    os.environ["XDG_CONFIG_HOME"] = schema_dir
+
+    import deepin_gsettings
+    return deepin_gsettings
+
+_glib = None
+
+def iterate_main_loop():
+    '''
+    Dispatch everything pending on the default GLib main context, like one
+    pass of a GTK main loop would
+    '''
+    global _glib
+    if _glib is None:
+        import ctypes
+        _glib = ctypes.CDLL("libglib-2.0.so.0")
+    while _glib.g_main_context_iteration(None, False):
+        pass
+
+def measure(func, count):
+    '''
+    Best of three runs of func() called count times, in seconds per call
+    '''
+    best = None
+    for _ in range(3):
+        start = time.time()
+        for _ in range(count):
+            func()
+        elapsed = (time.time() - start) / count
+        if best is None or elapsed < best:
+            best = elapsed
+    return best
+
+def report(name, seconds):
+    print("%-40s %12.2f us %12.0f ops/s" % (name, seconds * 1e6, 1.0 / seconds))
+
+def sample(func, count):
+    '''
+    Latency of each of count calls of func(), in seconds, sorted
+    '''
+    clock = getattr(time, "perf_counter", time.time)
+    samples = []
+    for _ in range(count):
+        start = clock()
+        func()
+        samples.append(clock() - start)
+    samples.sort()
+    return samples
+
+def percentile(samples, fraction):
+    '''
+    Nearest-rank percentile of sorted samples, fraction in [0, 1]
+    '''
+    index = int(round(fraction * (len(samples) - 1)))
+    return samples[index]
@@ -0,0 +1,157 @@
+#! /usr/bin/env python3
+# -*- coding: utf-8 -*-
+
+# Copyright (C) 2012 Deepin, Inc.
+# 
+# This program is free software: you can redistribute it and/or modify
+# it under the terms of the GNU General Public License as published by
+# the Free Software Foundation, either version 3 of the License, or
+# any later version.
+# 
+# This program is distributed in the hope that it will be useful,
+# but WITHOUT ANY WARRANTY; without even the implied warranty of
+# MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+# GNU General Public License for more details.
+# 
+# You should have received a copy of the GNU General Public License
+# along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+'''
+Replays a recording of settings changes, made with start_recording(), as
+writes against the memory or keyfile backend. A subscriber per (schema,
+path) listens on the dispatcher thread. Writer cost and the delay from
+the latest write of a key to its "changed" callback are reported, keys
+written again before their callback count once. At 1x the writes keep
+the recorded timing, at max they go out back to back.
+
+    replay.py synth FILE                    record a synthetic storm
+    replay.py play FILE [1x|max] [backend]  replay FILE
+
+The schemas of the recording must be installed, or be the bench schemas.
+'''
+
+from __future__ import print_function
+
+import sys
+import threading
+import time
+
+import common
+
+clock = getattr(time, "perf_counter", time.time)
+
+def synth(filename):
+    '''
+    A login storm on the bench schemas: per-path settings restored, a
+    brightness slider dragged, monitors replugged a few times
+    '''
+    deepin_gsettings = common.setup()
+    settings = deepin_gsettings.new(common.SCHEMA_ID)
+    paths = ["/bench/replay/%d/" % i for i in range(20)]
+    reloc = [deepin_gsettings.new_with_path(common.RELOC_SCHEMA_ID, path)
+             for path in paths]
+
+    deepin_gsettings.start_recording(filename)
+    for i, path_settings in enumerate(reloc):
+        path_settings.set_int("level", i)
+        path_settings.set_string("label", "output %d" % i)
+        path_settings.set_strv("tags", ["login", str(i)])
+        common.iterate_main_loop()
+    for step in range(200):
+        settings.set_double("brightness", step / 200.0)
+        common.iterate_main_loop()
+        time.sleep(0.002)
+    for plug in range(5):
+        settings.set_value("monitors", [("HDMI-%d" % plug, 1920, 1080, 60),
+                                        ("eDP-1", 1366, 768, 60)])
+        settings.set_int("count", plug)
+        common.iterate_main_loop()
+        time.sleep(0.05)
+    deepin_gsettings.stop_recording()
+
+    events = deepin_gsettings.read_recording(filename)
+    print("%d changes over %.2f s recorded into %s" %
+          (len(events), events[-1][0] if events else 0.0, filename))
+
+def percentile_ms(samples, fraction):
+    if not samples:
+        return 0.0
+    return common.percentile(sorted(samples), fraction) * 1e3
+
+def play(filename, speed, backend):
+    deepin_gsettings = common.setup(backend)
+    events = deepin_gsettings.read_recording(filename)
+    deepin_gsettings.start_dispatcher()
+
+    lock = threading.Lock()
+    sent = {}
+    delays = []
+
+    def subscriber(schema_id, path):
+        def changed(key):
+            now = clock()
+            with lock:
+                start = sent.pop((schema_id, path, key), None)
+                if start is not None:
+                    delays.append(now - start)
+        return changed
+
+    objects = {}
+    for _, schema_id, path, _, _ in events:
+        if (schema_id, path) in objects:
+            continue
+        if path is None:
+            settings = deepin_gsettings.new(schema_id)
+        else:
+            settings = deepin_gsettings.new_with_path(schema_id, path)
+        settings.connect("changed", subscriber(schema_id, path))
+        objects[schema_id, path] = settings
+
+    costs = []
+    start = clock()
+    for offset, schema_id, path, key, value in events:
+        if speed == "1x":
+            delay = start + offset - clock()
+            if delay > 0:
+                time.sleep(delay)
+        before = clock()
+        with lock:
+            sent[schema_id, path, key] = before
+        objects[schema_id, path].set_value(key, value)
+        costs.append(clock() - before)
+    elapsed = clock() - start
+
+    # Callbacks still on their way
+    deadline = clock() + 1.0
+    while sent and clock() < deadline:
+        time.sleep(0.01)
+    deepin_gsettings.stop_dispatcher()
+
+    print("%d changes of %d (schema, path), %s, %s backend" %
+          (len(events), len(objects), speed, backend))
+    print("%-12s %10s %12s %12s %12s" %
+          ("", "per s", "mean us", "p99 us", "max us"))
+    print("%-12s %10.0f %12.2f %12.2f %12.2f" %
+          ("writer", len(events) / elapsed,
+           sum(costs) / len(costs) * 1e6,
+           percentile_ms(costs, 0.99) * 1e3, max(costs) * 1e6))
+    print("%-12s %10s %12s %12s %12s" %
+          ("", "delays", "p50 ms", "p99 ms", "max ms"))
+    print("%-12s %10d %12.3f %12.3f %12.3f" %
+          ("subscribers", len(delays), percentile_ms(delays, 0.5),
+           percentile_ms(delays, 0.99), percentile_ms(delays, 1.0)))
+
+def main():
+    if len(sys.argv) < 3 or sys.argv[1] not in ("synth", "play"):
+        print(__doc__.strip())
+        sys.exit(2)
+
+    if sys.argv[1] == "synth":
+        synth(sys.argv[2])
+    else:
+        play(sys.argv[2],
+             sys.argv[3] if len(sys.argv) > 3 else "max",
+             sys.argv[4] if len(sys.argv) > 4 else "memory")
+
+if __name__ == "__main__":
+    main()
@@ -0,0 +1,118 @@
+#! /usr/bin/env python3
+# -*- coding: utf-8 -*-
+
+# Copyright (C) 2012 Deepin, Inc.
+# 
+# This program is free software: you can redistribute it and/or modify
+# it under the terms of the GNU General Public License as published by
+# the Free Software Foundation, either version 3 of the License, or
+# any later version.
+# 
+# This program is distributed in the hope that it will be useful,
+# but WITHOUT ANY WARRANTY; without even the implied warranty of
+# MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+# GNU General Public License for more details.
+# 
+# You should have received a copy of the GNU General Public License
+# along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+'''
+Reader threads against one writer thread that keeps syncing to the keyfile
+backend. Getters and setters release the GIL around GIO, so readers keep
+making progress and their longest stall stays far below the time the writer
+spends in g_settings_sync(). Another thread deletes and recreates handles
+meanwhile to exercise the handle lifetime, and one more starts and stops the
+dispatcher around a deferred write, which must neither be lost nor leave
+new() waiting for the stopped dispatcher.
+'''
+
+from __future__ import print_function
+
+import sys
+import threading
+import time
+
+import common
+
+deepin_gsettings = common.setup(sys.argv[1] if len(sys.argv) > 1 else "keyfile")
+
+DURATION = 3.0
+READERS = 4
+
+stop = threading.Event()
+reads = [0] * READERS
+stalls = [0.0] * READERS
+writes = [0]
+write_time = [0.0]
+round_trips = [0]
+lost = [0]
+
+def reader(index):
+    settings = deepin_gsettings.new(common.SCHEMA_ID)
+    last = time.time()
+    while not stop.is_set():
+        settings.get_int("count")
+        settings.get_strv("apps")
+        now = time.time()
+        stalls[index] = max(stalls[index], now - last)
+        last = now
+        reads[index] += 1
+
+def writer():
+    settings = deepin_gsettings.new(common.SCHEMA_ID)
+    apps = ["app-%d.desktop" % i for i in range(200)]
+    while not stop.is_set():
+        start = time.time()
+        settings.set_int("count", writes[0])
+        settings.set_strv("apps", apps)
+        write_time[0] += time.time() - start
+        writes[0] += 1
+
+def churn():
+    while not stop.is_set():
+        settings = deepin_gsettings.new(common.SCHEMA_ID)
+        settings.get_int("count")
+        settings.delete()
+
+def round_trip():
+    while not stop.is_set():
+        volume = round_trips[0] % 100
+        deepin_gsettings.start_dispatcher()
+        settings = deepin_gsettings.new(common.SCHEMA_ID)
+        settings.set_sync_policy(deepin_gsettings.SYNC_DEFERRED, 1000)
+        settings.set_int("volume", volume)
+        deepin_gsettings.stop_dispatcher()
+        if deepin_gsettings.new(common.SCHEMA_ID).get_int("volume") != volume:
+            lost[0] += 1
+        settings.delete()
+        round_trips[0] += 1
+
+if __name__ == "__main__":
+    threads = [threading.Thread(target=reader, args=(i,)) for i in range(READERS)]
+    threads.append(threading.Thread(target=writer))
+    threads.append(threading.Thread(target=churn))
+    threads.append(threading.Thread(target=round_trip))
+    for thread in threads:
+        thread.daemon = True
+        thread.start()
+    time.sleep(DURATION)
+    stop.set()
+    for thread in threads:
+        thread.join(DURATION)
+    if any(thread.is_alive() for thread in threads):
+        print("FAIL: a thread is still blocked after %.0f s" % DURATION)
+        sys.exit(1)
+
+    print("writer: %d writes, %.2f ms each" % 
+          (writes[0], write_time[0] * 1000 / max(writes[0], 1)))
+    for i in range(READERS):
+        print("reader %d: %8d reads, longest stall %.2f ms" % 
+              (i, reads[i], stalls[i] * 1000))
+    print("dispatcher: %d round trips, %d deferred writes lost" % 
+          (round_trips[0], lost[0]))
+    if min(reads) == 0:
+        print("FAIL: a reader made no progress")
+        sys.exit(1)
+    if round_trips[0] == 0 or lost[0]:
+        print("FAIL: the dispatcher round trip lost a deferred write")
+        sys.exit(1)
@@ -0,0 +1,1764 @@
+/* 
+ * Copyright (C) 2012 Deepin, Inc.
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "deepin_gsettings.h"
+
+#include <glib/gstdio.h>
+#include <errno.h>
+#include <string.h>
+
+/* Number of cached settings kept after their last user released them */
+#define CACHE_IDLE_LIMIT 64
+
+/* Snapshot file: format version, stamp of the files its values came from, 
+ * then cache key -> key -> value
+ */
+#define SNAPSHOT_VERSION 1
+#define SNAPSHOT_TYPE "(ua(tt)a{sa{sv}})"
+
+/* Recording: the magic, then per change an 8 byte (size, 0) header and a 
+ * serialized RECORD_TYPE padded to 8 bytes, which keeps the next one 
+ * aligned. Native byte order, recordings are replayed where they are made
+ */
+#define RECORDING_MAGIC "DGSREC1"
+#define RECORD_TYPE "(xsmssv)"
+
+/* A connect_changes() handler. Keys are queued by the "changed" signal and
+ * delivered by an idle source, or by a timeout when the previous delivery
+ * is less than interval ms old. The source holds a reference to it and to 
+ * its settings, so a delivery running while another thread disconnects 
+ * finishes safely
+ */
+typedef struct {
+    gint ref_count;
+    DeepinGSettings *settings;
+    guint id;
+    DeepinGSettingsChangesFunc func;
+    gpointer user_data;
+    GDestroyNotify notify;
+    GMutex lock;            /* guards everything below */
+    guint interval;
+    GPtrArray *keys;        /* interned key names, in order of first change */
+    GHashTable *seen;       /* set of keys */
+    GSource *source;
+    gint64 last_delivery;
+} ChangeSubscription;
+
+struct _DeepinGSettingsWriter {
+    gint ref_count;
+    GSettings *handle;
+    GMainContext *context;  /* as in DeepinGSettings */
+    GMutex lock;            /* guards everything below */
+    DeepinGSettingsSyncPolicy sync_policy;
+    guint sync_interval;    /* deferred flush delay in milliseconds */
+    GHashTable *pending;    /* key -> GVariant, last unflushed write per key */
+    GSource *flush_source;
+};
+
+struct _DeepinGSettings {
+    gint ref_count;
+    guint n_users;          /* get() calls not released yet, m_cache_lock */
+    gboolean dropped;       /* left the cache in use, m_cache_lock */
+    GList idle_link;        /* in m_cache_idle while idle, m_cache_lock */
+    gchar *cache_key;
+    GSettings *handle;
+    GSettingsSchema *schema;
+    gchar *path;            /* NULL for the schema's own path */
+    GMainContext *context;  /* where our sources run, NULL for the library's */
+    gulong changed_id;
+    DeepinGSettingsWriter *writer;
+    GMutex lock;            /* guards everything below */
+    GHashTable *read_cache; /* key -> GVariant, NULL when disabled */
+    guint cache_generation; /* bumped by every invalidation */
+    GSList *subscriptions;  /* ChangeSubscription */
+    guint last_subscription_id;
+};
+
+/* A deepin_gsettings_write_async() call */
+typedef struct {
+    GSettings *handle;
+    gchar **keys;
+    GVariant **values;
+    guint n_values;
+    gboolean written;
+    DeepinGSettingsWriteFunc func;
+    gpointer user_data;
+} WriteJob;
+
+/* The context set with deepin_gsettings_set_context() and the sources 
+ * attached to it, referenced, for deepin_gsettings_drain_context()
+ */
+static GMutex m_context_lock;
+static GMainContext *m_context = NULL;
+static GPtrArray *m_context_sources = NULL;
+
+static DeepinGSettingsSyncFunc m_sync_func = NULL;
+static gpointer m_sync_data = NULL;
+
+static GMutex m_cache_lock;
+static GHashTable *m_cache = NULL;  /* cache key -> DeepinGSettings */
+static GQueue m_cache_idle = G_QUEUE_INIT; /* idle settings, oldest first */
+
+static GMutex m_handle_lock;
+static GCond m_handle_cond;
+
+/* Worker thread of the async writes, started by the first one. Jobs
+ * queued while it writes and syncs go out together with the next sync
+ */
+static GAsyncQueue *m_write_queue = NULL;
+static GThread *m_write_thread = NULL;
+static GMutex m_write_lock;
+static GCond m_write_cond;
+static guint m_writes_in_flight = 0;    /* under m_write_lock */
+static DeepinGSettingsLockFunc m_callback_lock = NULL;
+static DeepinGSettingsUnlockFunc m_callback_unlock = NULL;
+
+/* The keys of one (schema_id, path) in the loaded snapshot */
+typedef struct {
+    GVariant *keys;         /* a{sv}, pointing into the mapped file */
+    GHashTable *index;      /* key -> value, built by the first lookup */
+} SnapshotEntry;
+
+/* Cache key -> SnapshotEntry */
+static GMutex m_snapshot_lock;
+static GHashTable *m_snapshot_table = NULL;
+
+static GMutex m_record_lock;
+static gint m_recording = FALSE;        /* read without m_record_lock */
+static gint64 m_record_start = 0;
+static FILE *m_record_file = NULL;
+static gchar *m_record_filename = NULL;
+static int m_record_errno = 0;          /* first write error of the file */
+static GQueue m_record_ring = G_QUEUE_INIT; /* GBytes, without a file */
+static gsize m_record_ring_size = 0;
+static gsize m_record_capacity = 0;
+
+static guint m_clear_cache(gboolean detach);
+
+/* Context that handles created from now on emit their signals in, NULL
+ * for the thread-default context of whoever creates them. The cached 
+ * settings belong to the previous one: idle ones are dropped, the ones in 
+ * use stay with their users until released
+ */
+void deepin_gsettings_set_context(GMainContext *context) 
+{
+    GMainContext *old = NULL;
+
+    if (context)
+        g_main_context_ref(context);
+    g_mutex_lock(&m_context_lock);
+    old = m_context;
+    m_context = context;
+    g_mutex_unlock(&m_context_lock);
+    if (old)
+        g_main_context_unref(old);
+
+    m_clear_cache(TRUE);
+}
+
+GMainContext *deepin_gsettings_get_context(void) 
+{
+    return m_context;
+}
+
+static GMainContext *m_ref_context(void) 
+{
+    GMainContext *context = NULL;
+
+    g_mutex_lock(&m_context_lock);
+    if (m_context)
+        context = g_main_context_ref(m_context);
+    g_mutex_unlock(&m_context_lock);
+
+    return context;
+}
+
+/* Attaches a timeout, or an idle source when interval is 0, to context, or 
+ * when NULL to the library's: the one set, the default one without
+ */
+static GSource *m_add_source(GMainContext *context, 
+                             guint interval, 
+                             GSourceFunc func, 
+                             gpointer data, 
+                             GDestroyNotify notify)
+{
+    GSource *source = interval ? g_timeout_source_new(interval)
+                               : g_idle_source_new();
+    guint i;
+
+    g_source_set_callback(source, func, data, notify);
+    if (context) {
+        g_source_attach(source, context);
+        return source;
+    }
+
+    g_mutex_lock(&m_context_lock);
+    g_source_attach(source, m_context);
+    if (m_context) {
+        if (!m_context_sources)
+            m_context_sources = g_ptr_array_new();
+        for (i = 0; i < m_context_sources->len; ) {
+            if (g_source_is_destroyed(g_ptr_array_index(m_context_sources, i)))
+                g_source_unref(g_ptr_array_remove_index_fast(m_context_sources, i));
+            else
+                i++;
+        }
+        g_ptr_array_add(m_context_sources, g_source_ref(source));
+    }
+    g_mutex_unlock(&m_context_lock);
+
+    return source;
+}
+
+/* Attaches to the library's context, see deepin_gsettings_drain_context().
+ * The caller owns the returned reference
+ */
+GSource *deepin_gsettings_add_source(guint interval, 
+                                     GSourceFunc func, 
+                                     gpointer data, 
+                                     GDestroyNotify notify)
+{
+    return m_add_source(NULL, interval, func, data, notify);
+}
+
+/* Runs what the library left on a context it no longer uses: every source 
+ * it attached there fires at once, timers included, so deferred flushes 
+ * and deliveries are not lost. Call it once the context is unset and its 
+ * loop has stopped
+ */
+void deepin_gsettings_drain_context(GMainContext *context) 
+{
+    GPtrArray *sources = g_ptr_array_new_with_free_func((GDestroyNotify) g_source_unref);
+    GSource *source = NULL;
+    guint i;
+
+    g_mutex_lock(&m_context_lock);
+    for (i = 0; m_context_sources && i < m_context_sources->len; ) {
+        source = g_ptr_array_index(m_context_sources, i);
+        if (g_source_is_destroyed(source)) {
+            g_source_unref(g_ptr_array_remove_index_fast(m_context_sources, i));
+        } else if (g_source_get_context(source) == context) {
+            g_ptr_array_add(sources, 
+                            g_ptr_array_remove_index_fast(m_context_sources, i));
+        } else {
+            i++;
+        }
+    }
+    g_mutex_unlock(&m_context_lock);
+
+    for (i = 0; i < sources->len; i++) {
+        source = g_ptr_array_index(sources, i);
+        if (!g_source_is_destroyed(source))
+            g_source_set_ready_time(source, 0);
+    }
+    while (g_main_context_iteration(context, FALSE))
+        ;
+    g_ptr_array_free(sources, TRUE);
+}
+
+/* Lets a binding wrap the g_settings_sync() of every write, func calls it 
+ * itself. Set before the first write
+ */
+void deepin_gsettings_set_sync_func(DeepinGSettingsSyncFunc func, 
+                                    gpointer user_data)
+{
+    m_sync_func = func;
+    m_sync_data = user_data;
+}
+
+static void m_sync(void) 
+{
+    if (m_sync_func)
+        m_sync_func(m_sync_data);
+    else
+        g_settings_sync();
+}
+
+typedef struct {
+    const gchar *schema_id;
+    const gchar *path;
+    GSettingsSchema *schema;    /* used instead of schema_id when set */
+    GSettings *handle;
+    gboolean done;
+} HandleRequest;
+
+static gboolean m_create_handle_cb(gpointer data) 
+{
+    HandleRequest *request = (HandleRequest *) data;
+    GSettings *handle = NULL;
+
+    if (request->schema)
+        handle = g_settings_new_full(request->schema, NULL, request->path);
+    else if (request->path)
+        handle = g_settings_new_with_path(request->schema_id, request->path);
+    else
+        handle = g_settings_new(request->schema_id);
+
+    g_mutex_lock(&m_handle_lock);
+    request->handle = handle;
+    request->done = TRUE;
+    g_cond_broadcast(&m_handle_cond);
+    g_mutex_unlock(&m_handle_lock);
+
+    return FALSE;
+}
+
+/* A GSettings emits its signals in the thread-default context it was
+ * created in, and only the thread owning a context can make it the
+ * default, so with a context set handles are created through
+ * g_main_context_invoke(). That runs in place when the context is free or
+ * owned by this thread, and waits for its owner otherwise
+ */
+GSettings *deepin_gsettings_new_handle(const gchar *schema_id, 
+                                       const gchar *path, 
+                                       GSettingsSchema *schema)
+{
+    HandleRequest request = {schema_id, path, schema, NULL, FALSE};
+    GMainContext *context = m_ref_context();
+
+    deepin_gsettings_drop_snapshot();
+
+    if (!context) {
+        m_create_handle_cb(&request);
+        return request.handle;
+    }
+
+    g_main_context_invoke(context, m_create_handle_cb, &request);
+    g_mutex_lock(&m_handle_lock);
+    while (!request.done)
+        g_cond_wait(&m_handle_cond, &m_handle_lock);
+    g_mutex_unlock(&m_handle_lock);
+    g_main_context_unref(context);
+
+    return request.handle;
+}
+
+static DeepinGSettings *m_ref(DeepinGSettings *settings) 
+{
+    g_atomic_int_inc(&settings->ref_count);
+    return settings;
+}
+
+static ChangeSubscription *m_ref_subscription(ChangeSubscription *sub) 
+{
+    g_atomic_int_inc(&sub->ref_count);
+    return sub;
+}
+
+static void m_unref_subscription(ChangeSubscription *sub) 
+{
+    if (!g_atomic_int_dec_and_test(&sub->ref_count))
+        return;
+
+    if (sub->notify)
+        sub->notify(sub->user_data);
+    g_ptr_array_free(sub->keys, TRUE);
+    g_hash_table_destroy(sub->seen);
+    g_mutex_clear(&sub->lock);
+    g_free(sub);
+}
+
+/* Stops the pending delivery and drops the settings' reference */
+static void m_drop_subscription(ChangeSubscription *sub) 
+{
+    GSource *source = NULL;
+
+    g_mutex_lock(&sub->lock);
+    source = sub->source;
+    sub->source = NULL;
+    g_mutex_unlock(&sub->lock);
+
+    if (source) {
+        g_source_destroy(source);
+        g_source_unref(source);
+    }
+    m_unref_subscription(sub);
+}
+
+static void m_unref(DeepinGSettings *settings) 
+{
+    if (!g_atomic_int_dec_and_test(&settings->ref_count))
+        return;
+
+    g_signal_handler_disconnect(settings->handle, settings->changed_id);
+    g_slist_free_full(settings->subscriptions, 
+                      (GDestroyNotify) m_drop_subscription);
+    deepin_gsettings_writer_unref(settings->writer);
+    if (settings->read_cache)
+        g_hash_table_destroy(settings->read_cache);
+    g_object_unref(settings->handle);
+    g_settings_schema_unref(settings->schema);
+    if (settings->context)
+        g_main_context_unref(settings->context);
+    g_mutex_clear(&settings->lock);
+    g_free(settings->cache_key);
+    g_free(settings->path);
+    g_free(settings);
+}
+
+/* NULL key drops every entry. Under settings->lock */
+static void m_cache_invalidate(DeepinGSettings *settings, const gchar *key) 
+{
+    if (!settings->read_cache)
+        return;
+
+    settings->cache_generation++;
+    if (key)
+        g_hash_table_remove(settings->read_cache, key);
+    else
+        g_hash_table_remove_all(settings->read_cache);
+}
+
+static gboolean m_deliver_cb(gpointer data) 
+{
+    ChangeSubscription *sub = (ChangeSubscription *) data;
+    GSource *current = g_main_current_source();
+    GPtrArray *keys = NULL;
+
+    g_mutex_lock(&sub->lock);
+    /* Disconnected from another thread while we waited */
+    if (g_source_is_destroyed(current)) {
+        g_mutex_unlock(&sub->lock);
+        return FALSE;
+    }
+    keys = sub->keys;
+    sub->keys = g_ptr_array_new();
+    g_hash_table_remove_all(sub->seen);
+    if (sub->source == current) {
+        g_source_unref(sub->source);
+        sub->source = NULL;
+    }
+    sub->last_delivery = g_get_monotonic_time();
+    g_mutex_unlock(&sub->lock);
+
+    g_ptr_array_add(keys, NULL);
+    sub->func(sub->settings, 
+              (const gchar *const *) keys->pdata, 
+              keys->len - 1, 
+              sub->user_data);
+    g_ptr_array_free(keys, TRUE);
+
+    return FALSE;
+}
+
+static void m_deliver_done(gpointer data) 
+{
+    ChangeSubscription *sub = (ChangeSubscription *) data;
+
+    m_unref(sub->settings);
+    m_unref_subscription(sub);
+}
+
+/* Queues key for sub, under settings->lock. Rapid changes to the same keys
+ * are merged until the delivery runs
+ */
+static void m_queue_key(ChangeSubscription *sub, const gchar *key) 
+{
+    gint64 elapsed = 0;
+    guint delay = 0;
+
+    g_mutex_lock(&sub->lock);
+    if (!g_hash_table_contains(sub->seen, key)) {
+        g_hash_table_add(sub->seen, (gpointer) key);
+        g_ptr_array_add(sub->keys, (gpointer) key);
+    }
+
+    if (!sub->source) {
+        elapsed = (g_get_monotonic_time() - sub->last_delivery) / 1000;
+        if (sub->interval && elapsed < sub->interval)
+            delay = sub->interval - elapsed;
+        m_ref(sub->settings);
+        sub->source = m_add_source(sub->settings->context, 
+                                   delay, 
+                                   m_deliver_cb, 
+                                   m_ref_subscription(sub), 
+                                   m_deliver_done);
+    }
+    g_mutex_unlock(&sub->lock);
+}
+
+static void m_changed_cb(GSettings *handle, gchar *key, gpointer user_data) 
+{
+    DeepinGSettings *settings = (DeepinGSettings *) user_data;
+    const gchar *name = g_intern_string(key);
+    GSList *l = NULL;
+
+    deepin_gsettings_record_change(handle, 
+                                   g_settings_schema_get_id(settings->schema), 
+                                   settings->path, 
+                                   key);
+
+    g_mutex_lock(&settings->lock);
+    m_cache_invalidate(settings, name);
+    for (l = settings->subscriptions; l; l = l->next)
+        m_queue_key((ChangeSubscription *) l->data, name);
+    g_mutex_unlock(&settings->lock);
+}
+
+static gchar *m_cache_key(const gchar *schema_id, const gchar *path) 
+{
+    if (!path)
+        return g_strdup(schema_id);
+
+    return g_strconcat(schema_id, ":", path, NULL);
+}
+
+static DeepinGSettings *m_new_settings(GSettings *handle, 
+                                       gchar *cache_key, 
+                                       const gchar *path) 
+{
+    DeepinGSettings *settings = g_new0(DeepinGSettings, 1);
+
+    settings->ref_count = 1;
+    settings->idle_link.data = settings;
+    settings->cache_key = cache_key;
+    settings->handle = handle;
+    settings->path = g_strdup(path);
+    g_object_get(handle, "settings-schema", &settings->schema, NULL);
+    g_mutex_lock(&m_context_lock);
+    if (!m_context)
+        settings->context = g_main_context_ref_thread_default();
+    g_mutex_unlock(&m_context_lock);
+    g_mutex_init(&settings->lock);
+    settings->writer = deepin_gsettings_writer_new(settings);
+    settings->changed_id = g_signal_connect(handle, 
+                                            "changed", 
+                                            G_CALLBACK(m_changed_cb), 
+                                            settings);
+
+    return settings;
+}
+
+/* Shared settings of (schema_id, path), path NULL for a fixed schema.
+ * Release it with deepin_gsettings_release()
+ */
+DeepinGSettings *deepin_gsettings_get(const gchar *schema_id, const gchar *path) 
+{
+    gchar *cache_key = m_cache_key(schema_id, path);
+    DeepinGSettings *settings = NULL;
+    GSettings *handle = NULL;
+
+    g_mutex_lock(&m_cache_lock);
+    if (!m_cache)
+        m_cache = g_hash_table_new(g_str_hash, g_str_equal);
+    settings = g_hash_table_lookup(m_cache, cache_key);
+    g_mutex_unlock(&m_cache_lock);
+
+    /* Created unlocked, that may wait for the owner of the context */
+    if (!settings) {
+        handle = deepin_gsettings_new_handle(schema_id, path, NULL);
+        if (!handle) {
+            g_free(cache_key);
+            return NULL;
+        }
+    }
+
+    g_mutex_lock(&m_cache_lock);
+    settings = g_hash_table_lookup(m_cache, cache_key);
+    if (!settings) {
+        settings = m_new_settings(handle, cache_key, path);
+        g_hash_table_insert(m_cache, settings->cache_key, settings);
+        cache_key = NULL;
+        handle = NULL;
+    } else if (!settings->n_users) {
+        g_queue_unlink(&m_cache_idle, &settings->idle_link);
+    }
+    settings->n_users++;
+    g_mutex_unlock(&m_cache_lock);
+
+    if (handle)
+        g_object_unref(handle);
+    g_free(cache_key);
+
+    return settings;
+}
+
+/* Flushes pending writes. The settings stay cached, so getting them again 
+ * is a lookup, and once more than CACHE_IDLE_LIMIT are idle the one idle 
+ * the longest is dropped
+ */
+void deepin_gsettings_release(DeepinGSettings *settings) 
+{
+    DeepinGSettings *drop = NULL;
+    GList *oldest = NULL;
+
+    deepin_gsettings_writer_flush(settings->writer);
+
+    g_mutex_lock(&m_cache_lock);
+    if (!--settings->n_users) {
+        if (settings->dropped) {
+            drop = settings;
+        } else {
+            g_queue_push_tail_link(&m_cache_idle, &settings->idle_link);
+            if (m_cache_idle.length > CACHE_IDLE_LIMIT) {
+                oldest = g_queue_pop_head_link(&m_cache_idle);
+                drop = (DeepinGSettings *) oldest->data;
+                g_hash_table_remove(m_cache, drop->cache_key);
+            }
+        }
+    }
+    g_mutex_unlock(&m_cache_lock);
+
+    if (drop)
+        m_unref(drop);
+}
+
+/* Drops the cached settings nobody uses, returns how many. With detach 
+ * the ones in use leave the cache too and their last release frees them
+ */
+static guint m_clear_cache(gboolean detach) 
+{
+    DeepinGSettings *settings = NULL;
+    GHashTableIter iter;
+    gpointer value = NULL;
+    GSList *idle = NULL;
+    guint count = 0;
+
+    g_mutex_lock(&m_cache_lock);
+    if (m_cache) {
+        g_hash_table_iter_init(&iter, m_cache);
+        while (g_hash_table_iter_next(&iter, NULL, &value)) {
+            settings = (DeepinGSettings *) value;
+            if (settings->n_users) {
+                if (detach) {
+                    settings->dropped = TRUE;
+                    g_hash_table_iter_remove(&iter);
+                }
+                continue;
+            }
+            idle = g_slist_prepend(idle, settings);
+            g_hash_table_iter_remove(&iter);
+            count++;
+        }
+    }
+    /* Every idle settings left the cache, their links go with them */
+    g_queue_init(&m_cache_idle);
+    g_mutex_unlock(&m_cache_lock);
+
+    g_slist_free_full(idle, (GDestroyNotify) m_unref);
+
+    return count;
+}
+
+guint deepin_gsettings_clear_cache(void) 
+{
+    return m_clear_cache(FALSE);
+}
+
+/* Calls func for every cached settings, idle ones with n_users 0. func 
+ * must not get or release settings
+ */
+void deepin_gsettings_foreach(DeepinGSettingsCacheFunc func, 
+                              gpointer user_data)
+{
+    DeepinGSettings *settings = NULL;
+    GHashTableIter iter;
+    gpointer value = NULL;
+
+    g_mutex_lock(&m_cache_lock);
+    if (m_cache) {
+        g_hash_table_iter_init(&iter, m_cache);
+        while (g_hash_table_iter_next(&iter, NULL, &value)) {
+            settings = (DeepinGSettings *) value;
+            func(settings, 
+                 g_settings_schema_get_id(settings->schema), 
+                 settings->path, 
+                 settings->n_users, 
+                 user_data);
+        }
+    }
+    g_mutex_unlock(&m_cache_lock);
+}
+
+GSettings *deepin_gsettings_get_handle(DeepinGSettings *settings) 
+{
+    return settings->handle;
+}
+
+/* Coalesces writes to the handle of settings under a sync policy of its 
+ * own, DEEPIN_GSETTINGS_SYNC_IMMEDIATE at first. Each DeepinGSettings has 
+ * one, a binding may give one to each of its objects. It may outlive 
+ * settings, a scheduled flush holds a reference
+ */
+DeepinGSettingsWriter *deepin_gsettings_writer_new(DeepinGSettings *settings) 
+{
+    DeepinGSettingsWriter *writer = g_new0(DeepinGSettingsWriter, 1);
+
+    writer->ref_count = 1;
+    writer->handle = g_object_ref(settings->handle);
+    if (settings->context)
+        writer->context = g_main_context_ref(settings->context);
+    g_mutex_init(&writer->lock);
+    writer->sync_policy = DEEPIN_GSETTINGS_SYNC_IMMEDIATE;
+
+    return writer;
+}
+
+DeepinGSettingsWriter *deepin_gsettings_writer_ref(DeepinGSettingsWriter *writer) 
+{
+    g_atomic_int_inc(&writer->ref_count);
+    return writer;
+}
+
+/* The last reference flushes what is still pending */
+void deepin_gsettings_writer_unref(DeepinGSettingsWriter *writer) 
+{
+    if (!g_atomic_int_dec_and_test(&writer->ref_count))
+        return;
+
+    deepin_gsettings_writer_flush(writer);
+    g_object_unref(writer->handle);
+    if (writer->context)
+        g_main_context_unref(writer->context);
+    g_mutex_clear(&writer->lock);
+    g_free(writer);
+}
+
+/* Writes every pending value, then syncs once */
+void deepin_gsettings_writer_flush(DeepinGSettingsWriter *writer) 
+{
+    GHashTable *pending = NULL;
+    GHashTableIter iter;
+    gpointer key = NULL;
+    gpointer value = NULL;
+
+    g_mutex_lock(&writer->lock);
+    pending = writer->pending;
+    writer->pending = NULL;
+    if (writer->flush_source) {
+        g_source_destroy(writer->flush_source);
+        g_source_unref(writer->flush_source);
+        writer->flush_source = NULL;
+    }
+    g_mutex_unlock(&writer->lock);
+
+    if (!pending)
+        return;
+
+    g_hash_table_iter_init(&iter, pending);
+    while (g_hash_table_iter_next(&iter, &key, &value))
+        g_settings_set_value(writer->handle, key, value);
+    m_sync();
+    g_hash_table_destroy(pending);
+}
+
+static gboolean m_flush_source_cb(gpointer data) 
+{
+    DeepinGSettingsWriter *writer = (DeepinGSettingsWriter *) data;
+
+    /* A flush from another thread may have destroyed us while we waited */
+    if (!g_source_is_destroyed(g_main_current_source()))
+        deepin_gsettings_writer_flush(writer);
+
+    return FALSE;
+}
+
+/* DEEPIN_GSETTINGS_SYNC_DEFERRED flushes interval ms after the first
+ * unflushed write, or on the next idle when interval is 0, from the main
+ * loop of the thread that created the settings, or of the context set
+ * when they were created. Switching to DEEPIN_GSETTINGS_SYNC_IMMEDIATE
+ * flushes what is pending
+ */
+void deepin_gsettings_writer_set_sync_policy(DeepinGSettingsWriter *writer, 
+                                             DeepinGSettingsSyncPolicy policy, 
+                                             guint interval)
+{
+    g_mutex_lock(&writer->lock);
+    writer->sync_policy = policy;
+    writer->sync_interval = interval;
+    g_mutex_unlock(&writer->lock);
+
+    if (policy == DEEPIN_GSETTINGS_SYNC_IMMEDIATE)
+        deepin_gsettings_writer_flush(writer);
+}
+
+/* Takes ownership of a floating value the caller has checked against the 
+ * key. FALSE when the key is not writable
+ */
+gboolean deepin_gsettings_writer_write(DeepinGSettingsWriter *writer, 
+                                       const gchar *key, 
+                                       GVariant *value)
+{
+    DeepinGSettingsSyncPolicy policy;
+    gboolean ret = FALSE;
+
+    g_variant_ref_sink(value);
+    g_mutex_lock(&writer->lock);
+    policy = writer->sync_policy;
+    g_mutex_unlock(&writer->lock);
+
+    if (policy == DEEPIN_GSETTINGS_SYNC_IMMEDIATE) {
+        ret = g_settings_set_value(writer->handle, key, value);
+        if (ret)
+            m_sync();
+        g_variant_unref(value);
+        return ret;
+    }
+
+    if (!g_settings_is_writable(writer->handle, key)) {
+        g_variant_unref(value);
+        return FALSE;
+    }
+
+    g_mutex_lock(&writer->lock);
+    if (!writer->pending) {
+        writer->pending = g_hash_table_new_full(g_str_hash, 
+                                                g_str_equal, 
+                                                g_free, 
+                                                (GDestroyNotify) g_variant_unref);
+    }
+    g_hash_table_replace(writer->pending, g_strdup(key), value);
+
+    if (writer->sync_policy == DEEPIN_GSETTINGS_SYNC_DEFERRED && 
+        !writer->flush_source) {
+        writer->flush_source = m_add_source(writer->context, 
+                                            writer->sync_interval, 
+                                            m_flush_source_cb, 
+                                            deepin_gsettings_writer_ref(writer), 
+                                            (GDestroyNotify) deepin_gsettings_writer_unref);
+    }
+    g_mutex_unlock(&writer->lock);
+
+    return TRUE;
+}
+
+/* New reference to the unflushed value of key, NULL when there is none */
+GVariant *deepin_gsettings_writer_lookup(DeepinGSettingsWriter *writer, 
+                                         const gchar *key)
+{
+    GVariant *value = NULL;
+
+    g_mutex_lock(&writer->lock);
+    if (writer->pending)
+        value = g_hash_table_lookup(writer->pending, key);
+    if (value)
+        g_variant_ref(value);
+    g_mutex_unlock(&writer->lock);
+
+    return value;
+}
+
+/* Forgets the unflushed value of key, superseded by a write elsewhere */
+void deepin_gsettings_writer_discard(DeepinGSettingsWriter *writer, 
+                                     const gchar *key)
+{
+    g_mutex_lock(&writer->lock);
+    if (writer->pending)
+        g_hash_table_remove(writer->pending, key);
+    g_mutex_unlock(&writer->lock);
+}
+
+void deepin_gsettings_set_sync_policy(DeepinGSettings *settings, 
+                                      DeepinGSettingsSyncPolicy policy, 
+                                      guint interval)
+{
+    deepin_gsettings_writer_set_sync_policy(settings->writer, policy, interval);
+}
+
+void deepin_gsettings_flush(DeepinGSettings *settings) 
+{
+    deepin_gsettings_writer_flush(settings->writer);
+}
+
+/* Takes ownership of a floating value. Values of another type than the
+ * key's, or outside its range, choices or flags, are refused before any
+ * backend is involved, and so are unknown keys
+ */
+gboolean deepin_gsettings_set_value(DeepinGSettings *settings, 
+                                    const gchar *key, 
+                                    GVariant *value)
+{
+    GSettingsSchemaKey *schema_key = NULL;
+    gboolean ret = FALSE;
+
+    g_variant_ref_sink(value);
+    if (g_settings_schema_has_key(settings->schema, key)) {
+        schema_key = g_settings_schema_get_key(settings->schema, key);
+        ret = g_variant_is_of_type(value, 
+                                   g_settings_schema_key_get_value_type(schema_key)) && 
+              g_settings_schema_key_range_check(schema_key, value);
+        g_settings_schema_key_unref(schema_key);
+    }
+    if (!ret) {
+        g_variant_unref(value);
+        return FALSE;
+    }
+
+    g_mutex_lock(&settings->lock);
+    m_cache_invalidate(settings, key);
+    g_mutex_unlock(&settings->lock);
+
+    ret = deepin_gsettings_writer_write(settings->writer, key, value);
+    g_variant_unref(value);
+
+    return ret;
+}
+
+gboolean deepin_gsettings_set_boolean(DeepinGSettings *settings, 
+                                      const gchar *key, 
+                                      gboolean value)
+{
+    return deepin_gsettings_set_value(settings, key, g_variant_new_boolean(value));
+}
+
+gboolean deepin_gsettings_set_int(DeepinGSettings *settings, 
+                                  const gchar *key, 
+                                  gint value)
+{
+    return deepin_gsettings_set_value(settings, key, g_variant_new_int32(value));
+}
+
+gboolean deepin_gsettings_set_uint(DeepinGSettings *settings, 
+                                   const gchar *key, 
+                                   guint value)
+{
+    return deepin_gsettings_set_value(settings, key, g_variant_new_uint32(value));
+}
+
+gboolean deepin_gsettings_set_double(DeepinGSettings *settings, 
+                                     const gchar *key, 
+                                     gdouble value)
+{
+    return deepin_gsettings_set_value(settings, key, g_variant_new_double(value));
+}
+
+gboolean deepin_gsettings_set_string(DeepinGSettings *settings, 
+                                     const gchar *key, 
+                                     const gchar *value)
+{
+    return deepin_gsettings_set_value(settings, key, g_variant_new_string(value));
+}
+
+static void m_free_write_job(WriteJob *job) 
+{
+    guint i;
+
+    for (i = 0; i < job->n_values; i++)
+        g_variant_unref(job->values[i]);
+    g_free(job->values);
+    g_strfreev(job->keys);
+    g_object_unref(job->handle);
+    g_free(job);
+}
+
+/* Writes whatever is queued, then syncs once for all of it, so callers
+ * keep queueing while the backend is busy instead of waiting in turn
+ */
+static gpointer m_write_thread_func(gpointer data G_GNUC_UNUSED) 
+{
+    GQueue done = G_QUEUE_INIT;
+    WriteJob *job = NULL;
+    gpointer token = NULL;
+    guint n_jobs;
+    guint i;
+
+    for (;;) {
+        job = g_async_queue_pop(m_write_queue);
+        for (; job; job = g_async_queue_try_pop(m_write_queue)) {
+            job->written = TRUE;
+            for (i = 0; job->written && i < job->n_values; i++)
+                job->written = g_settings_is_writable(job->handle, job->keys[i]);
+            for (i = 0; job->written && i < job->n_values; i++)
+                g_settings_set_value(job->handle, job->keys[i], job->values[i]);
+            g_queue_push_tail(&done, job);
+        }
+        m_sync();
+
+        n_jobs = done.length;
+        if (m_callback_lock)
+            token = m_callback_lock();
+        while ((job = g_queue_pop_head(&done))) {
+            if (job->func)
+                job->func(job->written, job->user_data);
+            m_free_write_job(job);
+        }
+        if (m_callback_unlock)
+            m_callback_unlock(token);
+
+        g_mutex_lock(&m_write_lock);
+        m_writes_in_flight -= n_jobs;
+        g_cond_broadcast(&m_write_cond);
+        g_mutex_unlock(&m_write_lock);
+    }
+
+    return NULL;
+}
+
+/* Writes keys, a NULL-terminated array of n_values keys, to the values of
+ * their type from a worker thread, and calls func with whether the backend
+ * took them all. Takes ownership of keys, values and the sunk values
+ */
+void deepin_gsettings_write_async(GSettings *handle, 
+                                  gchar **keys, 
+                                  GVariant **values, 
+                                  guint n_values, 
+                                  DeepinGSettingsWriteFunc func, 
+                                  gpointer user_data)
+{
+    WriteJob *job = g_new0(WriteJob, 1);
+
+    job->handle = g_object_ref(handle);
+    job->keys = keys;
+    job->values = values;
+    job->n_values = n_values;
+    job->func = func;
+    job->user_data = user_data;
+
+    g_mutex_lock(&m_write_lock);
+    m_writes_in_flight++;
+    if (!m_write_thread) {
+        m_write_queue = g_async_queue_new();
+        m_write_thread = g_thread_new("deepin-gsettings-write", 
+                                      m_write_thread_func, 
+                                      NULL);
+    }
+    g_mutex_unlock(&m_write_lock);
+
+    g_async_queue_push(m_write_queue, job);
+}
+
+/* Lets a binding take its interpreter lock once for all the callbacks of 
+ * a sync instead of once per write. Set before the first async write
+ */
+void deepin_gsettings_set_callback_lock(DeepinGSettingsLockFunc lock, 
+                                       DeepinGSettingsUnlockFunc unlock)
+{
+    m_callback_lock = lock;
+    m_callback_unlock = unlock;
+}
+
+/* Waits until every async write queued so far has reached the backend */
+void deepin_gsettings_wait_writes(void) 
+{
+    g_mutex_lock(&m_write_lock);
+    while (m_writes_in_flight)
+        g_cond_wait(&m_write_cond, &m_write_lock);
+    g_mutex_unlock(&m_write_lock);
+}
+
+/* Caches the GVariant read for each key until the key changes, through
+ * these settings or elsewhere. Values changed elsewhere are only seen once
+ * the main loop of the creating thread delivers the "changed" signal
+ */
+void deepin_gsettings_set_read_cache(DeepinGSettings *settings, 
+                                     gboolean enabled)
+{
+    g_mutex_lock(&settings->lock);
+    if (enabled && !settings->read_cache) {
+        settings->read_cache = g_hash_table_new_full(g_str_hash, 
+                                                     g_str_equal, 
+                                                     g_free, 
+                                                     (GDestroyNotify) g_variant_unref);
+    } else if (!enabled && settings->read_cache) {
+        g_hash_table_destroy(settings->read_cache);
+        settings->read_cache = NULL;
+    }
+    g_mutex_unlock(&settings->lock);
+}
+
+/* New reference to the value of key, NULL for a key the schema lacks.
+ * Unflushed writes are seen first, then the read cache
+ */
+GVariant *deepin_gsettings_get_value(DeepinGSettings *settings, 
+                                     const gchar *key)
+{
+    GVariant *value = deepin_gsettings_writer_lookup(settings->writer, key);
+    guint generation = 0;
+
+    if (value)
+        return value;
+
+    g_mutex_lock(&settings->lock);
+    if (settings->read_cache)
+        value = g_hash_table_lookup(settings->read_cache, key);
+    if (value)
+        g_variant_ref(value);
+    generation = settings->cache_generation;
+    g_mutex_unlock(&settings->lock);
+
+    if (value)
+        return value;
+
+    if (!g_settings_schema_has_key(settings->schema, key))
+        return NULL;
+
+    value = g_settings_get_value(settings->handle, key);
+
+    /* Unless the key was invalidated while it was being read */
+    g_mutex_lock(&settings->lock);
+    if (settings->read_cache && generation == settings->cache_generation) {
+        g_hash_table_replace(settings->read_cache, 
+                             g_strdup(key), 
+                             g_variant_ref(value));
+    }
+    g_mutex_unlock(&settings->lock);
+
+    return value;
+}
+
+/* The typed getters return 0, FALSE or NULL for keys the schema lacks, 
+ * and expect keys of their type
+ */
+gboolean deepin_gsettings_get_boolean(DeepinGSettings *settings, 
+                                      const gchar *key)
+{
+    GVariant *value = deepin_gsettings_get_value(settings, key);
+    gboolean ret = FALSE;
+
+    if (value) {
+        ret = g_variant_get_boolean(value);
+        g_variant_unref(value);
+    }
+
+    return ret;
+}
+
+gint deepin_gsettings_get_int(DeepinGSettings *settings, const gchar *key) 
+{
+    GVariant *value = deepin_gsettings_get_value(settings, key);
+    gint ret = 0;
+
+    if (value) {
+        ret = g_variant_get_int32(value);
+        g_variant_unref(value);
+    }
+
+    return ret;
+}
+
+guint deepin_gsettings_get_uint(DeepinGSettings *settings, const gchar *key) 
+{
+    GVariant *value = deepin_gsettings_get_value(settings, key);
+    guint ret = 0;
+
+    if (value) {
+        ret = g_variant_get_uint32(value);
+        g_variant_unref(value);
+    }
+
+    return ret;
+}
+
+gdouble deepin_gsettings_get_double(DeepinGSettings *settings, 
+                                    const gchar *key)
+{
+    GVariant *value = deepin_gsettings_get_value(settings, key);
+    gdouble ret = 0.0;
+
+    if (value) {
+        ret = g_variant_get_double(value);
+        g_variant_unref(value);
+    }
+
+    return ret;
+}
+
+gchar *deepin_gsettings_get_string(DeepinGSettings *settings, 
+                                   const gchar *key)
+{
+    GVariant *value = deepin_gsettings_get_value(settings, key);
+    gchar *ret = NULL;
+
+    if (value) {
+        ret = g_variant_dup_string(value, NULL);
+        g_variant_unref(value);
+    }
+
+    return ret;
+}
+
+/* Calls func with the keys changed since its previous call, at most once
+ * per interval ms, 0 for once per main loop iteration. It runs in the main
+ * loop of the thread that created the settings, or of the context set when
+ * they were created. Once deepin_gsettings_disconnect_changes() returns no
+ * new call starts. Returns an id > 0
+ */
+guint deepin_gsettings_connect_changes(DeepinGSettings *settings, 
+                                       guint interval, 
+                                       DeepinGSettingsChangesFunc func, 
+                                       gpointer user_data, 
+                                       GDestroyNotify notify)
+{
+    ChangeSubscription *sub = g_new0(ChangeSubscription, 1);
+
+    sub->ref_count = 1;
+    sub->settings = settings;
+    g_mutex_init(&sub->lock);
+    sub->interval = interval;
+    sub->func = func;
+    sub->user_data = user_data;
+    sub->notify = notify;
+    sub->keys = g_ptr_array_new();
+    sub->seen = g_hash_table_new(NULL, NULL);
+
+    g_mutex_lock(&settings->lock);
+    sub->id = ++settings->last_subscription_id;
+    settings->subscriptions = g_slist_append(settings->subscriptions, sub);
+    g_mutex_unlock(&settings->lock);
+
+    return sub->id;
+}
+
+void deepin_gsettings_disconnect_changes(DeepinGSettings *settings, guint id) 
+{
+    ChangeSubscription *sub = NULL;
+    GSList *l = NULL;
+
+    g_mutex_lock(&settings->lock);
+    for (l = settings->subscriptions; l; l = l->next) {
+        sub = (ChangeSubscription *) l->data;
+        if (sub->id == id)
+            break;
+    }
+    if (l)
+        settings->subscriptions = g_slist_delete_link(settings->subscriptions, l);
+    g_mutex_unlock(&settings->lock);
+
+    if (l)
+        m_drop_subscription(sub);
+}
+
+void deepin_gsettings_set_changes_interval(DeepinGSettings *settings, 
+                                           guint id, 
+                                           guint interval)
+{
+    ChangeSubscription *sub = NULL;
+    GSList *l = NULL;
+
+    g_mutex_lock(&settings->lock);
+    for (l = settings->subscriptions; l; l = l->next) {
+        sub = (ChangeSubscription *) l->data;
+        if (sub->id == id) {
+            g_mutex_lock(&sub->lock);
+            sub->interval = interval;
+            g_mutex_unlock(&sub->lock);
+            break;
+        }
+    }
+    g_mutex_unlock(&settings->lock);
+}
+
+/* What a snapshot is valid against: the dconf and keyfile databases and 
+ * the compiled schemas, each as (mtime in ns, inode). Both backends 
+ * replace their file on every write, so its inode changes too
+ */
+static GVariant *m_snapshot_stamp(void) 
+{
+    const gchar *const *dirs = g_get_system_data_dirs();
+    const gchar *schema_dirs = g_getenv("GSETTINGS_SCHEMA_DIR");
+    GPtrArray *files = g_ptr_array_new_with_free_func(g_free);
+    GVariantBuilder builder;
+    GStatBuf st;
+    gchar **split = NULL;
+    guint i;
+
+    g_ptr_array_add(files, g_build_filename(g_get_user_config_dir(), 
+                                            "dconf", "user", NULL));
+    g_ptr_array_add(files, g_build_filename(g_get_user_config_dir(), 
+                                            "glib-2.0", "settings", "keyfile", 
+                                            NULL));
+    if (schema_dirs) {
+        split = g_strsplit(schema_dirs, G_SEARCHPATH_SEPARATOR_S, 0);
+        for (i = 0; split[i]; i++)
+            g_ptr_array_add(files, g_build_filename(split[i], 
+                                                    "gschemas.compiled", 
+                                                    NULL));
+        g_strfreev(split);
+    }
+    g_ptr_array_add(files, g_build_filename(g_get_user_data_dir(), 
+                                            "glib-2.0", "schemas", 
+                                            "gschemas.compiled", NULL));
+    for (; *dirs; dirs++)
+        g_ptr_array_add(files, g_build_filename(*dirs, 
+                                                "glib-2.0", "schemas", 
+                                                "gschemas.compiled", NULL));
+
+    g_variant_builder_init(&builder, G_VARIANT_TYPE("a(tt)"));
+    for (i = 0; i < files->len; i++) {
+        if (g_stat(files->pdata[i], &st) < 0)
+            memset(&st, 0, sizeof(st));
+        g_variant_builder_add(&builder, 
+                              "(tt)", 
+                              (guint64) st.st_mtim.tv_sec * 1000000000 + 
+                              st.st_mtim.tv_nsec, 
+                              (guint64) st.st_ino);
+    }
+    g_ptr_array_free(files, TRUE);
+
+    return g_variant_ref_sink(g_variant_builder_end(&builder));
+}
+
+/* Every key of (schema_ids[i], paths[i]) for each i, read from the backend 
+ * and written to filename, which is replaced atomically. paths may be 
+ * NULL, or hold NULL for the schema's own path
+ */
+gboolean deepin_gsettings_save_snapshot(const gchar *filename, 
+                                        const gchar *const *schema_ids, 
+                                        const gchar *const *paths, 
+                                        guint n_schemas, 
+                                        GError **error) 
+{
+    GSettingsSchemaSource *source = g_settings_schema_source_get_default();
+    GSettingsSchema *schema = NULL;
+    GSettings *handle = NULL;
+    GVariantBuilder schemas;
+    GVariantBuilder keys;
+    GVariant *stamp = NULL;
+    GVariant *snapshot = NULL;
+    GVariant *value = NULL;
+    const gchar *path = NULL;
+    gchar **names = NULL;
+    gchar *cache_key = NULL;
+    gboolean ret = FALSE;
+    guint i;
+    guint j;
+
+    /* Taken before any read: a write landing meanwhile leaves the file 
+     * stale rather than wrong
+     */
+    stamp = m_snapshot_stamp();
+    deepin_gsettings_drop_snapshot();
+
+    g_variant_builder_init(&schemas, G_VARIANT_TYPE("a{sa{sv}}"));
+    for (i = 0; i < n_schemas; i++) {
+        path = paths ? paths[i] : NULL;
+        schema = source ? g_settings_schema_source_lookup(source, 
+                                                          schema_ids[i], 
+                                                          TRUE) 
+                        : NULL;
+        if (!schema || (!path && !g_settings_schema_get_path(schema))) {
+            g_set_error(error, 
+                        G_IO_ERROR, 
+                        schema ? G_IO_ERROR_INVALID_ARGUMENT 
+                               : G_IO_ERROR_NOT_FOUND, 
+                        schema ? "schema '%s' is relocatable, it needs a path" 
+                               : "schema '%s' is not installed", 
+                        schema_ids[i]);
+            if (schema)
+                g_settings_schema_unref(schema);
+            g_variant_builder_clear(&schemas);
+            g_variant_unref(stamp);
+            return FALSE;
+        }
+
+        handle = g_settings_new_full(schema, NULL, path);
+        names = g_settings_schema_list_keys(schema);
+        g_variant_builder_init(&keys, G_VARIANT_TYPE("a{sv}"));
+        for (j = 0; names[j]; j++) {
+            value = g_settings_get_value(handle, names[j]);
+            g_variant_builder_add(&keys, "{sv}", names[j], value);
+            g_variant_unref(value);
+        }
+        cache_key = m_cache_key(schema_ids[i], path);
+        g_variant_builder_add(&schemas, 
+                              "{s@a{sv}}", 
+                              cache_key, 
+                              g_variant_builder_end(&keys));
+        g_free(cache_key);
+        g_strfreev(names);
+        g_object_unref(handle);
+        g_settings_schema_unref(schema);
+    }
+
+    snapshot = g_variant_ref_sink(g_variant_new("(u@a(tt)@a{sa{sv}})", 
+                                                SNAPSHOT_VERSION, 
+                                                stamp, 
+                                                g_variant_builder_end(&schemas)));
+    ret = g_file_set_contents(filename, 
+                              g_variant_get_data(snapshot), 
+                              g_variant_get_size(snapshot), 
+                              error);
+    g_variant_unref(snapshot);
+    g_variant_unref(stamp);
+
+    return ret;
+}
+
+static void m_free_snapshot_entry(SnapshotEntry *entry) 
+{
+    g_variant_unref(entry->keys);
+    if (entry->index)
+        g_hash_table_destroy(entry->index);
+    g_free(entry);
+}
+
+/* Maps filename and serves deepin_gsettings_snapshot_lookup() from it 
+ * until the first handle is created. FALSE when the file is missing, not 
+ * a snapshot or stale
+ */
+gboolean deepin_gsettings_load_snapshot(const gchar *filename) 
+{
+    GMappedFile *file = NULL;
+    GBytes *bytes = NULL;
+    GVariant *snapshot = NULL;
+    GVariant *stamp = NULL;
+    GVariant *current = NULL;
+    GVariant *schemas = NULL;
+    SnapshotEntry *entry = NULL;
+    GHashTable *table = NULL;
+    GVariantIter iter;
+    gchar *cache_key = NULL;
+    guint32 version = 0;
+    gboolean valid = FALSE;
+
+    file = g_mapped_file_new(filename, FALSE, NULL);
+    if (!file)
+        return FALSE;
+    bytes = g_mapped_file_get_bytes(file);
+    g_mapped_file_unref(file);
+    /* Untrusted: GVariant checks offsets as it goes, a bad file reads as 
+     * defaults and fails the version check
+     */
+    snapshot = g_variant_ref_sink(g_variant_new_from_bytes(G_VARIANT_TYPE(SNAPSHOT_TYPE), 
+                                                           bytes, 
+                                                           FALSE));
+    g_bytes_unref(bytes);
+
+    g_variant_get_child(snapshot, 0, "u", &version);
+    stamp = g_variant_get_child_value(snapshot, 1);
+    current = m_snapshot_stamp();
+    valid = version == SNAPSHOT_VERSION && g_variant_equal(stamp, current);
+    g_variant_unref(current);
+    g_variant_unref(stamp);
+    if (!valid) {
+        g_variant_unref(snapshot);
+        return FALSE;
+    }
+
+    table = g_hash_table_new_full(g_str_hash, 
+                                  g_str_equal, 
+                                  g_free, 
+                                  (GDestroyNotify) m_free_snapshot_entry);
+    schemas = g_variant_get_child_value(snapshot, 2);
+    g_variant_iter_init(&iter, schemas);
+    entry = g_new0(SnapshotEntry, 1);
+    while (g_variant_iter_next(&iter, "{s@a{sv}}", &cache_key, &entry->keys)) {
+        g_hash_table_replace(table, cache_key, entry);
+        entry = g_new0(SnapshotEntry, 1);
+    }
+    g_free(entry);
+    g_variant_unref(schemas);
+    g_variant_unref(snapshot);
+
+    g_mutex_lock(&m_snapshot_lock);
+    if (m_snapshot_table)
+        g_hash_table_destroy(m_snapshot_table);
+    g_atomic_pointer_set(&m_snapshot_table, table);
+    g_mutex_unlock(&m_snapshot_lock);
+
+    return TRUE;
+}
+
+/* New reference to the value of key in the loaded snapshot, still backed 
+ * by the mapped file. NULL when none is loaded or it lacks the key
+ */
+GVariant *deepin_gsettings_snapshot_lookup(const gchar *schema_id, 
+                                           const gchar *path, 
+                                           const gchar *key) 
+{
+    SnapshotEntry *entry = NULL;
+    GVariant *value = NULL;
+    GVariantIter iter;
+    gchar *cache_key = NULL;
+    gchar *name = NULL;
+
+    if (!g_atomic_pointer_get(&m_snapshot_table))
+        return NULL;
+
+    cache_key = m_cache_key(schema_id, path);
+    g_mutex_lock(&m_snapshot_lock);
+    if (m_snapshot_table)
+        entry = g_hash_table_lookup(m_snapshot_table, cache_key);
+    /* g_variant_lookup_value() walks the serialized dict on every call */
+    if (entry && !entry->index) {
+        entry->index = g_hash_table_new_full(g_str_hash, 
+                                             g_str_equal, 
+                                             g_free, 
+                                             (GDestroyNotify) g_variant_unref);
+        g_variant_iter_init(&iter, entry->keys);
+        while (g_variant_iter_next(&iter, "{sv}", &name, &value))
+            g_hash_table_replace(entry->index, name, value);
+        value = NULL;
+    }
+    if (entry)
+        value = g_hash_table_lookup(entry->index, key);
+    if (value)
+        g_variant_ref(value);
+    g_mutex_unlock(&m_snapshot_lock);
+    g_free(cache_key);
+
+    return value;
+}
+
+/* Once a handle exists the backend is loaded and reads go live, which 
+ * also keeps the process' own writes visible. TRUE if one was loaded
+ */
+gboolean deepin_gsettings_drop_snapshot(void) 
+{
+    GHashTable *table = NULL;
+
+    if (!g_atomic_pointer_get(&m_snapshot_table))
+        return FALSE;
+
+    g_mutex_lock(&m_snapshot_lock);
+    table = m_snapshot_table;
+    g_atomic_pointer_set(&m_snapshot_table, NULL);
+    g_mutex_unlock(&m_snapshot_lock);
+
+    if (!table)
+        return FALSE;
+    g_hash_table_destroy(table);
+
+    return TRUE;
+}
+
+/* Records every change heard by the handles of this library, and by those 
+ * of a binding calling deepin_gsettings_record_change(), into filename. 
+ * With filename NULL they go to a ring of capacity bytes instead, which 
+ * drops its oldest records. Fails when already recording
+ */
+gboolean deepin_gsettings_start_recording(const gchar *filename, 
+                                          gsize capacity, 
+                                          GError **error) 
+{
+    FILE *file = NULL;
+    int saved_errno = 0;
+
+    /* A failed recording counts until stop_recording() has reported it */
+    g_mutex_lock(&m_record_lock);
+    if (m_recording || m_record_errno) {
+        g_mutex_unlock(&m_record_lock);
+        g_set_error(error, G_IO_ERROR, G_IO_ERROR_BUSY, "already recording");
+        return FALSE;
+    }
+
+    if (filename) {
+        file = fopen(filename, "wb");
+        if (!file || fwrite(RECORDING_MAGIC, 1, 8, file) != 8) {
+            saved_errno = errno;
+            if (file)
+                fclose(file);
+            g_mutex_unlock(&m_record_lock);
+            g_set_error(error, 
+                        G_FILE_ERROR, 
+                        g_file_error_from_errno(saved_errno), 
+                        "%s: %s", 
+                        filename, 
+                        g_strerror(saved_errno));
+            return FALSE;
+        }
+    }
+
+    m_record_file = file;
+    m_record_filename = g_strdup(filename);
+    m_record_capacity = capacity;
+    m_record_start = g_get_monotonic_time();
+    g_atomic_int_set(&m_recording, TRUE);
+    g_mutex_unlock(&m_record_lock);
+
+    return TRUE;
+}
+
+static void m_trim_ring(void) 
+{
+    GBytes *bytes = NULL;
+
+    /* The newest record stays even when it alone is over capacity */
+    while (m_record_ring_size > m_record_capacity && 
+           m_record_ring.length > 1) {
+        bytes = g_queue_pop_head(&m_record_ring);
+        m_record_ring_size -= g_bytes_get_size(bytes);
+        g_bytes_unref(bytes);
+    }
+}
+
+/* Ends a file recording on its first error, which stop_recording() 
+ * reports. m_record_lock held
+ */
+static void m_record_failed(int saved_errno) 
+{
+    g_atomic_int_set(&m_recording, FALSE);
+    m_record_errno = saved_errno ? saved_errno : EIO;
+    fclose(m_record_file);
+    m_record_file = NULL;
+}
+
+/* m_record_lock held */
+static void m_write_record(GVariant *record) 
+{
+    guint32 header[2] = {(guint32) g_variant_get_size(record), 0};
+    gsize padded = (header[0] + 7) & ~(gsize) 7;
+    guint8 *buffer = NULL;
+
+    if (m_record_file) {
+        buffer = g_malloc0(padded);
+        memcpy(buffer, g_variant_get_data(record), header[0]);
+        if (fwrite(header, sizeof(header), 1, m_record_file) != 1 || 
+            fwrite(buffer, 1, padded, m_record_file) != padded)
+            m_record_failed(errno);
+        g_free(buffer);
+        return;
+    }
+
+    buffer = g_malloc0(sizeof(header) + padded);
+    memcpy(buffer, header, sizeof(header));
+    memcpy(buffer + sizeof(header), g_variant_get_data(record), header[0]);
+    g_queue_push_tail(&m_record_ring, 
+                      g_bytes_new_take(buffer, sizeof(header) + padded));
+    m_record_ring_size += sizeof(header) + padded;
+    m_trim_ring();
+}
+
+/* Called by "changed" handlers with the key that changed, costs an atomic 
+ * read when nothing is being recorded
+ */
+void deepin_gsettings_record_change(GSettings *handle, 
+                                    const gchar *schema_id, 
+                                    const gchar *path, 
+                                    const gchar *key) 
+{
+    GVariant *value = NULL;
+    GVariant *record = NULL;
+    gint64 now = 0;
+
+    if (!g_atomic_int_get(&m_recording))
+        return;
+
+    value = g_settings_get_value(handle, key);
+    now = g_get_monotonic_time();
+
+    g_mutex_lock(&m_record_lock);
+    if (m_recording) {
+        record = g_variant_ref_sink(g_variant_new(RECORD_TYPE, 
+                                                  now - m_record_start, 
+                                                  schema_id, 
+                                                  path, 
+                                                  key, 
+                                                  value));
+        m_write_record(record);
+        g_variant_unref(record);
+    }
+    g_mutex_unlock(&m_record_lock);
+
+    g_variant_unref(value);
+}
+
+/* Ends the recording. A ring comes back as the recording it holds, a file 
+ * is closed and NULL returned. NULL with error set when writing or closing 
+ * the file failed, the records up to the failure are in it
+ */
+GBytes *deepin_gsettings_stop_recording(GError **error) 
+{
+    GByteArray *recording = NULL;
+    GBytes *bytes = NULL;
+    gconstpointer data = NULL;
+    gchar *filename = NULL;
+    int saved_errno = 0;
+    gsize size = 0;
+
+    g_mutex_lock(&m_record_lock);
+    if (!m_recording && !m_record_errno) {
+        g_mutex_unlock(&m_record_lock);
+        return NULL;
+    }
+    g_atomic_int_set(&m_recording, FALSE);
+
+    filename = m_record_filename;
+    m_record_filename = NULL;
+    if (m_record_file || m_record_errno) {
+        if (m_record_file && fclose(m_record_file) != 0)
+            m_record_errno = errno ? errno : EIO;
+        m_record_file = NULL;
+        saved_errno = m_record_errno;
+        m_record_errno = 0;
+        g_mutex_unlock(&m_record_lock);
+
+        if (saved_errno)
+            g_set_error(error, 
+                        G_FILE_ERROR, 
+                        g_file_error_from_errno(saved_errno), 
+                        "%s: %s", 
+                        filename, 
+                        g_strerror(saved_errno));
+        g_free(filename);
+        return NULL;
+    }
+
+    recording = g_byte_array_new();
+    g_byte_array_append(recording, (const guint8 *) RECORDING_MAGIC, 8);
+    while ((bytes = g_queue_pop_head(&m_record_ring))) {
+        data = g_bytes_get_data(bytes, &size);
+        g_byte_array_append(recording, data, size);
+        g_bytes_unref(bytes);
+    }
+    m_record_ring_size = 0;
+    g_mutex_unlock(&m_record_lock);
+
+    return g_byte_array_free_to_bytes(recording);
+}
+
+/* Calls func for every record of a recording, in order. A truncated last 
+ * record, as left by a recorder that was killed, ends it quietly
+ */
+gboolean deepin_gsettings_read_recording(GBytes *data, 
+                                         DeepinGSettingsRecordFunc func, 
+                                         gpointer user_data, 
+                                         GError **error) 
+{
+    const guint8 *bytes = NULL;
+    GBytes *slice = NULL;
+    GVariant *record = NULL;
+    GVariant *value = NULL;
+    const gchar *schema_id = NULL;
+    const gchar *path = NULL;
+    const gchar *key = NULL;
+    gint64 time = 0;
+    guint32 size = 0;
+    gsize padded = 0;
+    gsize length = 0;
+    gsize offset = 8;
+
+    bytes = g_bytes_get_data(data, &length);
+    if (length < 8 || memcmp(bytes, RECORDING_MAGIC, 8)) {
+        g_set_error(error, 
+                    G_IO_ERROR, 
+                    G_IO_ERROR_INVALID_DATA, 
+                    "not a deepin-gsettings recording");
+        return FALSE;
+    }
+
+    while (length - offset >= 8) {
+        memcpy(&size, bytes + offset, sizeof(size));
+        padded = (size + 7) & ~(gsize) 7;
+        if (padded > length - offset - 8)
+            break;
+
+        slice = g_bytes_new_from_bytes(data, offset + 8, size);
+        record = g_variant_ref_sink(g_variant_new_from_bytes(G_VARIANT_TYPE(RECORD_TYPE), 
+                                                             slice, 
+                                                             FALSE));
+        g_bytes_unref(slice);
+        g_variant_get(record, "(x&sm&s&sv)", &time, &schema_id, &path, &key, &value);
+        func(time, schema_id, path, key, value, user_data);
+        g_variant_unref(value);
+        g_variant_unref(record);
+
+        offset += 8 + padded;
+    }
+
+    return TRUE;
+}
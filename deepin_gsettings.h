@@ -0,0 +1,192 @@
+/* 
+ * Copyright (C) 2012 Deepin, Inc.
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef DEEPIN_GSETTINGS_H
+#define DEEPIN_GSETTINGS_H
+
+#include <gio/gio.h>
+
+G_BEGIN_DECLS
+
+/* When writes reach the backend */
+typedef enum {
+    DEEPIN_GSETTINGS_SYNC_IMMEDIATE,    /* written and synced by each call */
+    DEEPIN_GSETTINGS_SYNC_DEFERRED,     /* last value per key, flushed later */
+    DEEPIN_GSETTINGS_SYNC_MANUAL        /* last value per key, until flush */
+} DeepinGSettingsSyncPolicy;
+
+/* One cached GSettings per (schema_id, path), shared by every user of it */
+typedef struct _DeepinGSettings DeepinGSettings;
+
+/* Coalesced writes to one GSettings under a sync policy of their own */
+typedef struct _DeepinGSettingsWriter DeepinGSettingsWriter;
+
+/* One cached settings and the get() calls not released yet */
+typedef void (*DeepinGSettingsCacheFunc)(DeepinGSettings *settings, 
+                                         const gchar *schema_id, 
+                                         const gchar *path, 
+                                         guint n_users, 
+                                         gpointer user_data);
+
+/* Every key changed since the previous call, each listed once */
+typedef void (*DeepinGSettingsChangesFunc)(DeepinGSettings *settings, 
+                                           const gchar *const *keys, 
+                                           guint n_keys, 
+                                           gpointer user_data);
+
+/* Whether an async write reached the backend, called from the writer */
+typedef void (*DeepinGSettingsWriteFunc)(gboolean written, gpointer user_data);
+
+/* One recorded change, time in microseconds since the recording started */
+typedef void (*DeepinGSettingsRecordFunc)(gint64 time, 
+                                          const gchar *schema_id, 
+                                          const gchar *path, 
+                                          const gchar *key, 
+                                          GVariant *value, 
+                                          gpointer user_data);
+
+/* Taken and released around each run of write callbacks */
+typedef gpointer (*DeepinGSettingsLockFunc)(void);
+typedef void (*DeepinGSettingsUnlockFunc)(gpointer token);
+
+/* Makes the g_settings_sync() of a write, calling it itself */
+typedef void (*DeepinGSettingsSyncFunc)(gpointer user_data);
+
+/* Handles */
+void deepin_gsettings_set_context(GMainContext *context);
+GMainContext *deepin_gsettings_get_context(void);
+GSettings *deepin_gsettings_new_handle(const gchar *schema_id, 
+                                       const gchar *path, 
+                                       GSettingsSchema *schema);
+GSource *deepin_gsettings_add_source(guint interval, 
+                                     GSourceFunc func, 
+                                     gpointer data, 
+                                     GDestroyNotify notify);
+void deepin_gsettings_drain_context(GMainContext *context);
+
+DeepinGSettings *deepin_gsettings_get(const gchar *schema_id, const gchar *path);
+void deepin_gsettings_release(DeepinGSettings *settings);
+guint deepin_gsettings_clear_cache(void);
+void deepin_gsettings_foreach(DeepinGSettingsCacheFunc func, 
+                              gpointer user_data);
+GSettings *deepin_gsettings_get_handle(DeepinGSettings *settings);
+
+/* Writes */
+void deepin_gsettings_set_sync_policy(DeepinGSettings *settings, 
+                                      DeepinGSettingsSyncPolicy policy, 
+                                      guint interval);
+gboolean deepin_gsettings_set_value(DeepinGSettings *settings, 
+                                    const gchar *key, 
+                                    GVariant *value);
+gboolean deepin_gsettings_set_boolean(DeepinGSettings *settings, 
+                                      const gchar *key, 
+                                      gboolean value);
+gboolean deepin_gsettings_set_int(DeepinGSettings *settings, 
+                                  const gchar *key, 
+                                  gint value);
+gboolean deepin_gsettings_set_uint(DeepinGSettings *settings, 
+                                   const gchar *key, 
+                                   guint value);
+gboolean deepin_gsettings_set_double(DeepinGSettings *settings, 
+                                     const gchar *key, 
+                                     gdouble value);
+gboolean deepin_gsettings_set_string(DeepinGSettings *settings, 
+                                     const gchar *key, 
+                                     const gchar *value);
+void deepin_gsettings_flush(DeepinGSettings *settings);
+
+DeepinGSettingsWriter *deepin_gsettings_writer_new(DeepinGSettings *settings);
+DeepinGSettingsWriter *deepin_gsettings_writer_ref(DeepinGSettingsWriter *writer);
+void deepin_gsettings_writer_unref(DeepinGSettingsWriter *writer);
+void deepin_gsettings_writer_set_sync_policy(DeepinGSettingsWriter *writer, 
+                                             DeepinGSettingsSyncPolicy policy, 
+                                             guint interval);
+gboolean deepin_gsettings_writer_write(DeepinGSettingsWriter *writer, 
+                                       const gchar *key, 
+                                       GVariant *value);
+GVariant *deepin_gsettings_writer_lookup(DeepinGSettingsWriter *writer, 
+                                         const gchar *key);
+void deepin_gsettings_writer_discard(DeepinGSettingsWriter *writer, 
+                                     const gchar *key);
+void deepin_gsettings_writer_flush(DeepinGSettingsWriter *writer);
+void deepin_gsettings_set_sync_func(DeepinGSettingsSyncFunc func, 
+                                    gpointer user_data);
+
+void deepin_gsettings_write_async(GSettings *handle, 
+                                  gchar **keys, 
+                                  GVariant **values, 
+                                  guint n_values, 
+                                  DeepinGSettingsWriteFunc func, 
+                                  gpointer user_data);
+void deepin_gsettings_wait_writes(void);
+void deepin_gsettings_set_callback_lock(DeepinGSettingsLockFunc lock, 
+                                       DeepinGSettingsUnlockFunc unlock);
+
+/* Reads */
+void deepin_gsettings_set_read_cache(DeepinGSettings *settings, 
+                                     gboolean enabled);
+GVariant *deepin_gsettings_get_value(DeepinGSettings *settings, 
+                                     const gchar *key);
+gboolean deepin_gsettings_get_boolean(DeepinGSettings *settings, 
+                                      const gchar *key);
+gint deepin_gsettings_get_int(DeepinGSettings *settings, const gchar *key);
+guint deepin_gsettings_get_uint(DeepinGSettings *settings, const gchar *key);
+gdouble deepin_gsettings_get_double(DeepinGSettings *settings, 
+                                    const gchar *key);
+gchar *deepin_gsettings_get_string(DeepinGSettings *settings, 
+                                   const gchar *key);
+
+/* Snapshots */
+gboolean deepin_gsettings_save_snapshot(const gchar *filename, 
+                                        const gchar *const *schema_ids, 
+                                        const gchar *const *paths, 
+                                        guint n_schemas, 
+                                        GError **error);
+gboolean deepin_gsettings_load_snapshot(const gchar *filename);
+GVariant *deepin_gsettings_snapshot_lookup(const gchar *schema_id, 
+                                           const gchar *path, 
+                                           const gchar *key);
+gboolean deepin_gsettings_drop_snapshot(void);
+
+/* Recording */
+gboolean deepin_gsettings_start_recording(const gchar *filename, 
+                                          gsize capacity, 
+                                          GError **error);
+GBytes *deepin_gsettings_stop_recording(GError **error);
+void deepin_gsettings_record_change(GSettings *handle, 
+                                    const gchar *schema_id, 
+                                    const gchar *path, 
+                                    const gchar *key);
+gboolean deepin_gsettings_read_recording(GBytes *data, 
+                                         DeepinGSettingsRecordFunc func, 
+                                         gpointer user_data, 
+                                         GError **error);
+
+/* Change dispatch */
+guint deepin_gsettings_connect_changes(DeepinGSettings *settings, 
+                                       guint interval, 
+                                       DeepinGSettingsChangesFunc func, 
+                                       gpointer user_data, 
+                                       GDestroyNotify notify);
+void deepin_gsettings_disconnect_changes(DeepinGSettings *settings, guint id);
+void deepin_gsettings_set_changes_interval(DeepinGSettings *settings, 
+                                           guint id, 
+                                           guint interval);
+
+G_END_DECLS
+
+#endif /* DEEPIN_GSETTINGS_H */
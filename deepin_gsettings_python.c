@@ -21,11 +21,21 @@
 
 #include <Python.h>
 #include <gio/gio.h>
+#include <errno.h>
+#include <poll.h>
+#include <time.h>
+#include <unistd.h>
+#include <sys/eventfd.h>
 
-#define INT(v) PyInt_FromLong(v)
+#include "deepin_gsettings.h"
+
+#define INT(v) PyLong_FromLong(v)
 #define DOUBLE(v) PyFloat_FromDouble(v)
 #define ERROR(v) PyErr_SetString(PyExc_TypeError, v)
 
+/* Bytes kept by start_recording() without a file */
+#define RECORD_RING_CAPACITY (1 << 20)
+
 /* Safe XDECREF for object states that handles nested deallocations */
 #define ZAP(v) do {\
     PyObject *tmp = (PyObject *)(v); \
@@ -33,25 +43,441 @@
     Py_XDECREF(tmp); \
 } while (0)
 
+/* When a set_XXX write reaches the backend, the values of the library's */
+enum {
+    SYNC_IMMEDIATE = DEEPIN_GSETTINGS_SYNC_IMMEDIATE, 
+    SYNC_DEFERRED = DEEPIN_GSETTINGS_SYNC_DEFERRED, 
+    SYNC_MANUAL = DEEPIN_GSETTINGS_SYNC_MANUAL
+};
+
+/* Signals a callback can be connected to */
+enum {
+    SIGNAL_CHANGED = 0,     /* "changed" and "changed::key", called per key */
+    SIGNAL_CHANGE_EVENT,    /* "change-event", called with the list of keys */
+    SIGNAL_CHANGES,         /* "changes", coalesced list of keys, see below */
+    SIGNAL_DIFF             /* "diff" and "diff::key", called with old and new */
+};
+
+/* Instrumentation probes, see enable_stats() */
+enum {
+    STAT_GET_VALUE = 0, 
+    STAT_SET_VALUE, 
+    STAT_GET_BOOLEAN, 
+    STAT_SET_BOOLEAN, 
+    STAT_GET_INT, 
+    STAT_SET_INT, 
+    STAT_GET_UINT, 
+    STAT_SET_UINT, 
+    STAT_GET_DOUBLE, 
+    STAT_SET_DOUBLE, 
+    STAT_GET_STRING, 
+    STAT_SET_STRING, 
+    STAT_GET_STRV, 
+    STAT_GET_STRV_TUPLE, 
+    STAT_SET_STRV, 
+    STAT_SYNC,              /* g_settings_sync() and batch applies */
+    STAT_GIL_WAIT,          /* PyGILState_Ensure() in signal handlers */
+    STAT_CALLBACK,          /* Python callbacks of one signal emission */
+    STAT_COUNT
+};
+
+static const char *m_stat_names[STAT_COUNT] = {
+    "get_value", "set_value", 
+    "get_boolean", "set_boolean", 
+    "get_int", "set_int", 
+    "get_uint", "set_uint", 
+    "get_double", "set_double", 
+    "get_string", "set_string", 
+    "get_strv", "get_strv_tuple", "set_strv", 
+    "sync", "gil_wait", "callback"
+};
+
+/* Bucket i counts the calls shorter than 2^i ns that no lower bucket took, 
+ * the last one everything slower
+ */
+#define STAT_BUCKETS 40
+
+/* Latencies of one probe, updated from any thread with relaxed atomics */
+typedef struct {
+    guint64 calls;
+    guint64 total_ns;
+    guint64 buckets[STAT_BUCKETS];
+} Histogram;
+
+#define STAT_ADD(v, n) __atomic_fetch_add(&(v), (n), __ATOMIC_RELAXED)
+#define STAT_GET(v) __atomic_load_n(&(v), __ATOMIC_RELAXED)
+#define STAT_ZERO(v) __atomic_store_n(&(v), 0, __ATOMIC_RELAXED)
+
+typedef struct {
+    long id;                /* returned by connect(), taken by disconnect() */
+    int signal;
+    GQuark detail;          /* key of "changed::key" or "diff::key", 0 for all */
+    PyObject *callback;
+} SignalHandler;
+
+/* Data of the library subscription behind the "changes" handlers of one 
+ * object. The library frees it with the subscription, which a delivery 
+ * waiting for the GIL still holds after the object disconnected
+ */
+typedef struct {
+    struct _ModuleState *state;
+    gpointer owner;         /* DeepinGSettingsObject, NULL once detached, GIL */
+} ChangesTarget;
+
+/* A signal queued for wait_changes() by start_dispatcher(queue=True) */
+typedef struct _ChangeEvent {
+    struct _ChangeEvent *next;
+    struct _SettingsEntry *entry;   /* referenced */
+    GQuark key;             /* "changed" key, 0 for a "change-event" */
+    GQuark *keys;
+    gint n_keys;
+    gboolean diff;          /* old_value and new_value go to "diff" handlers */
+    GVariant *old_value;
+    GVariant *new_value;
+} ChangeEvent;
+
+/* Schema metadata of one key, read once from its GSettingsSchemaKey */
+typedef struct {
+    PyObject *name;         /* interned, also handed out by list_keys */
+    const gchar *c_name;    /* owned by key */
+    GSettingsSchemaKey *key;
+    const GVariantType *type;   /* owned by key */
+    gboolean ranged;        /* enum, flags or range restricted */
+    GVariant *default_value;
+} KeyInfo;
+
+/* Key table of a schema, built by the first object on it and shared by 
+ * every path of a relocatable schema. Only touched with the GIL held
+ */
+typedef struct {
+    PyObject *index;        /* interned name -> int position in keys */
+    PyObject *names;        /* tuple of the names, in schema order */
+    KeyInfo *keys;
+    gsize n_keys;
+} SchemaInfo;
+
+/* State of the module object. The dispatcher thread, its context and the 
+ * wait_changes() queue are GLib resources of the whole process and stay 
+ * static
+ */
+typedef struct _ModuleState {
+    PyTypeObject *settings_type;
+    PyTypeObject *batch_type;
+    PyTypeObject *collection_type;
+    PyTypeObject *group_type;
+    GHashTable *settings_cache; /* DeepinGSettings -> SettingsEntry */
+    GHashTable *schema_cache;   /* schema id -> SchemaInfo */
+    long last_handler_id;
+    gint stats_enabled;     /* read without the GIL by every probe */
+    Histogram stats[STAT_COUNT];
+    PyObject *future_type;  /* concurrent.futures.Future, imported on use */
+    guint64 diff_suppressed;    /* writes not delivered to "diff" handlers */
+} ModuleState;
+
+/* The signal handlers of one DeepinGSettings, shared by every object 
+ * created for its (schema_id, path). The entry holds one use of the 
+ * settings until its last object goes. Its signal handlers and queued 
+ * events hold a reference, so a signal still being emitted in another 
+ * thread never sees it freed
+ */
+typedef struct _SettingsEntry {
+    gint ref_count;
+    ModuleState *state;
+    DeepinGSettings *settings;
+    gchar *schema_id;
+    gchar *path;            /* NULL when created by new() */
+    GSettings *handle;
+    gulong changed_id;      /* handlers of handle, disconnected on release */
+    gulong change_event_id;
+    GSettingsSchema *schema;
+    SchemaInfo *info;
+    GSList *subscribers;    /* DeepinGSettingsObject, borrowed, GIL held */
+    guint n_objects;
+    gint n_listeners;       /* subscribers wanting every key, read without GIL */
+    gint n_event_listeners; /* subscribers with a change-event handler */
+    gint n_diff_listeners;  /* subscribers with a "diff" handler for all keys */
+    gint dirty;             /* bumped by each queued change, read without GIL */
+    GMutex lock;            /* guards the three tables below */
+    GHashTable *key_listeners;  /* GQuark -> number of changed::key handlers */
+    GHashTable *diff_keys;  /* GQuark -> number of diff::key handlers */
+    GHashTable *last_seen;  /* GQuark -> GVariant last handed to "diff" */
+} SettingsEntry;
+
 typedef struct {
     PyObject_HEAD
     PyObject *dict; /* Python attributes dictionary */
+    PyObject *weakreflist;
+    PyObject *module;       /* keeps the ModuleState alive */
     GSettings *handle;
-    PyObject *changed_cb;
+    SettingsEntry *entry;
+    gchar *lazy_schema_id;  /* until the first use of a lazy object */
+    gchar *lazy_path;
+    gboolean listening;     /* counted in entry->n_listeners */
+    gboolean listening_events;  /* counted in entry->n_event_listeners */
+    gboolean listening_diffs;   /* counted in entry->n_diff_listeners */
+    GArray *handlers;       /* SignalHandler, in connect order */
+    ChangesTarget *changes; /* while a "changes" handler is connected */
+    guint changes_id;       /* of the library subscription */
+    guint changes_interval;
+    int sync_policy;        /* also set on writer */
+    guint sync_interval;    /* deferred flush delay in milliseconds */
+    DeepinGSettingsWriter *writer;  /* coalesces writes, once attached */
+    GSettings *batch_handle;    /* delayed twin of handle used by batch() */
+    int batch_depth;
+    gboolean batch_failed;
+    PyObject *value_cache;  /* key -> converted value, NULL when disabled */
+    guint cache_generation; /* bumped by every invalidation */
+    gint cache_dirty;       /* entry->dirty the cache was last checked at */
+    unsigned long cache_hits;
+    unsigned long cache_misses;
+    guint64 *stat_calls;    /* per probe, allocated by the first counted call */
+    guint64 *key_calls;     /* per key of entry->info, likewise */
+    guint64 callbacks;      /* Python callbacks run for this object */
 } DeepinGSettingsObject;
 
-static PyObject *m_deepin_gsettings_object_constants = NULL;
-static PyTypeObject *m_DeepinGSettings_Type = NULL;
+typedef struct {
+    PyObject_HEAD
+    DeepinGSettingsObject *settings;
+} DeepinGSettingsBatchObject;
+
+/* Shared by the "changed" handlers of every handle of a collection, each 
+ * holding a reference, so that a signal emitted in another thread while 
+ * the collection goes away finds owner cleared rather than freed
+ */
+typedef struct {
+    gint ref_count;
+    gpointer owner;         /* DeepinGSettingsCollectionObject, GIL held */
+    gint n_handlers;        /* read without the GIL */
+    gchar *schema_id;       /* for the recorder */
+} CollectionRouter;
+
+typedef struct {
+    long id;
+    gchar *prefix;          /* paths it is called for, "" for all */
+    gsize prefix_len;
+    PyObject *callback;     /* called with (path, key) */
+} PathHandler;
+
+/* One relocatable schema at many paths. The key table and the change 
+ * routing are shared, there is no object per path, and the GSettings of a 
+ * path is only kept from the first get() or set() of it on
+ */
+typedef struct {
+    PyObject_HEAD
+    PyObject *weakreflist;
+    PyObject *module;       /* keeps the ModuleState alive */
+    GSettingsSchema *schema;
+    SchemaInfo *info;
+    GHashTable *handles;    /* path -> GSettings */
+    CollectionRouter *router;
+    GArray *handlers;       /* PathHandler, in connect order */
+} DeepinGSettingsCollectionObject;
+
+/* One change of a group member */
+typedef struct {
+    guint member;
+    GQuark key;
+} GroupChange;
+
+/* Changes of every member of a group, queued by m_group_changed_cb without 
+ * the GIL and delivered by one idle source as a single list. The handler 
+ * of each member and a pending source hold a reference, as for a 
+ * CollectionRouter
+ */
+typedef struct {
+    gint ref_count;
+    struct _ModuleState *state;
+    gpointer owner;         /* DeepinGSettingsGroupObject, GIL held */
+    gint n_handlers;        /* read without the GIL */
+    GMutex lock;            /* guards everything below */
+    GArray *changes;        /* GroupChange, in order of first change */
+    GHashTable **seen;      /* per member, GQuark set of its queued keys */
+    guint n_members;
+    GSource *source;
+    gint held;              /* applies of the group in progress */
+} GroupRouter;
+
+/* Data of the "changed" handler on the handle of one member */
+typedef struct {
+    GroupRouter *router;
+    guint member;
+} GroupMember;
+
+typedef struct {
+    long id;
+    PyObject *callback;     /* called with a list of (tag, key) */
+} GroupHandler;
+
+/* Schemas, or schemas at paths, used together: members are ordinary 
+ * objects, their batches are applied together and synced once, and their 
+ * changes reach one list of handlers. A member is tagged with the schema 
+ * id or (schema_id, path) pair it was given as
+ */
+typedef struct {
+    PyObject_HEAD
+    PyObject *weakreflist;
+    PyObject *module;       /* keeps the ModuleState alive */
+    PyObject *tags;         /* tuple, one per member */
+    PyObject *members;      /* tuple of DeepinGSettingsObject, same order */
+    PyObject *index;        /* tag -> member */
+    GSettings **handles;    /* watched handle of each member */
+    gulong *changed_ids;
+    GroupRouter *router;
+    GArray *handlers;       /* GroupHandler, in connect order */
+} DeepinGSettingsGroupObject;
+
+/* Private context of the dispatcher thread, from start_dispatcher() to 
+ * stop_dispatcher(). It is the library's context meanwhile: handles 
+ * created then emit their signals there, and flush and "changes" sources 
+ * run there
+ */
+static GMainContext *m_dispatch_context = NULL;
+static GMainLoop *m_dispatch_loop = NULL;
+static GThread *m_dispatch_thread = NULL;
+static gint m_dispatch_queued = 0;  /* queue events for wait_changes() */
+static gpointer m_event_head = NULL;    /* ChangeEvent, newest first */
+static int m_event_fd = -1;         /* readable while events are queued */
+
+/* A set_value_async() or apply_async() call being built, then handed to 
+ * deepin_gsettings_write_async()
+ */
+typedef struct {
+    gchar **keys;
+    GVariant **values;      /* sunk, of the type of each key */
+    guint n_values;
+} WriteJob;
 
-static DeepinGSettingsObject *m_init_deepin_gsettings_object();
-static DeepinGSettingsObject *m_new(PyObject *self, PyObject *args);
-static DeepinGSettingsObject *m_new_with_path(PyObject *self, PyObject *args);
+/* A preload() call, run by a thread of its own */
+typedef struct {
+    gchar **schema_ids;
+    GSList *schemas;        /* GSettingsSchema of those found */
+    PyObject *module;       /* only touched with the GIL */
+} PreloadJob;
+
+static GMutex m_preload_lock;
+static GCond m_preload_cond;
+static guint m_preloads_in_flight = 0;  /* under m_preload_lock */
+
+static DeepinGSettingsObject *m_init_deepin_gsettings_object(PyObject *module);
+static DeepinGSettingsObject *m_new(PyObject *self, 
+                                    PyObject *args, 
+                                    PyObject *kwds);
+static DeepinGSettingsObject *m_new_with_path(PyObject *self, 
+                                              PyObject *args, 
+                                              PyObject *kwds);
+static PyObject *m_handle_cache_info(PyObject *self, 
+                                     PyObject *Py_UNUSED(ignored));
+static PyObject *m_clear_handle_cache(PyObject *self, 
+                                      PyObject *Py_UNUSED(ignored));
+static PyObject *m_start_dispatcher(PyObject *self, 
+                                    PyObject *args, 
+                                    PyObject *kwds);
+static PyObject *m_stop_dispatcher(PyObject *self, 
+                                   PyObject *Py_UNUSED(ignored));
+static PyObject *m_changes_fd(PyObject *self, PyObject *Py_UNUSED(ignored));
+static PyObject *m_wait_changes(PyObject *self, PyObject *args);
+static PyObject *m_wait_writes(PyObject *self, PyObject *Py_UNUSED(ignored));
+static PyObject *m_preload(PyObject *self, PyObject *schema_ids);
+static PyObject *m_wait_preload(PyObject *self, PyObject *Py_UNUSED(ignored));
+static PyObject *m_save_snapshot(PyObject *self, PyObject *args);
+static PyObject *m_load_snapshot(PyObject *self, PyObject *filename);
+static PyObject *m_drop_snapshot(PyObject *self, PyObject *Py_UNUSED(ignored));
+static PyObject *m_start_recording(PyObject *self, 
+                                   PyObject *args, 
+                                   PyObject *kwds);
+static PyObject *m_stop_recording(PyObject *self, 
+                                  PyObject *Py_UNUSED(ignored));
+static PyObject *m_read_recording(PyObject *self, PyObject *source);
+static PyObject *m_enable_stats(PyObject *self, PyObject *enabled);
+static PyObject *m_stats(PyObject *self, PyObject *Py_UNUSED(ignored));
+static PyObject *m_reset_stats(PyObject *self, PyObject *Py_UNUSED(ignored));
+static PyObject *m_collection(PyObject *self, PyObject *args);
+static PyObject *m_group(PyObject *self, PyObject *members);
 static void m_changed_cb(GSettings *settings, gchar *key, gpointer user_data);
+static PyObject *m_matching_callbacks(DeepinGSettingsObject *self, 
+                                      int signal, 
+                                      GQuark key);
+static void m_update_listening(DeepinGSettingsObject *self);
+static void m_clear_handlers(DeepinGSettingsObject *self);
+static SettingsEntry *m_entry_ref(SettingsEntry *entry);
+static void m_entry_unref(SettingsEntry *entry);
+static void m_sync_cb(gpointer user_data);
+static gboolean m_change_event_cb(GSettings *settings, 
+                                  GQuark *keys, 
+                                  gint n_keys, 
+                                  gpointer user_data);
 
 static PyMethodDef deepin_gsettings_methods[] = 
 {
-    {"new", m_new, METH_VARARGS, "Deepin GSettings Construction"}, 
-    {"new_with_path", m_new_with_path, METH_VARARGS, "Deepin GSettings Construction with path"}, 
+    {"new", (PyCFunction) m_new, METH_VARARGS | METH_KEYWORDS, 
+     "Deepin GSettings Construction, with lazy=True the GSettings is only "
+     "created by the first call that needs it"}, 
+    {"new_with_path", (PyCFunction) m_new_with_path, 
+     METH_VARARGS | METH_KEYWORDS, 
+     "Deepin GSettings Construction with path, lazy as for new()"}, 
+    {"handle_cache_info", (PyCFunction) m_handle_cache_info, METH_NOARGS, 
+     "Lists the cached GSettings handles as (schema_id, path, objects)"}, 
+    {"clear_handle_cache", (PyCFunction) m_clear_handle_cache, METH_NOARGS, 
+     "Releases the cached handles no object uses any more"}, 
+    {"start_dispatcher", (PyCFunction) m_start_dispatcher, 
+     METH_VARARGS | METH_KEYWORDS, 
+     "Runs a background thread that delivers the signals of objects created "
+     "afterwards, with queue=True they wait for wait_changes() instead"}, 
+    {"stop_dispatcher", (PyCFunction) m_stop_dispatcher, METH_NOARGS, 
+     "Stops the dispatcher thread after running its pending flushes and "
+     "deliveries. Objects created while it ran get no more signals"}, 
+    {"changes_fd", (PyCFunction) m_changes_fd, METH_NOARGS, 
+     "File descriptor that polls readable while changes are queued"}, 
+    {"wait_changes", (PyCFunction) m_wait_changes, METH_VARARGS, 
+     "Waits up to timeout seconds for queued changes of keys something "
+     "listens to, runs their callbacks and returns them as (schema_id, "
+     "path, key) tuples"}, 
+    {"wait_writes", (PyCFunction) m_wait_writes, METH_NOARGS, 
+     "Waits until every write queued by set_value_async() or apply_async() "
+     "has reached the backend"}, 
+    {"preload", (PyCFunction) m_preload, METH_O, 
+     "Looks the given schemas up and loads the GSettings backend in a "
+     "background thread, so that objects created later start faster. A "
+     "loaded snapshot is kept"}, 
+    {"wait_preload", (PyCFunction) m_wait_preload, METH_NOARGS, 
+     "Waits until every preload() has finished"}, 
+    {"save_snapshot", (PyCFunction) m_save_snapshot, METH_VARARGS, 
+     "Writes every key of the given schema ids or (schema_id, path) pairs "
+     "to a snapshot file"}, 
+    {"load_snapshot", (PyCFunction) m_load_snapshot, METH_O, 
+     "Maps a snapshot file that lazy objects read from until the backend is "
+     "loaded, returns False when it is missing or stale"}, 
+    {"drop_snapshot", (PyCFunction) m_drop_snapshot, METH_NOARGS, 
+     "Sends every read to the backend again, returns whether a snapshot was "
+     "loaded"}, 
+    {"start_recording", (PyCFunction) m_start_recording, 
+     METH_VARARGS | METH_KEYWORDS, 
+     "Records every change heard by a handle into filename, or into a ring "
+     "of capacity bytes, returns False when already recording"}, 
+    {"stop_recording", (PyCFunction) m_stop_recording, METH_NOARGS, 
+     "Ends the recording, returns the ring's recording as bytes. Raises "
+     "OSError when writing the file failed, which ended the recording "
+     "there"}, 
+    {"read_recording", (PyCFunction) m_read_recording, METH_O, 
+     "Gets the (seconds, schema_id, path, key, value) changes of a recording "
+     "file or bytes"}, 
+    {"enable_stats", (PyCFunction) m_enable_stats, METH_O, 
+     "Turns call counters and latency histograms on or off, returns whether "
+     "they were on. DEEPIN_GSETTINGS_STATS in the environment turns them on "
+     "at import"}, 
+    {"stats", (PyCFunction) m_stats, METH_NOARGS, 
+     "Gets calls, total nanoseconds and the (upper bound ns, calls) "
+     "histogram buckets of every probe, and the writes \"diff\" handlers "
+     "did not get because the value was the last one they got"}, 
+    {"reset_stats", (PyCFunction) m_reset_stats, METH_NOARGS, 
+     "Zeroes the counters and histograms returned by stats()"}, 
+    {"collection", (PyCFunction) m_collection, METH_VARARGS, 
+     "Gets a collection of the paths of a relocatable schema, sharing one "
+     "key table and one change router"}, 
+    {"group", (PyCFunction) m_group, METH_O, 
+     "Gets a group of the given schema ids or (schema_id, path) pairs, "
+     "written in one batch with one sync, read in one pass, and watched "
+     "through one list of (tag, key) changes"}, 
     {NULL, NULL, 0, NULL}
 };
 
@@ -59,586 +485,5683 @@ static char m_get_value_doc[] = "Gets the value that is stored at key in "
                                 "settings";
 static char m_set_value_doc[] = "Sets key in settings to value";
 
-static PyObject *m_delete(DeepinGSettingsObject *self);
-static PyObject *m_connect(DeepinGSettingsObject *self, PyObject *args);
-static PyObject *m_reset(DeepinGSettingsObject *self, PyObject *args);
-static PyObject *m_list_keys(DeepinGSettingsObject *self);
-static PyObject *m_get_boolean(DeepinGSettingsObject *self, PyObject *args);
-static PyObject *m_set_boolean(DeepinGSettingsObject *self, PyObject *args);
-static PyObject *m_get_int(DeepinGSettingsObject *self, PyObject *args);
-static PyObject *m_set_int(DeepinGSettingsObject *self, PyObject *args);
-static PyObject *m_get_uint(DeepinGSettingsObject *self, PyObject *args);
-static PyObject *m_set_uint(DeepinGSettingsObject *self, PyObject *args);
-static PyObject *m_get_double(DeepinGSettingsObject *self, PyObject *args);
-static PyObject *m_set_double(DeepinGSettingsObject *self, PyObject *args);
-static PyObject *m_get_string(DeepinGSettingsObject *self, PyObject *args);
-static PyObject *m_set_string(DeepinGSettingsObject *self, PyObject *args);
-static PyObject *m_get_strv(DeepinGSettingsObject *self, PyObject *args);
-static PyObject *m_set_strv(DeepinGSettingsObject *self, PyObject *args);
+static PyObject *m_delete(DeepinGSettingsObject *self, 
+                          PyObject *Py_UNUSED(ignored));
+static PyObject *m_set_sync_policy(DeepinGSettingsObject *self, 
+                                   PyObject *args);
+static PyObject *m_get_sync_policy(DeepinGSettingsObject *self, 
+                                   PyObject *Py_UNUSED(ignored));
+static PyObject *m_flush(DeepinGSettingsObject *self, 
+                         PyObject *Py_UNUSED(ignored));
+static PyObject *m_batch(DeepinGSettingsObject *self, 
+                         PyObject *Py_UNUSED(ignored));
+static PyObject *m_set_many(DeepinGSettingsObject *self, PyObject *args);
+static PyObject *m_set_value_async(DeepinGSettingsObject *self, 
+                                   PyObject *const *args, 
+                                   Py_ssize_t nargs);
+static PyObject *m_apply_async(DeepinGSettingsObject *self, PyObject *values);
+static PyObject *m_set_read_cache(DeepinGSettingsObject *self, PyObject *args);
+static PyObject *m_read_cache_stats(DeepinGSettingsObject *self, 
+                                    PyObject *Py_UNUSED(ignored));
+static PyObject *m_object_stats(DeepinGSettingsObject *self, 
+                                PyObject *Py_UNUSED(ignored));
+static PyObject *m_object_reset_stats(DeepinGSettingsObject *self, 
+                                      PyObject *Py_UNUSED(ignored));
+static PyObject *m_connect(DeepinGSettingsObject *self, PyObject *args);
+static PyObject *m_disconnect(DeepinGSettingsObject *self, PyObject *args);
+static PyObject *m_set_changes_interval(DeepinGSettingsObject *self, 
+                                        PyObject *args);
+static PyObject *m_reset(DeepinGSettingsObject *self, PyObject *key);
+static PyObject *m_list_keys(DeepinGSettingsObject *self, 
+                             PyObject *Py_UNUSED(ignored));
+static PyObject *m_snapshot(DeepinGSettingsObject *self, 
+                            PyObject *args, 
+                            PyObject *kwds);
+static PyObject *m_get_value(DeepinGSettingsObject *self, PyObject *key);
+static PyObject *m_get_default(DeepinGSettingsObject *self, PyObject *key);
+static PyObject *m_set_value(DeepinGSettingsObject *self, 
+                             PyObject *const *args, 
+                             Py_ssize_t nargs);
+static PyObject *m_get_boolean(DeepinGSettingsObject *self, PyObject *key);
+static PyObject *m_set_boolean(DeepinGSettingsObject *self, 
+                               PyObject *const *args, 
+                               Py_ssize_t nargs);
+static PyObject *m_get_int(DeepinGSettingsObject *self, PyObject *key);
+static PyObject *m_set_int(DeepinGSettingsObject *self, 
+                           PyObject *const *args, 
+                           Py_ssize_t nargs);
+static PyObject *m_get_uint(DeepinGSettingsObject *self, PyObject *key);
+static PyObject *m_set_uint(DeepinGSettingsObject *self, 
+                            PyObject *const *args, 
+                            Py_ssize_t nargs);
+static PyObject *m_get_double(DeepinGSettingsObject *self, PyObject *key);
+static PyObject *m_set_double(DeepinGSettingsObject *self, 
+                              PyObject *const *args, 
+                              Py_ssize_t nargs);
+static PyObject *m_get_string(DeepinGSettingsObject *self, PyObject *key);
+static PyObject *m_set_string(DeepinGSettingsObject *self, 
+                              PyObject *const *args, 
+                              Py_ssize_t nargs);
+static PyObject *m_get_strv(DeepinGSettingsObject *self, PyObject *key);
+static PyObject *m_get_strv_tuple(DeepinGSettingsObject *self, PyObject *key);
+static PyObject *m_get_strv_list(DeepinGSettingsObject *self, PyObject *key);
+static PyObject *m_get_strv_interned(DeepinGSettingsObject *self, 
+                                     PyObject *key);
+static PyObject *m_set_strv(DeepinGSettingsObject *self, 
+                            PyObject *const *args, 
+                            Py_ssize_t nargs);
+static gboolean m_check_nargs(const char *name, 
+                              Py_ssize_t nargs, 
+                              Py_ssize_t expected);
+static gboolean m_realize(DeepinGSettingsObject *self);
+static void m_free_schema_info(gpointer data);
+static gpointer m_write_lock_gil(void);
+static void m_write_unlock_gil(gpointer token);
+
+static PyMethodDef deepin_gsettings_object_methods[] = 
+{
+    {"delete", (PyCFunction) m_delete, 
+     METH_NOARGS, "Deepin GSettings Object Destruction"}, 
+    {"set_sync_policy", (PyCFunction) m_set_sync_policy, METH_VARARGS, 
+     "Sets when writes reach the backend: SYNC_IMMEDIATE, SYNC_DEFERRED "
+     "with an optional flush delay in milliseconds, or SYNC_MANUAL"}, 
+    {"get_sync_policy", (PyCFunction) m_get_sync_policy, METH_NOARGS, 
+     "Gets the current sync policy"}, 
+    {"flush", (PyCFunction) m_flush, METH_NOARGS, 
+     "Writes all pending values to the backend and syncs"}, 
+    {"batch", (PyCFunction) m_batch, METH_NOARGS, 
+     "Context manager that applies every write made inside it at once, "
+     "or reverts them all if the block raises"}, 
+    {"set_many", (PyCFunction) m_set_many, METH_VARARGS, 
+     "Sets every key of a {key: value} dict in one batch"}, 
+    {"set_value_async", (PyCFunction) m_set_value_async, METH_FASTCALL, 
+     "Queues key = value for a background writer and returns a "
+     "concurrent.futures.Future of whether the backend took it, asyncio "
+     "code awaits asyncio.wrap_future() of it"}, 
+    {"apply_async", (PyCFunction) m_apply_async, METH_O, 
+     "Queues every key of a {key: value} dict like set_value_async(), the "
+     "future is False and nothing is written unless all of them can be"}, 
+    {"set_read_cache", (PyCFunction) m_set_read_cache, METH_VARARGS, 
+     "Enables or disables caching getter results per key, entries are "
+     "dropped on writes and on the \"changed\" signal, so values changed "
+     "elsewhere are only seen while a main loop delivers signals"}, 
+    {"read_cache_stats", (PyCFunction) m_read_cache_stats, METH_NOARGS, 
+     "Gets the read cache hits, misses and size"}, 
+    {"stats", (PyCFunction) m_object_stats, METH_NOARGS, 
+     "Gets the calls to each probe and to each key made through this "
+     "object, and the callbacks it ran, counted while stats are enabled"}, 
+    {"reset_stats", (PyCFunction) m_object_reset_stats, METH_NOARGS, 
+     "Zeroes the counters returned by stats()"}, 
+    {"connect", (PyCFunction) m_connect, METH_VARARGS, 
+     "Connects a callback to \"changed\", \"changed::key\", "
+     "\"change-event\", \"changes\", \"diff\" or \"diff::key\" and "
+     "returns its handler id. \"diff\" callbacks get (key, old, new) and "
+     "are not called for writes of the value they last got"}, 
+    {"set_changes_interval", (PyCFunction) m_set_changes_interval, 
+     METH_VARARGS, 
+     "Sets the minimum milliseconds between two \"changes\" deliveries, "
+     "0 delivers on the next idle"}, 
+    {"disconnect", (PyCFunction) m_disconnect, METH_VARARGS, 
+     "Disconnects the callback with the given handler id"}, 
+    {"reset", (PyCFunction) m_reset, METH_O, "Resets key to its default value"}, 
+    {"list_keys", (PyCFunction) m_list_keys, METH_NOARGS, 
+     "Introspects the list of keys on settings"}, 
+    {"snapshot", (PyCFunction) m_snapshot, METH_VARARGS | METH_KEYWORDS, 
+     "Returns a dict of every key, or of the given keys, to its value"}, 
+    {"get_value", (PyCFunction) m_get_value, METH_O, 
+     "Gets the value of key as the Python value matching its GSettings type"}, 
+    {"get_default", (PyCFunction) m_get_default, METH_O, 
+     "Gets the schema default of key, whatever is stored"}, 
+    {"set_value", (PyCFunction) m_set_value, METH_FASTCALL, 
+     "Sets key from a Python value matching its GSettings type"}, 
+    {"get_boolean", (PyCFunction) m_get_boolean, METH_O, m_get_value_doc}, 
+    {"set_boolean", (PyCFunction) m_set_boolean, METH_FASTCALL, m_set_value_doc}, 
+    {"get_int", (PyCFunction) m_get_int, METH_O, m_get_value_doc}, 
+    {"set_int", (PyCFunction) m_set_int, METH_FASTCALL, m_set_value_doc}, 
+    {"get_uint", (PyCFunction) m_get_uint, METH_O, m_get_value_doc}, 
+    {"set_uint", (PyCFunction) m_set_uint, METH_FASTCALL, m_set_value_doc}, 
+    {"get_double", (PyCFunction) m_get_double, METH_O, m_get_value_doc}, 
+    {"set_double", (PyCFunction) m_set_double, METH_FASTCALL, m_set_value_doc}, 
+    {"get_string", (PyCFunction) m_get_string, METH_O, m_get_value_doc}, 
+    {"set_string", (PyCFunction) m_set_string, METH_FASTCALL, m_set_value_doc}, 
+    {"get_strv", (PyCFunction) m_get_strv, METH_O, m_get_value_doc}, 
+    {"get_strv_tuple", (PyCFunction) m_get_strv_tuple, METH_O, 
+     "Gets a string array key as a tuple of interned strings"}, 
+    {"set_strv", (PyCFunction) m_set_strv, METH_FASTCALL, m_set_value_doc}, 
+    {NULL, NULL, 0, NULL}
+};
+
+static void m_deepin_gsettings_dealloc(DeepinGSettingsObject *self) 
+{
+    PyObject_GC_UnTrack(self);
+    Py_TRASHCAN_BEGIN(self, m_deepin_gsettings_dealloc)
+
+    if (self->weakreflist)
+        PyObject_ClearWeakRefs((PyObject *) self);
+    ZAP(self->dict);
+    Py_XDECREF(m_delete(self, NULL));
+    ZAP(self->module);
+    g_free(self->stat_calls);
+    g_free(self->key_calls);
+
+    PyObject_GC_Del(self);
+    Py_TRASHCAN_END
+}
+
+static int m_deepin_gsettings_traverse(DeepinGSettingsObject *self, 
+                                       visitproc visit, 
+                                       void *args) 
+{
+    guint i;
+    int err;
+#undef VISIT
+#define VISIT(v)    if ((v) != NULL && ((err = visit(v, args)) != 0)) return err
+
+    VISIT(self->dict);
+    VISIT(self->module);
+    for (i = 0; self->handlers && i < self->handlers->len; i++)
+        VISIT(g_array_index(self->handlers, SignalHandler, i).callback);
+    VISIT(self->value_cache);
+
+    return 0;
+#undef VISIT
+}
+
+static int m_deepin_gsettings_clear(DeepinGSettingsObject *self) 
+{
+    ZAP(self->dict);
+    m_clear_handlers(self);
+    ZAP(self->value_cache);
+    m_update_listening(self);
+    return 0;
+}
+
+/* Methods live in tp_methods and instance attributes in the dict found 
+ * through tp_dictoffset, so attribute access goes through the generic 
+ * lookup and its type attribute cache
+ */
+static PyTypeObject DeepinGSettings_Type = {
+    PyVarObject_HEAD_INIT(NULL, 0)
+    "deepin_gsettings.new", 
+    sizeof(DeepinGSettingsObject), 
+    0, 
+    (destructor)m_deepin_gsettings_dealloc,
+    0, 
+    0, 
+    0, 
+    0, 
+    0, 
+    0,  
+    0,  
+    0,  
+    0,  
+    0,  
+    0,  
+    PyObject_GenericGetAttr, 
+    PyObject_GenericSetAttr, 
+    0,  
+    Py_TPFLAGS_DEFAULT | Py_TPFLAGS_HAVE_GC,
+    0,  
+    (traverseproc)m_deepin_gsettings_traverse, 
+    (inquiry)m_deepin_gsettings_clear, 
+    0, 
+    offsetof(DeepinGSettingsObject, weakreflist), 
+    0, 
+    0, 
+    deepin_gsettings_object_methods, 
+    0, 
+    0, 
+    0, 
+    0, 
+    0, 
+    0, 
+    offsetof(DeepinGSettingsObject, dict)
+};
+
+static PyObject *m_batch_enter(DeepinGSettingsBatchObject *self, 
+                               PyObject *Py_UNUSED(ignored));
+static PyObject *m_batch_exit(DeepinGSettingsBatchObject *self, 
+                              PyObject *args);
+
+static PyMethodDef deepin_gsettings_batch_methods[] = 
+{
+    {"__enter__", (PyCFunction) m_batch_enter, 
+     METH_NOARGS, "Begins the batch"}, 
+    {"__exit__", (PyCFunction) m_batch_exit, METH_VARARGS, 
+     "Applies the batch, or reverts it when leaving on an exception"}, 
+    {NULL, NULL, 0, NULL}
+};
+
+static void m_batch_dealloc(DeepinGSettingsBatchObject *self) 
+{
+    PyObject_GC_UnTrack(self);
+    ZAP(self->settings);
+    PyObject_GC_Del(self);
+}
+
+static int m_batch_traverse(DeepinGSettingsBatchObject *self, 
+                            visitproc visit, 
+                            void *arg) 
+{
+    Py_VISIT(self->settings);
+    return 0;
+}
+
+static int m_batch_clear(DeepinGSettingsBatchObject *self) 
+{
+    ZAP(self->settings);
+    return 0;
+}
+
+/* with statement looks __enter__/__exit__ up on the type */
+static PyTypeObject DeepinGSettingsBatch_Type = {
+    PyVarObject_HEAD_INIT(NULL, 0)
+    "deepin_gsettings.batch", 
+    sizeof(DeepinGSettingsBatchObject), 
+    0, 
+    (destructor)m_batch_dealloc, 
+    0, 
+    0, 
+    0, 
+    0, 
+    0, 
+    0, 
+    0, 
+    0, 
+    0, 
+    0, 
+    0, 
+    0, 
+    0, 
+    0, 
+    Py_TPFLAGS_DEFAULT | Py_TPFLAGS_HAVE_GC, 
+    0, 
+    (traverseproc)m_batch_traverse, 
+    (inquiry)m_batch_clear, 
+    0, 
+    0, 
+    0, 
+    0, 
+    deepin_gsettings_batch_methods
+};
+
+static PyObject *m_collection_get(DeepinGSettingsCollectionObject *self, 
+                                   PyObject *const *args, 
+                                   Py_ssize_t nargs);
+static PyObject *m_collection_set(DeepinGSettingsCollectionObject *self, 
+                                   PyObject *const *args, 
+                                   Py_ssize_t nargs);
+static PyObject *m_collection_get_many(DeepinGSettingsCollectionObject *self, 
+                                       PyObject *const *args, 
+                                       Py_ssize_t nargs);
+static PyObject *m_collection_snapshot(DeepinGSettingsCollectionObject *self, 
+                                       PyObject *path);
+static PyObject *m_collection_connect(DeepinGSettingsCollectionObject *self, 
+                                      PyObject *args, 
+                                      PyObject *kwds);
+static PyObject *m_collection_disconnect(DeepinGSettingsCollectionObject *self, 
+                                         PyObject *id);
+static PyObject *m_collection_list_keys(DeepinGSettingsCollectionObject *self, 
+                                        PyObject *Py_UNUSED(ignored));
+static PyObject *m_collection_paths(DeepinGSettingsCollectionObject *self, 
+                                    PyObject *Py_UNUSED(ignored));
+static PyObject *m_collection_discard(DeepinGSettingsCollectionObject *self, 
+                                      PyObject *path);
+static void m_collection_dealloc(DeepinGSettingsCollectionObject *self);
+static int m_collection_traverse(DeepinGSettingsCollectionObject *self, 
+                                 visitproc visit, 
+                                 void *arg);
+static int m_collection_clear(DeepinGSettingsCollectionObject *self);
+
+static PyMethodDef deepin_gsettings_collection_methods[] = 
+{
+    {"get", (PyCFunction) m_collection_get, METH_FASTCALL, 
+     "Gets key at path"}, 
+    {"set", (PyCFunction) m_collection_set, METH_FASTCALL, 
+     "Sets key at path to value and syncs, one backend round trip per "
+     "call: bursts of writes are cheaper through new_with_path() objects "
+     "with a deferred sync policy"}, 
+    {"get_many", (PyCFunction) m_collection_get_many, METH_FASTCALL, 
+     "Gets key at each of a sequence of paths, as a list in the same "
+     "order. Paths without a GSettings are read without keeping one"}, 
+    {"snapshot", (PyCFunction) m_collection_snapshot, METH_O, 
+     "Returns a dict of every key at path to its value, without keeping a "
+     "GSettings for a path that has none"}, 
+    {"connect", (PyCFunction) m_collection_connect, 
+     METH_VARARGS | METH_KEYWORDS, 
+     "Calls callback(path, key) for changes under the paths starting with "
+     "prefix that this collection has used, returns its handler id"}, 
+    {"disconnect", (PyCFunction) m_collection_disconnect, METH_O, 
+     "Disconnects the callback with the given handler id"}, 
+    {"list_keys", (PyCFunction) m_collection_list_keys, METH_NOARGS, 
+     "Introspects the list of keys of the schema"}, 
+    {"paths", (PyCFunction) m_collection_paths, METH_NOARGS, 
+     "Lists the paths that have a GSettings in this collection"}, 
+    {"discard", (PyCFunction) m_collection_discard, METH_O, 
+     "Releases the GSettings of path, its changes are no longer reported"}, 
+    {NULL, NULL, 0, NULL}
+};
+
+static PyTypeObject DeepinGSettingsCollection_Type = {
+    PyVarObject_HEAD_INIT(NULL, 0)
+    "deepin_gsettings.collection", 
+    sizeof(DeepinGSettingsCollectionObject), 
+    0, 
+    (destructor)m_collection_dealloc, 
+    0, 
+    0, 
+    0, 
+    0, 
+    0, 
+    0, 
+    0, 
+    0, 
+    0, 
+    0, 
+    0, 
+    0, 
+    0, 
+    0, 
+    Py_TPFLAGS_DEFAULT | Py_TPFLAGS_HAVE_GC, 
+    0, 
+    (traverseproc)m_collection_traverse, 
+    (inquiry)m_collection_clear, 
+    0, 
+    offsetof(DeepinGSettingsCollectionObject, weakreflist), 
+    0, 
+    0, 
+    deepin_gsettings_collection_methods
+};
+
+static PyObject *m_group_enter(DeepinGSettingsGroupObject *self, 
+                               PyObject *Py_UNUSED(ignored));
+static PyObject *m_group_exit(DeepinGSettingsGroupObject *self, 
+                              PyObject *args);
+static PyObject *m_group_apply(DeepinGSettingsGroupObject *self, 
+                               PyObject *changes);
+static PyObject *m_group_snapshot(DeepinGSettingsGroupObject *self, 
+                                  PyObject *Py_UNUSED(ignored));
+static PyObject *m_group_member(DeepinGSettingsGroupObject *self, 
+                                PyObject *tag);
+static PyObject *m_group_tags(DeepinGSettingsGroupObject *self, 
+                              PyObject *Py_UNUSED(ignored));
+static PyObject *m_group_connect(DeepinGSettingsGroupObject *self, 
+                                 PyObject *callback);
+static PyObject *m_group_disconnect(DeepinGSettingsGroupObject *self, 
+                                    PyObject *id);
+static void m_group_dealloc(DeepinGSettingsGroupObject *self);
+static int m_group_traverse(DeepinGSettingsGroupObject *self, 
+                            visitproc visit, 
+                            void *arg);
+static int m_group_clear(DeepinGSettingsGroupObject *self);
+
+static PyMethodDef deepin_gsettings_group_methods[] = 
+{
+    {"__enter__", (PyCFunction) m_group_enter, METH_NOARGS, 
+     "Begins a batch on every member"}, 
+    {"__exit__", (PyCFunction) m_group_exit, METH_VARARGS, 
+     "Applies the batches of all members with one sync, or reverts them "
+     "all when leaving on an exception"}, 
+    {"apply", (PyCFunction) m_group_apply, METH_O, 
+     "Writes a dict of tag to a dict of key to value as one batch with one "
+     "sync, nothing is written when a value is refused"}, 
+    {"snapshot", (PyCFunction) m_group_snapshot, METH_NOARGS, 
+     "Returns a dict of tag to a dict of every key of the member to its "
+     "value"}, 
+    {"member", (PyCFunction) m_group_member, METH_O, 
+     "Gets the object of the member with the given tag"}, 
+    {"tags", (PyCFunction) m_group_tags, METH_NOARGS, 
+     "Lists the tags of the members, in order"}, 
+    {"connect", (PyCFunction) m_group_connect, METH_O, 
+     "Calls callback with the list of (tag, key) changes of all members, "
+     "each listed once, returns its handler id"}, 
+    {"disconnect", (PyCFunction) m_group_disconnect, METH_O, 
+     "Disconnects the callback with the given handler id"}, 
+    {NULL, NULL, 0, NULL}
+};
+
+static PyTypeObject DeepinGSettingsGroup_Type = {
+    PyVarObject_HEAD_INIT(NULL, 0)
+    "deepin_gsettings.group", 
+    sizeof(DeepinGSettingsGroupObject), 
+    0, 
+    (destructor)m_group_dealloc, 
+    0, 
+    0, 
+    0, 
+    0, 
+    0, 
+    0, 
+    0, 
+    0, 
+    0, 
+    0, 
+    0, 
+    0, 
+    0, 
+    0, 
+    Py_TPFLAGS_DEFAULT | Py_TPFLAGS_HAVE_GC, 
+    0, 
+    (traverseproc)m_group_traverse, 
+    (inquiry)m_group_clear, 
+    0, 
+    offsetof(DeepinGSettingsGroupObject, weakreflist), 
+    0, 
+    0, 
+    deepin_gsettings_group_methods
+};
+
+static ModuleState *m_get_state(PyObject *module) 
+{
+    return (ModuleState *) PyModule_GetState(module);
+}
+
+static int m_module_traverse(PyObject *module, visitproc visit, void *arg) 
+{
+    Py_VISIT(m_get_state(module)->future_type);
+    return 0;
+}
+
+static int m_module_clear(PyObject *module) 
+{
+    Py_CLEAR(m_get_state(module)->future_type);
+    return 0;
+}
+
+/* Every object holds the module, so no entry or key table is in use here */
+static void m_module_free(void *module) 
+{
+    ModuleState *state = m_get_state((PyObject *) module);
+
+    m_module_clear((PyObject *) module);
+    if (state->settings_cache) {
+        g_hash_table_destroy(state->settings_cache);
+        state->settings_cache = NULL;
+    }
+    if (state->schema_cache) {
+        g_hash_table_destroy(state->schema_cache);
+        state->schema_cache = NULL;
+    }
+}
+
+static struct PyModuleDef deepin_gsettings_module = {
+    PyModuleDef_HEAD_INIT, 
+    "deepin_gsettings", 
+    NULL, 
+    sizeof(ModuleState), 
+    deepin_gsettings_methods, 
+    NULL, 
+    m_module_traverse, 
+    m_module_clear, 
+    m_module_free
+};
+
+/* Runs the module function name from atexit, before finalization */
+static gboolean m_register_at_exit(PyObject *module, const char *name) 
+{
+    PyObject *atexit = PyImport_ImportModule("atexit");
+    PyObject *func = NULL;
+    PyObject *ret = NULL;
+
+    if (!atexit)
+        return FALSE;
+
+    func = PyObject_GetAttrString(module, name);
+    if (func)
+        ret = PyObject_CallMethod(atexit, "register", "O", func);
+    Py_XDECREF(func);
+    Py_DECREF(atexit);
+    Py_XDECREF(ret);
+
+    return ret != NULL;
+}
+
+PyMODINIT_FUNC PyInit_deepin_gsettings(void) 
+{
+    PyObject *m = NULL;
+    ModuleState *state = NULL;
+
+    if (PyType_Ready(&DeepinGSettings_Type) < 0)
+        return NULL;
+
+    if (PyType_Ready(&DeepinGSettingsBatch_Type) < 0)
+        return NULL;
+
+    if (PyType_Ready(&DeepinGSettingsCollection_Type) < 0)
+        return NULL;
+
+    if (PyType_Ready(&DeepinGSettingsGroup_Type) < 0)
+        return NULL;
+
+    m = PyModule_Create(&deepin_gsettings_module);
+    if (!m)
+        return NULL;
+
+    state = m_get_state(m);
+    state->settings_type = &DeepinGSettings_Type;
+    state->batch_type = &DeepinGSettingsBatch_Type;
+    state->collection_type = &DeepinGSettingsCollection_Type;
+    state->group_type = &DeepinGSettingsGroup_Type;
+    state->settings_cache = g_hash_table_new(NULL, NULL);
+    state->schema_cache = g_hash_table_new_full(g_str_hash, 
+                                                g_str_equal, 
+                                                g_free, 
+                                                m_free_schema_info);
+    state->last_handler_id = 0;
+    state->stats_enabled = g_getenv("DEEPIN_GSETTINGS_STATS") != NULL;
+
+    deepin_gsettings_set_callback_lock(m_write_lock_gil, m_write_unlock_gil);
+    deepin_gsettings_set_sync_func(m_sync_cb, state);
+
+    PyModule_AddIntConstant(m, "SYNC_IMMEDIATE", SYNC_IMMEDIATE);
+    PyModule_AddIntConstant(m, "SYNC_DEFERRED", SYNC_DEFERRED);
+    PyModule_AddIntConstant(m, "SYNC_MANUAL", SYNC_MANUAL);
+
+    /* The write worker and preload threads need the GIL to finish */
+    if (!m_register_at_exit(m, "wait_writes") || 
+        !m_register_at_exit(m, "wait_preload")) {
+        Py_DECREF(m);
+        return NULL;
+    }
+
+    return m;
+}
+
+static DeepinGSettingsObject *m_init_deepin_gsettings_object(PyObject *module) 
+{
+    DeepinGSettingsObject *self = NULL;
+
+    self = (DeepinGSettingsObject *) PyObject_GC_New(
+        DeepinGSettingsObject, m_get_state(module)->settings_type);
+    if (!self)
+        return NULL;
+    PyObject_GC_Track(self);
+
+    self->dict = NULL;
+    self->weakreflist = NULL;
+    Py_INCREF(module);
+    self->module = module;
+    self->handle = NULL;
+    self->entry = NULL;
+    self->lazy_schema_id = NULL;
+    self->lazy_path = NULL;
+    self->listening = FALSE;
+    self->listening_events = FALSE;
+    self->listening_diffs = FALSE;
+    self->handlers = NULL;
+    self->changes = NULL;
+    self->changes_id = 0;
+    self->changes_interval = 0;
+    self->sync_policy = SYNC_IMMEDIATE;
+    self->sync_interval = 0;
+    self->writer = NULL;
+    self->batch_handle = NULL;
+    self->batch_depth = 0;
+    self->batch_failed = FALSE;
+    self->value_cache = NULL;
+    self->cache_generation = 0;
+    self->cache_dirty = 0;
+    self->cache_hits = 0;
+    self->cache_misses = 0;
+    self->stat_calls = NULL;
+    self->key_calls = NULL;
+    self->callbacks = 0;
+
+    return self;
+}
+
+static gboolean m_stats_enabled(ModuleState *state) 
+{
+    return state && g_atomic_int_get(&state->stats_enabled);
+}
+
+static gint64 m_stats_clock(void) 
+{
+    struct timespec ts;
+
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec * G_GINT64_CONSTANT(1000000000) + ts.tv_nsec;
+}
+
+/* Start of a probe, 0 when stats are off so that the end is skipped too. 
+ * Callable without the GIL
+ */
+static gint64 m_stats_begin(ModuleState *state) 
+{
+    if (!m_stats_enabled(state))
+        return 0;
+
+    return m_stats_clock();
+}
+
+static void m_stats_end(ModuleState *state, int probe, gint64 start) 
+{
+    Histogram *histogram = NULL;
+    guint64 elapsed;
+
+    if (!start)
+        return;
+
+    histogram = &state->stats[probe];
+    elapsed = m_stats_clock() - start;
+    STAT_ADD(histogram->calls, 1);
+    STAT_ADD(histogram->total_ns, elapsed);
+    STAT_ADD(histogram->buckets[MIN(g_bit_storage(elapsed), STAT_BUCKETS - 1)], 
+             1);
+}
+
+/* End of an entry point probe, also counted for the object and for key, 
+ * the key argument or NULL. GIL held
+ */
+static void m_stats_call(DeepinGSettingsObject *self, 
+                         int probe, 
+                         PyObject *key, 
+                         gint64 start) 
+{
+    PyObject *position = NULL;
+
+    if (!start)
+        return;
+
+    m_stats_end(m_get_state(self->module), probe, start);
+
+    if (!self->stat_calls)
+        self->stat_calls = g_new0(guint64, STAT_COUNT);
+    STAT_ADD(self->stat_calls[probe], 1);
+
+    /* Keeps a failed call's exception, unknown keys are just not counted */
+    position = key && self->entry ? 
+        PyDict_GetItem(self->entry->info->index, key) : NULL;
+    if (!position)
+        return;
+
+    if (!self->key_calls)
+        self->key_calls = g_new0(guint64, self->entry->info->n_keys);
+    STAT_ADD(self->key_calls[PyLong_AsSsize_t(position)], 1);
+}
+
+/* Returns expr from an entry point, timed as probe when stats are on */
+#define STATS_RETURN(self, probe, key, expr) do { \
+    gint64 start_ = m_stats_begin(m_get_state((self)->module)); \
+    PyObject *ret_ = (expr); \
+    m_stats_call((self), (probe), (key), start_); \
+    return ret_; \
+} while (0)
+
+/* Counts n Python callbacks run for self, GIL held */
+static void m_stats_callbacks(DeepinGSettingsObject *self, Py_ssize_t n) 
+{
+    if (m_stats_enabled(m_get_state(self->module)))
+        STAT_ADD(self->callbacks, n);
+}
+
+/* NULL key drops every entry */
+static void m_cache_invalidate(DeepinGSettingsObject *self, const gchar *key) 
+{
+    if (!self->value_cache)
+        return;
+
+    self->cache_generation++;
+
+    if (!key)
+        PyDict_Clear(self->value_cache);
+    else if (PyDict_DelItemString(self->value_cache, key) < 0)
+        PyErr_Clear();
+}
+
+/* Borrowed cached value for the key argument of a getter of type, or 
+ * NULL. The generation tells m_cache_store whether the key was invalidated 
+ * while the value was being read without the GIL
+ */
+static PyObject *m_cache_lookup(DeepinGSettingsObject *self, 
+                                PyObject *key, 
+                                const GVariantType *type, 
+                                guint *generation) 
+{
+    PyObject *item = NULL;
+    PyObject *value = NULL;
+    gint dirty = 0;
+
+    /* Queued changes reach the cache when wait_changes() runs, until then 
+     * any of them makes every entry stale
+     */
+    if (self->value_cache && self->entry) {
+        dirty = g_atomic_int_get(&self->entry->dirty);
+        if (dirty != self->cache_dirty) {
+            m_cache_invalidate(self, NULL);
+            self->cache_dirty = dirty;
+        }
+    }
+
+    *generation = self->cache_generation;
+
+    /* Reads inside a batch see uncommitted values, keep them out */
+    if (!self->value_cache || self->batch_depth)
+        return NULL;
+
+    /* Entries are (type, value) and keyed by name only, a getter of 
+     * another type misses and reads the key as it would uncached
+     */
+    item = PyDict_GetItem(self->value_cache, key);
+    if (item && 
+        PyLong_AsLong(PyTuple_GET_ITEM(item, 0)) == 
+        g_variant_type_peek_string(type)[0])
+        value = PyTuple_GET_ITEM(item, 1);
+    if (value)
+        self->cache_hits++;
+    else
+        self->cache_misses++;
+
+    return value;
+}
+
+/* Passes value through, caching it if nothing changed since the lookup */
+static PyObject *m_cache_store(DeepinGSettingsObject *self, 
+                               PyObject *key, 
+                               const GVariantType *type, 
+                               guint generation, 
+                               PyObject *value) 
+{
+    PyObject *item = NULL;
+
+    /* A lazy object hears no changes yet, it may have read the snapshot */
+    if (!value || !self->value_cache || self->batch_depth || 
+        self->lazy_schema_id || generation != self->cache_generation)
+        return value;
+    if (self->entry && 
+        g_atomic_int_get(&self->entry->dirty) != self->cache_dirty)
+        return value;
+
+    item = Py_BuildValue("(iO)", g_variant_type_peek_string(type)[0], value);
+    if (!item || PyDict_SetItem(self->value_cache, key, item) < 0)
+        PyErr_Clear();
+    Py_XDECREF(item);
+
+    return value;
+}
+
+/* Inside a batch reads go through the delayed handle so that they see the 
+ * values written so far
+ */
+static GSettings *m_read_handle(DeepinGSettingsObject *self) 
+{
+    if (self->batch_depth)
+        return self->batch_handle;
+
+    return self->handle;
+}
+
+/* The GIL is released around GIO calls, and m_delete may drop the object's 
+ * own reference from another thread meanwhile, so callers take their own
+ */
+static GSettings *m_ref_handle(GSettings *handle) 
+{
+    if (!handle)
+        return NULL;
+
+    return g_object_ref(handle);
+}
+
+/* New reference to the value written to key under SYNC_DEFERRED or 
+ * SYNC_MANUAL and not flushed yet, so that getters see their own writes
+ */
+static GVariant *m_pending_value(DeepinGSettingsObject *self, const gchar *key) 
+{
+    if (!self->writer)
+        return NULL;
+
+    return deepin_gsettings_writer_lookup(self->writer, key);
+}
+
+/* New reference to the current value of key, read without the GIL held */
+static GVariant *m_read_value(DeepinGSettingsObject *self, const gchar *key) 
+{
+    GVariant *value = m_pending_value(self, key);
+    GSettings *handle = NULL;
+
+    if (value)
+        return value;
+
+    handle = m_ref_handle(m_read_handle(self));
+    if (!handle) {
+        ERROR("deepin_gsettings object has been deleted");
+        return NULL;
+    }
+
+    Py_BEGIN_ALLOW_THREADS
+    value = g_settings_get_value(handle, key);
+    g_object_unref(handle);
+    Py_END_ALLOW_THREADS
+
+    return value;
+}
+
+static void m_remove_source(GSource **source) 
+{
+    if (!*source)
+        return;
+
+    g_source_destroy(*source);
+    g_source_unref(*source);
+    *source = NULL;
+}
+
+/* Handles are made by the library, in the dispatcher context once there 
+ * is one. Creating one there may wait for the dispatcher thread, so the 
+ * GIL is released then
+ */
+static GSettings *m_new_handle(const gchar *schema_id, 
+                               const gchar *path, 
+                               GSettingsSchema *schema) 
+{
+    GSettings *handle = NULL;
+
+    if (!deepin_gsettings_get_context())
+        return deepin_gsettings_new_handle(schema_id, path, schema);
+
+    Py_BEGIN_ALLOW_THREADS
+    handle = deepin_gsettings_new_handle(schema_id, path, schema);
+    Py_END_ALLOW_THREADS
+
+    return handle;
+}
+
+/* The library syncs for every write it makes, deferred flushes included */
+static void m_sync_cb(gpointer user_data) 
+{
+    ModuleState *state = (ModuleState *) user_data;
+    gint64 start = m_stats_begin(state);
+
+    g_settings_sync();
+    m_stats_end(state, STAT_SYNC, start);
+}
+
+static void m_flush_pending(DeepinGSettingsObject *self) 
+{
+    DeepinGSettingsWriter *writer = NULL;
+
+    if (!self->writer)
+        return;
+
+    /* A "changed" callback fired by the flush may write again */
+    writer = deepin_gsettings_writer_ref(self->writer);
+    Py_BEGIN_ALLOW_THREADS
+    deepin_gsettings_writer_flush(writer);
+    deepin_gsettings_writer_unref(writer);
+    Py_END_ALLOW_THREADS
+}
+
+/* Takes ownership of a floating value of the key's type. The object's 
+ * writer applies its sync policy. Values outside the schema's range, 
+ * choices or flags are refused here, before any backend is involved
+ */
+static gboolean m_write_value(DeepinGSettingsObject *self, 
+                              const KeyInfo *key_info, 
+                              GVariant *value) 
+{
+    const gchar *key = key_info->c_name;
+    DeepinGSettingsWriter *writer = NULL;
+    gboolean ret = FALSE;
+
+    g_variant_ref_sink(value);
+    if (key_info->ranged && 
+        !g_settings_schema_key_range_check(key_info->key, value)) {
+        g_variant_unref(value);
+        return FALSE;
+    }
+
+    m_cache_invalidate(self, key);
+
+    if (self->batch_depth) {
+        /* The batch supersedes an older queued write to the same key */
+        if (self->writer)
+            deepin_gsettings_writer_discard(self->writer, key);
+        ret = g_settings_set_value(self->batch_handle, key, value);
+        g_variant_unref(value);
+        return ret;
+    }
+
+    if (!self->writer) {
+        g_variant_unref(value);
+        return FALSE;
+    }
+
+    writer = deepin_gsettings_writer_ref(self->writer);
+    Py_BEGIN_ALLOW_THREADS
+    ret = deepin_gsettings_writer_write(writer, key, value);
+    deepin_gsettings_writer_unref(writer);
+    g_variant_unref(value);
+    Py_END_ALLOW_THREADS
+
+    return ret;
+}
+
+/* g_settings_delay() can not be undone, so batches write through a second, 
+ * permanently delayed GSettings on the same schema and path and only the 
+ * applied changeset reaches handle, as one backend write and one 
+ * "change-event"
+ */
+static gboolean m_begin_batch(DeepinGSettingsObject *self) 
+{
+    GSettingsSchema *schema = NULL;
+    gchar *path = NULL;
+
+    if (!m_realize(self))
+        return FALSE;
+
+    if (!self->handle) {
+        ERROR("batch on a deleted object");
+        return FALSE;
+    }
+
+    if (!self->batch_handle) {
+        g_object_get(self->handle, 
+                     "settings-schema", &schema, 
+                     "path", &path, 
+                     NULL);
+        self->batch_handle = m_new_handle(NULL, path, schema);
+        g_settings_schema_unref(schema);
+        g_free(path);
+        if (!self->batch_handle) {
+            ERROR("g_settings_new_full error");
+            return FALSE;
+        }
+        g_settings_delay(self->batch_handle);
+    }
+
+    if (!self->batch_depth++)
+        self->batch_failed = FALSE;
+
+    return TRUE;
+}
+
+/* Leaves one level of an open batch. Only the outermost level reverts a 
+ * failed batch or hands out a reference to the delayed handle to apply
+ */
+static GSettings *m_close_batch(DeepinGSettingsObject *self, gboolean commit) 
+{
+    if (!commit)
+        self->batch_failed = TRUE;
+
+    if (--self->batch_depth)
+        return NULL;
+
+    if (self->batch_failed) {
+        g_settings_revert(self->batch_handle);
+        return NULL;
+    }
+
+    return m_ref_handle(self->batch_handle);
+}
+
+/* Applies delayed handles in one pass without the GIL, then syncs at most 
+ * once. The references are taken over
+ */
+static void m_apply_batches(ModuleState *state, 
+                            GSettings **handles, 
+                            guint n_handles, 
+                            gboolean sync) 
+{
+    gint64 start = 0;
+    guint i;
+
+    Py_BEGIN_ALLOW_THREADS
+    start = m_stats_begin(state);
+    for (i = 0; i < n_handles; i++)
+        g_settings_apply(handles[i]);
+    if (sync)
+        g_settings_sync();
+    m_stats_end(state, STAT_SYNC, start);
+    for (i = 0; i < n_handles; i++)
+        g_object_unref(handles[i]);
+    Py_END_ALLOW_THREADS
+}
+
+/* Only the outermost batch applies, a failure at any depth reverts all */
+static gboolean m_end_batch(DeepinGSettingsObject *self, gboolean commit) 
+{
+    GSettings *batch_handle = NULL;
+
+    if (!self->batch_depth)
+        return FALSE;
+
+    batch_handle = m_close_batch(self, commit);
+    if (batch_handle)
+        m_apply_batches(m_get_state(self->module), 
+                        &batch_handle, 
+                        1, 
+                        self->sync_policy == SYNC_IMMEDIATE);
+
+    return !self->batch_failed;
+}
+
+/* Integer with range check for the integral GVariant type classes */
+static GVariant *m_object_to_integer(PyObject *obj, char type_char) 
+{
+    long long ll = 0;
+    unsigned long long ull = 0;
+
+    if (!PyLong_Check(obj)) {
+        PyErr_Format(PyExc_TypeError, 
+                     "invalid %s value for GSettings type '%c'", 
+                     Py_TYPE(obj)->tp_name, 
+                     type_char);
+        return NULL;
+    }
+
+    if (type_char == 't') {
+        ull = PyLong_AsUnsignedLongLong(obj);
+        if (ull == (unsigned long long) -1 && PyErr_Occurred())
+            return NULL;
+        return g_variant_new_uint64(ull);
+    }
+
+    ll = PyLong_AsLongLong(obj);
+    if (ll == -1 && PyErr_Occurred())
+        return NULL;
+
+    switch (type_char) {
+    case 'y':
+        if (ll >= 0 && ll <= G_MAXUINT8)
+            return g_variant_new_byte(ll);
+        break;
+    case 'n':
+        if (ll >= G_MININT16 && ll <= G_MAXINT16)
+            return g_variant_new_int16(ll);
+        break;
+    case 'q':
+        if (ll >= 0 && ll <= G_MAXUINT16)
+            return g_variant_new_uint16(ll);
+        break;
+    case 'i':
+        if (ll >= G_MININT32 && ll <= G_MAXINT32)
+            return g_variant_new_int32(ll);
+        break;
+    case 'h':
+        if (ll >= G_MININT32 && ll <= G_MAXINT32)
+            return g_variant_new_handle(ll);
+        break;
+    case 'u':
+        if (ll >= 0 && ll <= G_MAXUINT32)
+            return g_variant_new_uint32(ll);
+        break;
+    default:
+        return g_variant_new_int64(ll);
+    }
+
+    PyErr_SetString(PyExc_OverflowError, "value out of range");
+    return NULL;
+}
+
+/* Borrowed UTF-8 view of a str, cached by the str itself, or of bytes. 
+ * GVariant strings are NUL-terminated UTF-8, so embedded NULs and bytes 
+ * that are not UTF-8 raise ValueError
+ */
+static const char *m_object_as_utf8(PyObject *obj) 
+{
+    const char *str = NULL;
+    Py_ssize_t size = 0;
+
+    if (PyUnicode_Check(obj)) {
+        str = PyUnicode_AsUTF8AndSize(obj, &size);
+        if (!str)
+            return NULL;
+    } else if (PyBytes_Check(obj)) {
+        str = PyBytes_AS_STRING(obj);
+        size = PyBytes_GET_SIZE(obj);
+    } else {
+        ERROR("string value expected");
+        return NULL;
+    }
+
+    if (strlen(str) != (size_t) size) {
+        PyErr_SetString(PyExc_ValueError, "embedded null character");
+        return NULL;
+    }
+    if (PyBytes_Check(obj) && !g_utf8_validate(str, size, NULL)) {
+        PyErr_SetString(PyExc_ValueError, "bytes value is not valid UTF-8");
+        return NULL;
+    }
+
+    return str;
+}
+
+/* Type for a value stored in a "v" key, which carries no type of its own */
+static GVariantType *m_guess_type(PyObject *obj) 
+{
+    GVariantType *type = NULL;
+    GString *type_string = NULL;
+    Py_ssize_t i;
+
+    if (PyBool_Check(obj))
+        return g_variant_type_copy(G_VARIANT_TYPE_BOOLEAN);
+    if (PyLong_Check(obj)) {
+        long long ll = PyLong_AsLongLong(obj);
+        if (ll == -1 && PyErr_Occurred()) {
+            PyErr_Clear();
+            return g_variant_type_copy(G_VARIANT_TYPE_UINT64);
+        }
+        if (ll < G_MININT32 || ll > G_MAXINT32)
+            return g_variant_type_copy(G_VARIANT_TYPE_INT64);
+        return g_variant_type_copy(G_VARIANT_TYPE_INT32);
+    }
+    if (PyFloat_Check(obj))
+        return g_variant_type_copy(G_VARIANT_TYPE_DOUBLE);
+    if (PyUnicode_Check(obj))
+        return g_variant_type_copy(G_VARIANT_TYPE_STRING);
+    if (PyBytes_Check(obj))
+        return g_variant_type_copy(G_VARIANT_TYPE_BYTESTRING);
+    if (PyDict_Check(obj))
+        return g_variant_type_copy(G_VARIANT_TYPE_VARDICT);
+
+    /* Lists of strings are the common case, anything else holds variants */
+    if (PyList_Check(obj)) {
+        for (i = 0; i < PyList_GET_SIZE(obj); i++) {
+            if (!PyUnicode_Check(PyList_GET_ITEM(obj, i)))
+                return g_variant_type_copy(G_VARIANT_TYPE("av"));
+        }
+        return g_variant_type_copy(G_VARIANT_TYPE_STRING_ARRAY);
+    }
+
+    if (PyTuple_Check(obj) && PyTuple_GET_SIZE(obj)) {
+        type_string = g_string_new("(");
+        for (i = 0; i < PyTuple_GET_SIZE(obj); i++) {
+            type = m_guess_type(PyTuple_GET_ITEM(obj, i));
+            if (!type) {
+                g_string_free(type_string, TRUE);
+                return NULL;
+            }
+            g_string_append_len(type_string, 
+                                g_variant_type_peek_string(type), 
+                                g_variant_type_get_string_length(type));
+            g_variant_type_free(type);
+        }
+        g_string_append(type_string, ")");
+        type = g_variant_type_new(type_string->str);
+        g_string_free(type_string, TRUE);
+        return type;
+    }
+
+    PyErr_Format(PyExc_TypeError, 
+                 "can not store %s in a GSettings variant", 
+                 Py_TYPE(obj)->tp_name);
+    return NULL;
+}
+
+/* Raises exc with format, whose only argument is the type string */
+static void m_type_error(PyObject *exc, 
+                         const char *format, 
+                         const GVariantType *type, 
+                         PyObject *obj) 
+{
+    gchar *type_string = g_variant_type_dup_string(type);
+
+    if (obj)
+        PyErr_Format(exc, format, Py_TYPE(obj)->tp_name, type_string);
+    else
+        PyErr_Format(exc, format, type_string);
+    g_free(type_string);
+}
+
+static void m_free_children(GVariant **children, gsize n_children) 
+{
+    gsize i;
+
+    for (i = 0; i < n_children; i++)
+        g_variant_unref(g_variant_ref_sink(children[i]));
+    g_free(children);
+}
+
+/* Python string sequences of up to this size keep their pointers on the stack */
+#define STRV_STACK_SIZE 256
+
+/* Builds an "as" GVariant straight from the UTF-8 buffers str objects cache, 
+ * or from bytes, of any sequence or iterable, the only copy being GVariant's 
+ * own serialisation. 
+ * NULL with an exception set on failure
+ */
+static GVariant *m_strv_to_variant(PyObject *obj) 
+{
+    const gchar *stack_strv[STRV_STACK_SIZE];
+    const gchar **strv = stack_strv;
+    PyObject *seq = NULL;
+    PyObject *item = NULL;
+    GVariant *variant = NULL;
+    Py_ssize_t length = 0;
+    Py_ssize_t i;
+
+    if (PyUnicode_Check(obj) || PyBytes_Check(obj)) {
+        ERROR("strv value must be a sequence of strings, not a string");
+        return NULL;
+    }
+
+    seq = PySequence_Fast(obj, "strv value must be an iterable of strings");
+    if (!seq)
+        return NULL;
+
+    length = PySequence_Fast_GET_SIZE(seq);
+    if (length > STRV_STACK_SIZE)
+        strv = g_new(const gchar *, length);
+
+    for (i = 0; i < length; i++) {
+        item = PySequence_Fast_GET_ITEM(seq, i);
+        if (PyUnicode_Check(item) || PyBytes_Check(item)) {
+            strv[i] = m_object_as_utf8(item);
+            if (!strv[i])
+                goto out;
+        } else {
+            PyErr_Format(PyExc_TypeError, 
+                         "strv items must be strings, not %s", 
+                         Py_TYPE(item)->tp_name);
+            goto out;
+        }
+    }
+
+    variant = g_variant_new_strv(strv, length);
+
+out:
+    if (strv != stack_strv)
+        g_free(strv);
+    Py_DECREF(seq);
+
+    return variant;
+}
+
+/* Elements of an "as" value as a list, or as a tuple of interned strings 
+ * that repeated reads of long, rarely changing lists share
+ */
+static PyObject *m_strv_to_object(GVariant *variant, gboolean as_tuple) 
+{
+    const gchar **strv = NULL;
+    PyObject *ret = NULL;
+    PyObject *item = NULL;
+    gsize length = 0;
+    gsize i;
+
+    /* Pointers into the GVariant's own buffer, the strings are not copied */
+    strv = g_variant_get_strv(variant, &length);
+    ret = as_tuple ? PyTuple_New(length) : PyList_New(length);
+    for (i = 0; ret && i < length; i++) {
+        item = PyUnicode_FromString(strv[i]);
+        if (!item) {
+            ZAP(ret);
+            break;
+        }
+        if (as_tuple) {
+            PyUnicode_InternInPlace(&item);
+            PyTuple_SET_ITEM(ret, i, item);
+        } else {
+            PyList_SET_ITEM(ret, i, item);
+        }
+    }
+    g_free(strv);
+
+    return ret;
+}
+
+/* Converts a Python value to a floating GVariant of the given type, walking 
+ * containers recursively and building each one from a pre-sized child array
+ */
+static GVariant *m_object_to_variant(PyObject *obj, const GVariantType *type) 
+{
+    const GVariantType *element = NULL;
+    GVariantType *guessed = NULL;
+    GVariant *variant = NULL;
+    GVariant **children = NULL;
+    PyObject *seq = NULL;
+    PyObject *key = NULL;
+    PyObject *value = NULL;
+    const char *str = NULL;
+    char type_char = g_variant_type_peek_string(type)[0];
+    Py_ssize_t pos = 0;
+    gsize n = 0;
+    gsize i = 0;
+    gdouble d = 0;
+
+    switch (type_char) {
+    case 'b':
+        if (!PyBool_Check(obj))
+            break;
+        return g_variant_new_boolean(obj == Py_True);
+    case 'y':
+    case 'n':
+    case 'q':
+    case 'i':
+    case 'u':
+    case 'x':
+    case 't':
+    case 'h':
+        return m_object_to_integer(obj, type_char);
+    case 'd':
+        if (!PyFloat_Check(obj) && !PyLong_Check(obj))
+            break;
+        /* Ints too large for a double raise OverflowError */
+        d = PyFloat_AsDouble(obj);
+        if (d == -1.0 && PyErr_Occurred())
+            return NULL;
+        return g_variant_new_double(d);
+    case 's':
+    case 'o':
+    case 'g':
+        str = m_object_as_utf8(obj);
+        if (!str)
+            return NULL;
+        if ((type_char == 'o' && !g_variant_is_object_path(str)) || 
+            (type_char == 'g' && !g_variant_is_signature(str))) {
+            PyErr_Format(PyExc_ValueError, 
+                         "invalid GSettings '%c' string", 
+                         type_char);
+            return NULL;
+        }
+        variant = type_char == 's' ? g_variant_new_string(str) : 
+                  type_char == 'o' ? g_variant_new_object_path(str) : 
+                                     g_variant_new_signature(str);
+        return variant;
+    case 'v':
+        guessed = m_guess_type(obj);
+        if (!guessed)
+            return NULL;
+        variant = m_object_to_variant(obj, guessed);
+        g_variant_type_free(guessed);
+        return variant ? g_variant_new_variant(variant) : NULL;
+    case 'm':
+        element = g_variant_type_element(type);
+        if (obj == Py_None)
+            return g_variant_new_maybe(element, NULL);
+        variant = m_object_to_variant(obj, element);
+        return variant ? g_variant_new_maybe(NULL, variant) : NULL;
+    case 'a':
+        element = g_variant_type_element(type);
+        if (g_variant_type_equal(element, G_VARIANT_TYPE_STRING))
+            return m_strv_to_variant(obj);
+        if (g_variant_type_equal(element, G_VARIANT_TYPE_BYTE) && 
+            PyBytes_Check(obj)) {
+            return g_variant_new_fixed_array(element, 
+                                             PyBytes_AS_STRING(obj), 
+                                             PyBytes_GET_SIZE(obj), 
+                                             1);
+        }
+
+        if (g_variant_type_is_dict_entry(element)) {
+            if (!PyDict_Check(obj))
+                break;
+            n = PyDict_Size(obj);
+            children = g_new(GVariant *, n);
+            while (PyDict_Next(obj, &pos, &key, &value)) {
+                variant = m_object_to_variant(key, g_variant_type_key(element));
+                if (variant) {
+                    children[i] = variant;
+                    variant = m_object_to_variant(value, 
+                                                  g_variant_type_value(element));
+                    if (!variant) {
+                        g_variant_unref(g_variant_ref_sink(children[i]));
+                    } else {
+                        children[i] = g_variant_new_dict_entry(children[i], 
+                                                               variant);
+                    }
+                }
+                if (!variant) {
+                    m_free_children(children, i);
+                    return NULL;
+                }
+                i++;
+            }
+        } else {
+            if (!PyList_Check(obj) && !PyTuple_Check(obj))
+                break;
+            seq = obj;
+            n = PySequence_Fast_GET_SIZE(seq);
+            children = g_new(GVariant *, n);
+            for (i = 0; i < n; i++) {
+                children[i] = m_object_to_variant(PySequence_Fast_GET_ITEM(seq, i), 
+                                                  element);
+                if (!children[i]) {
+                    m_free_children(children, i);
+                    return NULL;
+                }
+            }
+        }
+        variant = g_variant_new_array(element, children, n);
+        g_free(children);
+        return variant;
+    case '(':
+        if (!PyTuple_Check(obj) && !PyList_Check(obj))
+            break;
+        n = g_variant_type_n_items(type);
+        if ((gsize) PySequence_Fast_GET_SIZE(obj) != n) {
+            m_type_error(PyExc_ValueError, 
+                         "wrong number of items for GSettings type '%s'", 
+                         type, 
+                         NULL);
+            return NULL;
+        }
+        children = g_new(GVariant *, n);
+        for (element = g_variant_type_first(type), i = 0; 
+             element; 
+             element = g_variant_type_next(element), i++) {
+            children[i] = m_object_to_variant(PySequence_Fast_GET_ITEM(obj, i), 
+                                              element);
+            if (!children[i]) {
+                m_free_children(children, i);
+                return NULL;
+            }
+        }
+        variant = g_variant_new_tuple(children, n);
+        g_free(children);
+        return variant;
+    default:
+        m_type_error(PyExc_TypeError, 
+                     "unsupported GSettings type '%s'", 
+                     type, 
+                     NULL);
+        return NULL;
+    }
+
+    m_type_error(PyExc_TypeError, 
+                 "invalid %s value for GSettings type '%s'", 
+                 type, 
+                 obj);
+    return NULL;
+}
+
+static PyObject *m_int64_to_object(gint64 value) 
+{
+    return PyLong_FromLongLong(value);
+}
+
+static PyObject *m_uint64_to_object(guint64 value) 
+{
+    return PyLong_FromUnsignedLongLong(value);
+}
+
+/* Python value of a fixed-size element array, read in place */
+static PyObject *m_fixed_array_to_object(GVariant *variant, char type_char) 
+{
+    gconstpointer data = NULL;
+    PyObject *list = NULL;
+    PyObject *item = NULL;
+    gsize n = 0;
+    gsize i;
+
+    switch (type_char) {
+    case 'y':
+        data = g_variant_get_fixed_array(variant, &n, sizeof(guint8));
+        return PyBytes_FromStringAndSize(data, n);
+    case 'b':
+        data = g_variant_get_fixed_array(variant, &n, sizeof(guint8));
+        break;
+    case 'n':
+    case 'q':
+        data = g_variant_get_fixed_array(variant, &n, sizeof(guint16));
+        break;
+    case 'i':
+    case 'u':
+    case 'h':
+        data = g_variant_get_fixed_array(variant, &n, sizeof(guint32));
+        break;
+    default:
+        data = g_variant_get_fixed_array(variant, &n, sizeof(guint64));
+        break;
+    }
+
+    list = PyList_New(n);
+    for (i = 0; list && i < n; i++) {
+        switch (type_char) {
+        case 'b':
+            item = PyBool_FromLong(((const guint8 *) data)[i]);
+            break;
+        case 'n':
+            item = INT(((const gint16 *) data)[i]);
+            break;
+        case 'q':
+            item = INT(((const guint16 *) data)[i]);
+            break;
+        case 'i':
+        case 'h':
+            item = INT(((const gint32 *) data)[i]);
+            break;
+        case 'u':
+            item = m_uint64_to_object(((const guint32 *) data)[i]);
+            break;
+        case 'x':
+            item = m_int64_to_object(((const gint64 *) data)[i]);
+            break;
+        case 't':
+            item = m_uint64_to_object(((const guint64 *) data)[i]);
+            break;
+        default:
+            item = DOUBLE(((const gdouble *) data)[i]);
+            break;
+        }
+        if (!item) {
+            Py_DECREF(list);
+            return NULL;
+        }
+        PyList_SET_ITEM(list, i, item);
+    }
+
+    return list;
+}
+
+/* Converts any GVariant to a Python value: numbers, str for s/o/g, bytes for ay, 
+ * None or the value for maybe types, list for arrays, dict for a{..} and 
+ * tuple for tuples. Containers are created at their final size
+ */
+static PyObject *m_variant_to_object(GVariant *variant) 
+{
+    const gchar *type_string = g_variant_get_type_string(variant);
+    GVariantIter iter;
+    GVariant *child = NULL;
+    GVariant *entry_key = NULL;
+    PyObject *ret = NULL;
+    PyObject *key = NULL;
+    PyObject *item = NULL;
+    const gchar *str = NULL;
+    gsize length = 0;
+    gsize i = 0;
+
+    switch (type_string[0]) {
+    case 'b':
+        return PyBool_FromLong(g_variant_get_boolean(variant));
+    case 'y':
+        return INT(g_variant_get_byte(variant));
+    case 'n':
+        return INT(g_variant_get_int16(variant));
+    case 'q':
+        return INT(g_variant_get_uint16(variant));
+    case 'i':
+        return INT(g_variant_get_int32(variant));
+    case 'h':
+        return INT(g_variant_get_handle(variant));
+    case 'u':
+        return m_uint64_to_object(g_variant_get_uint32(variant));
+    case 'x':
+        return m_int64_to_object(g_variant_get_int64(variant));
+    case 't':
+        return m_uint64_to_object(g_variant_get_uint64(variant));
+    case 'd':
+        return DOUBLE(g_variant_get_double(variant));
+    case 's':
+    case 'o':
+    case 'g':
+        str = g_variant_get_string(variant, &length);
+        return PyUnicode_FromStringAndSize(str, length);
+    case 'v':
+        child = g_variant_get_variant(variant);
+        ret = m_variant_to_object(child);
+        g_variant_unref(child);
+        return ret;
+    case 'm':
+        child = g_variant_get_maybe(variant);
+        if (!child) {
+            Py_INCREF(Py_None);
+            return Py_None;
+        }
+        ret = m_variant_to_object(child);
+        g_variant_unref(child);
+        return ret;
+    case 'a':
+        if (strchr("ybnqiuhxtd", type_string[1]))
+            return m_fixed_array_to_object(variant, type_string[1]);
+        if (type_string[1] == 's')
+            return m_strv_to_object(variant, FALSE);
+
+        if (type_string[1] == '{') {
+            ret = PyDict_New();
+            g_variant_iter_init(&iter, variant);
+            while (ret && (child = g_variant_iter_next_value(&iter))) {
+                entry_key = g_variant_get_child_value(child, 0);
+                key = m_variant_to_object(entry_key);
+                g_variant_unref(entry_key);
+                entry_key = g_variant_get_child_value(child, 1);
+                item = key ? m_variant_to_object(entry_key) : NULL;
+                g_variant_unref(entry_key);
+                g_variant_unref(child);
+                if (!item || PyDict_SetItem(ret, key, item) < 0)
+                    ZAP(ret);
+                Py_XDECREF(key);
+                Py_XDECREF(item);
+            }
+            return ret;
+        }
+
+        ret = PyList_New(g_variant_iter_init(&iter, variant));
+        while (ret && (child = g_variant_iter_next_value(&iter))) {
+            item = m_variant_to_object(child);
+            g_variant_unref(child);
+            if (!item) {
+                ZAP(ret);
+                break;
+            }
+            PyList_SET_ITEM(ret, i++, item);
+        }
+        return ret;
+    case '(':
+    case '{':
+        ret = PyTuple_New(g_variant_iter_init(&iter, variant));
+        while (ret && (child = g_variant_iter_next_value(&iter))) {
+            item = m_variant_to_object(child);
+            g_variant_unref(child);
+            if (!item) {
+                ZAP(ret);
+                break;
+            }
+            PyTuple_SET_ITEM(ret, i++, item);
+        }
+        return ret;
+    default:
+        break;
+    }
+
+    PyErr_Format(PyExc_TypeError, "unsupported GSettings type '%s'", type_string);
+    return NULL;
+}
+
+/* Also frees a partly built table, GIL held */
+static void m_free_schema_info(gpointer data) 
+{
+    SchemaInfo *info = (SchemaInfo *) data;
+    gsize i;
+
+    for (i = 0; i < info->n_keys; i++) {
+        if (info->keys[i].key)
+            g_settings_schema_key_unref(info->keys[i].key);
+        if (info->keys[i].default_value)
+            g_variant_unref(info->keys[i].default_value);
+        Py_XDECREF(info->keys[i].name);
+    }
+    g_free(info->keys);
+    Py_XDECREF(info->index);
+    Py_XDECREF(info->names);
+    g_free(info);
+}
+
+/* Key table of schema, built on first use and kept for the life of the 
+ * module. NULL with an exception set on failure
+ */
+static SchemaInfo *m_schema_info(ModuleState *state, GSettingsSchema *schema) 
+{
+    const gchar *schema_id = g_settings_schema_get_id(schema);
+    SchemaInfo *info = NULL;
+    KeyInfo *key_info = NULL;
+    GVariant *range = NULL;
+    const gchar *range_type = NULL;
+    PyObject *position = NULL;
+    gchar **names = NULL;
+    gsize i;
+
+    info = g_hash_table_lookup(state->schema_cache, schema_id);
+    if (info)
+        return info;
+
+    names = g_settings_schema_list_keys(schema);
+    info = g_new0(SchemaInfo, 1);
+    info->n_keys = g_strv_length(names);
+    info->keys = g_new0(KeyInfo, info->n_keys);
+    info->index = PyDict_New();
+    info->names = PyTuple_New(info->n_keys);
+    if (!info->index || !info->names)
+        goto fail;
+
+    for (i = 0; i < info->n_keys; i++) {
+        key_info = &info->keys[i];
+        key_info->name = PyUnicode_InternFromString(names[i]);
+        if (!key_info->name)
+            goto fail;
+        Py_INCREF(key_info->name);
+        PyTuple_SET_ITEM(info->names, i, key_info->name);
+
+        position = PyLong_FromSsize_t(i);
+        if (!position || PyDict_SetItem(info->index, key_info->name, position) < 0) {
+            Py_XDECREF(position);
+            goto fail;
+        }
+        Py_DECREF(position);
+
+        key_info->key = g_settings_schema_get_key(schema, names[i]);
+        key_info->c_name = g_settings_schema_key_get_name(key_info->key);
+        key_info->type = g_settings_schema_key_get_value_type(key_info->key);
+        key_info->default_value = 
+            g_settings_schema_key_get_default_value(key_info->key);
+
+        /* ("type", <@mv nothing>) for keys that take any value of their type */
+        range = g_settings_schema_key_get_range(key_info->key);
+        g_variant_get(range, "(&sv)", &range_type, NULL);
+        key_info->ranged = strcmp(range_type, "type") != 0;
+        g_variant_unref(range);
+    }
+    g_strfreev(names);
+
+    g_hash_table_insert(state->schema_cache, g_strdup(schema_id), info);
+    return info;
+
+fail:
+    m_free_schema_info(info);
+    g_strfreev(names);
+    return NULL;
+}
+
+/* Metadata of the key of info named by a Python string. Interned names, 
+ * and constants whose hash is already cached, resolve without hashing or 
+ * copying. KeyError when the schema lacks the key, TypeError when type is 
+ * given and the key holds another type
+ */
+static const KeyInfo *m_schema_key(SchemaInfo *info, 
+                                   PyObject *key, 
+                                   const GVariantType *type) 
+{
+    PyObject *position = NULL;
+    const KeyInfo *key_info = NULL;
+    gchar *type_string = NULL;
+
+    position = PyDict_GetItem(info->index, key);
+    if (!position) {
+        if (PyUnicode_Check(key))
+            PyErr_SetObject(PyExc_KeyError, key);
+        else
+            ERROR("key must be a string");
+        return NULL;
+    }
+
+    key_info = &info->keys[PyLong_AsSsize_t(position)];
+    if (type && !g_variant_type_equal(key_info->type, type)) {
+        type_string = g_variant_type_dup_string(key_info->type);
+        PyErr_Format(PyExc_TypeError, 
+                     "key '%s' holds values of type '%s'", 
+                     key_info->c_name, 
+                     type_string);
+        g_free(type_string);
+        return NULL;
+    }
+
+    return key_info;
+}
+
+/* m_schema_key of the object's schema, which a deleted object no longer 
+ * has. First use of a lazy object
+ */
+static const KeyInfo *m_key_info(DeepinGSettingsObject *self, 
+                                 PyObject *key, 
+                                 const GVariantType *type) 
+{
+    if (!m_realize(self))
+        return NULL;
+
+    if (!self->entry) {
+        ERROR("deepin_gsettings object has been deleted");
+        return NULL;
+    }
+
+    return m_schema_key(self->entry->info, key, type);
+}
+
+/* Value of key from the loaded snapshot while the object is lazy, so the 
+ * read needs no GSettings. NULL without an exception for a live read
+ */
+static GVariant *m_snapshot_value(DeepinGSettingsObject *self, 
+                                  PyObject *key, 
+                                  const GVariantType *type) 
+{
+    GVariant *value = NULL;
+    const char *c_key = NULL;
+
+    if (!self->lazy_schema_id || !PyUnicode_Check(key))
+        return NULL;
+    c_key = PyUnicode_AsUTF8(key);
+    if (!c_key) {
+        PyErr_Clear();
+        return NULL;
+    }
+
+    value = deepin_gsettings_snapshot_lookup(self->lazy_schema_id, 
+                                             self->lazy_path, 
+                                             c_key);
+    /* The live read raises the type error */
+    if (value && type && !g_variant_is_of_type(value, type)) {
+        g_variant_unref(value);
+        return NULL;
+    }
+
+    return value;
+}
+
+/* New reference to the value of key of type, NULL with an exception set */
+static GVariant *m_read_key(DeepinGSettingsObject *self, 
+                            PyObject *key, 
+                            const GVariantType *type) 
+{
+    const KeyInfo *key_info = NULL;
+    GVariant *value = NULL;
+
+    value = m_snapshot_value(self, key, type);
+    if (value)
+        return value;
+
+    key_info = m_key_info(self, key, type);
+    if (!key_info)
+        return NULL;
+
+    return m_read_value(self, key_info->c_name);
+}
+
+/* Strong references to the current subscribers, callbacks may connect, 
+ * delete or create objects while the list is walked (GIL held)
+ */
+static GSList *m_ref_subscribers(SettingsEntry *entry) 
+{
+    GSList *subscribers = g_slist_copy(entry->subscribers);
+    GSList *l = NULL;
+
+    for (l = subscribers; l; l = l->next)
+        Py_INCREF((PyObject *) l->data);
+
+    return subscribers;
+}
+
+static void m_unref_subscribers(GSList *subscribers) 
+{
+    GSList *l = NULL;
+
+    for (l = subscribers; l; l = l->next)
+        Py_DECREF((PyObject *) l->data);
+    g_slist_free(subscribers);
+}
+
+static void m_changes_cb(DeepinGSettings *settings, 
+                         const gchar *const *keys, 
+                         guint n_keys, 
+                         gpointer user_data) 
+{
+    ChangesTarget *target = (ChangesTarget *) user_data;
+    DeepinGSettingsObject *self = NULL;
+    PyGILState_STATE gstate;
+    PyObject *callbacks = NULL;
+    PyObject *list = NULL;
+    PyObject *ret = NULL;
+    gint64 start = 0;
+    Py_ssize_t i;
+
+    start = m_stats_begin(target->state);
+    gstate = PyGILState_Ensure();
+    m_stats_end(target->state, STAT_GIL_WAIT, start);
+
+    self = (DeepinGSettingsObject *) target->owner;
+    callbacks = self ? m_matching_callbacks(self, SIGNAL_CHANGES, 0) : NULL;
+    if (callbacks) {
+        start = m_stats_begin(target->state);
+        Py_INCREF(self);
+        list = PyList_New(n_keys);
+        for (i = 0; list && i < (Py_ssize_t) n_keys; i++)
+            PyList_SET_ITEM(list, i, PyUnicode_FromString(keys[i]));
+        for (i = 0; list && i < PyTuple_GET_SIZE(callbacks); i++) {
+            ret = PyObject_CallFunctionObjArgs(PyTuple_GET_ITEM(callbacks, i), 
+                                               list, 
+                                               NULL);
+            if (!ret)
+                PyErr_Print();
+            Py_XDECREF(ret);
+        }
+        if (!list)
+            PyErr_Print();
+        m_stats_callbacks(self, PyTuple_GET_SIZE(callbacks));
+        Py_XDECREF(list);
+        Py_DECREF(callbacks);
+        Py_DECREF(self);
+        m_stats_end(target->state, STAT_CALLBACK, start);
+    }
+
+    PyGILState_Release(gstate);
+}
+
+/* "changes" handlers are served by a library subscription, which merges 
+ * the keys changed until its delivery runs
+ */
+static void m_attach_changes(DeepinGSettingsObject *self) 
+{
+    ChangesTarget *target = g_new0(ChangesTarget, 1);
+
+    target->state = m_get_state(self->module);
+    target->owner = self;
+    self->changes = target;
+    self->changes_id = deepin_gsettings_connect_changes(self->entry->settings, 
+                                                        self->changes_interval, 
+                                                        m_changes_cb, 
+                                                        target, 
+                                                        g_free);
+}
+
+/* Keys still queued are dropped along with any scheduled delivery */
+static void m_detach_changes(DeepinGSettingsObject *self, SettingsEntry *entry) 
+{
+    if (!self->changes)
+        return;
+
+    self->changes->owner = NULL;
+    self->changes = NULL;
+    deepin_gsettings_disconnect_changes(entry->settings, self->changes_id);
+    self->changes_id = 0;
+}
+
+/* Tells whether any changed::key handler of the entry watches key. Called 
+ * without the GIL
+ */
+static gboolean m_key_watched(SettingsEntry *entry, GQuark key) 
+{
+    gboolean found = FALSE;
+
+    if (!key)
+        return FALSE;
+
+    g_mutex_lock(&entry->lock);
+    found = g_hash_table_lookup(entry->key_listeners, GUINT_TO_POINTER(key)) 
+            != NULL;
+    g_mutex_unlock(&entry->lock);
+
+    return found;
+}
+
+/* Drops the last-seen values no "diff" handler watches any more, so that a 
+ * later handler starts from the value current then. Entry lock held
+ */
+static gboolean m_unwatched(gpointer key, gpointer value, gpointer user_data) 
+{
+    SettingsEntry *entry = (SettingsEntry *) user_data;
+
+    return !g_atomic_int_get(&entry->n_diff_listeners) && 
+           !g_hash_table_contains(entry->diff_keys, key);
+}
+
+static void m_forget_unwatched(SettingsEntry *entry) 
+{
+    g_hash_table_foreach_remove(entry->last_seen, m_unwatched, entry);
+}
+
+/* Counts a changed::key or diff::key handler in or out */
+static void m_add_key_listener(SettingsEntry *entry, 
+                               int signal, 
+                               GQuark key, 
+                               gint delta) 
+{
+    GHashTable *listeners = NULL;
+    gint count = 0;
+
+    g_mutex_lock(&entry->lock);
+    listeners = signal == SIGNAL_DIFF ? entry->diff_keys : entry->key_listeners;
+    count = GPOINTER_TO_INT(g_hash_table_lookup(listeners, 
+                                                GUINT_TO_POINTER(key)));
+    count += delta;
+    if (count)
+        g_hash_table_insert(listeners, 
+                            GUINT_TO_POINTER(key), 
+                            GINT_TO_POINTER(count));
+    else
+        g_hash_table_remove(listeners, GUINT_TO_POINTER(key));
+    if (signal == SIGNAL_DIFF && delta < 0)
+        m_forget_unwatched(entry);
+    g_mutex_unlock(&entry->lock);
+}
+
+/* New tuple of the callbacks of self matching signal and key, NULL if none. 
+ * Callbacks may connect or disconnect, so they are called from this copy
+ */
+static PyObject *m_matching_callbacks(DeepinGSettingsObject *self, 
+                                      int signal, 
+                                      GQuark key) 
+{
+    SignalHandler *handler = NULL;
+    PyObject *callbacks = NULL;
+    Py_ssize_t n = 0;
+    guint i;
+
+    for (i = 0; self->handlers && i < self->handlers->len; i++) {
+        handler = &g_array_index(self->handlers, SignalHandler, i);
+        if (handler->signal == signal && 
+            (!handler->detail || handler->detail == key))
+            n++;
+    }
+    if (!n)
+        return NULL;
+
+    callbacks = PyTuple_New(n);
+    if (!callbacks) {
+        PyErr_Print();
+        return NULL;
+    }
+
+    for (i = 0, n = 0; i < self->handlers->len; i++) {
+        handler = &g_array_index(self->handlers, SignalHandler, i);
+        if (handler->signal == signal && 
+            (!handler->detail || handler->detail == key)) {
+            Py_INCREF(handler->callback);
+            PyTuple_SET_ITEM(callbacks, n++, handler->callback);
+        }
+    }
+
+    return callbacks;
+}
+
+/* Runs the "changed" handlers of every subscriber of entry, GIL held */
+static void m_emit_changed(SettingsEntry *entry, const gchar *key, GQuark quark) 
+{
+    PyObject *callbacks = NULL;
+    PyObject *ret = NULL;
+    GSList *subscribers = NULL;
+    GSList *l = NULL;
+    Py_ssize_t i;
+
+    subscribers = m_ref_subscribers(entry);
+    /* Callbacks read the new value, so every cache is fixed up first */
+    for (l = subscribers; l; l = l->next)
+        m_cache_invalidate((DeepinGSettingsObject *) l->data, key);
+    for (l = subscribers; l; l = l->next) {
+        callbacks = m_matching_callbacks((DeepinGSettingsObject *) l->data, 
+                                         SIGNAL_CHANGED, 
+                                         quark);
+        if (!callbacks)
+            continue;
+        for (i = 0; i < PyTuple_GET_SIZE(callbacks); i++) {
+            ret = PyObject_CallFunction(PyTuple_GET_ITEM(callbacks, i), 
+                                        "(s)", 
+                                        key);
+            if (!ret)
+                PyErr_Print();
+            Py_XDECREF(ret);
+        }
+        m_stats_callbacks((DeepinGSettingsObject *) l->data, i);
+        Py_DECREF(callbacks);
+    }
+    m_unref_subscribers(subscribers);
+}
+
+/* Runs the "change-event" handlers of every subscriber of entry, GIL held */
+static void m_emit_change_event(SettingsEntry *entry, 
+                                const GQuark *keys, 
+                                gint n_keys) 
+{
+    PyObject *callbacks = NULL;
+    PyObject *list = NULL;
+    PyObject *ret = NULL;
+    GSList *subscribers = NULL;
+    GSList *l = NULL;
+    Py_ssize_t j;
+    int i;
+
+    list = PyList_New(n_keys);
+    for (i = 0; list && i < n_keys; i++)
+        PyList_SET_ITEM(list, i, PyUnicode_FromString(g_quark_to_string(keys[i])));
+    subscribers = list ? m_ref_subscribers(entry) : NULL;
+    for (l = subscribers; l; l = l->next) {
+        callbacks = m_matching_callbacks((DeepinGSettingsObject *) l->data, 
+                                         SIGNAL_CHANGE_EVENT, 
+                                         0);
+        if (!callbacks)
+            continue;
+        for (j = 0; j < PyTuple_GET_SIZE(callbacks); j++) {
+            ret = PyObject_CallFunctionObjArgs(PyTuple_GET_ITEM(callbacks, j), 
+                                               list, 
+                                               NULL);
+            if (!ret)
+                PyErr_Print();
+            Py_XDECREF(ret);
+        }
+        m_stats_callbacks((DeepinGSettingsObject *) l->data, j);
+        Py_DECREF(callbacks);
+    }
+    m_unref_subscribers(subscribers);
+    if (!list)
+        PyErr_Print();
+    Py_XDECREF(list);
+}
+
+/* Gives the "diff" handlers of key, or of every key when 0, a last-seen 
+ * value to compare the next write with. A value already there is kept, 
+ * other handlers have not heard about the write after it yet. GIL held
+ */
+static void m_seed_last_seen(SettingsEntry *entry, GQuark key) 
+{
+    SchemaInfo *info = entry->info;
+    GVariant *value = NULL;
+    GQuark quark;
+    gsize i;
+
+    for (i = 0; i < info->n_keys; i++) {
+        quark = g_quark_from_string(info->keys[i].c_name);
+        if (key && quark != key)
+            continue;
+
+        value = g_settings_get_value(entry->handle, info->keys[i].c_name);
+        g_mutex_lock(&entry->lock);
+        if (!g_hash_table_contains(entry->last_seen, GUINT_TO_POINTER(quark))) {
+            g_hash_table_insert(entry->last_seen, 
+                                GUINT_TO_POINTER(quark), 
+                                value);
+            value = NULL;
+        }
+        g_mutex_unlock(&entry->lock);
+        if (value)
+            g_variant_unref(value);
+    }
+}
+
+/* Reads the new value of a key watched by "diff" handlers and swaps it with 
+ * the last-seen one, handing both out. FALSE when nobody watches key, or 
+ * when the value is the last-seen one and the write is suppressed. Called 
+ * without the GIL
+ */
+static gboolean m_diff_key(SettingsEntry *entry, 
+                           GSettings *settings, 
+                           const gchar *key, 
+                           GQuark quark, 
+                           GVariant **old_value, 
+                           GVariant **new_value) 
+{
+    GVariant *value = NULL;
+    GVariant *last = NULL;
+    gboolean watched = FALSE;
+
+    if (!quark)
+        return FALSE;
+
+    g_mutex_lock(&entry->lock);
+    watched = g_atomic_int_get(&entry->n_diff_listeners) || 
+              g_hash_table_contains(entry->diff_keys, GUINT_TO_POINTER(quark));
+    g_mutex_unlock(&entry->lock);
+    if (!watched)
+        return FALSE;
+
+    value = g_settings_get_value(settings, key);
+    g_mutex_lock(&entry->lock);
+    last = g_hash_table_lookup(entry->last_seen, GUINT_TO_POINTER(quark));
+    if (last && g_variant_equal(last, value)) {
+        g_mutex_unlock(&entry->lock);
+        g_variant_unref(value);
+        STAT_ADD(entry->state->diff_suppressed, 1);
+        return FALSE;
+    }
+    if (last)
+        g_variant_ref(last);
+    g_hash_table_insert(entry->last_seen, 
+                        GUINT_TO_POINTER(quark), 
+                        g_variant_ref(value));
+    g_mutex_unlock(&entry->lock);
+
+    *old_value = last;
+    *new_value = value;
+
+    return TRUE;
+}
+
+/* Runs the "diff" handlers of every subscriber of entry with the key, its 
+ * last-seen value, None when there was none, and its new value. GIL held
+ */
+static void m_emit_diff(SettingsEntry *entry, 
+                        const gchar *key, 
+                        GQuark quark, 
+                        GVariant *old_value, 
+                        GVariant *new_value) 
+{
+    PyObject *callbacks = NULL;
+    PyObject *old_object = NULL;
+    PyObject *new_object = NULL;
+    PyObject *ret = NULL;
+    GSList *subscribers = NULL;
+    GSList *l = NULL;
+    Py_ssize_t i;
+
+    if (old_value) {
+        old_object = m_variant_to_object(old_value);
+    } else {
+        Py_INCREF(Py_None);
+        old_object = Py_None;
+    }
+    new_object = m_variant_to_object(new_value);
+    if (!old_object || !new_object) {
+        PyErr_Print();
+        Py_XDECREF(old_object);
+        Py_XDECREF(new_object);
+        return;
+    }
+
+    subscribers = m_ref_subscribers(entry);
+    for (l = subscribers; l; l = l->next) {
+        callbacks = m_matching_callbacks((DeepinGSettingsObject *) l->data, 
+                                         SIGNAL_DIFF, 
+                                         quark);
+        if (!callbacks)
+            continue;
+        for (i = 0; i < PyTuple_GET_SIZE(callbacks); i++) {
+            ret = PyObject_CallFunction(PyTuple_GET_ITEM(callbacks, i), 
+                                        "(sOO)", 
+                                        key, 
+                                        old_object, 
+                                        new_object);
+            if (!ret)
+                PyErr_Print();
+            Py_XDECREF(ret);
+        }
+        m_stats_callbacks((DeepinGSettingsObject *) l->data, i);
+        Py_DECREF(callbacks);
+    }
+    m_unref_subscribers(subscribers);
+    Py_DECREF(old_object);
+    Py_DECREF(new_object);
+}
+
+/* Pushes an event for wait_changes(). Several threads may push, only 
+ * m_take_events takes, so a compare-and-swap on the head is enough. The 
+ * eventfd is written when the queue turns non-empty
+ */
+static void m_push_event(ChangeEvent *event) 
+{
+    ChangeEvent *head = NULL;
+    guint64 one = 1;
+
+    do {
+        head = g_atomic_pointer_get(&m_event_head);
+        event->next = head;
+    } while (!g_atomic_pointer_compare_and_exchange(&m_event_head, head, event));
+
+    if (!head && write(m_event_fd, &one, sizeof(one)) < 0 && errno != EAGAIN)
+        g_warning("deepin_gsettings: can not signal the changes fd");
+}
+
+/* Detaches every queued event, oldest first */
+static ChangeEvent *m_take_events(void) 
+{
+    ChangeEvent *head = NULL;
+    ChangeEvent *next = NULL;
+    ChangeEvent *events = NULL;
+    guint64 count = 0;
+
+    /* Reset the fd before taking, a push racing with us writes again */
+    if (read(m_event_fd, &count, sizeof(count)) < 0 && errno != EAGAIN)
+        g_warning("deepin_gsettings: can not read the changes fd");
+
+    do {
+        head = g_atomic_pointer_get(&m_event_head);
+    } while (!g_atomic_pointer_compare_and_exchange(&m_event_head, head, NULL));
+
+    /* The stack is newest first */
+    for (; head; head = next) {
+        next = head->next;
+        head->next = events;
+        events = head;
+    }
+
+    return events;
+}
+
+static ChangeEvent *m_new_event(SettingsEntry *entry, 
+                                GQuark key, 
+                                const GQuark *keys, 
+                                gint n_keys) 
+{
+    ChangeEvent *event = g_new0(ChangeEvent, 1);
+
+    event->entry = m_entry_ref(entry);
+    event->key = key;
+    if (keys) {
+        event->keys = g_new(GQuark, n_keys);
+        memcpy(event->keys, keys, n_keys * sizeof(GQuark));
+        event->n_keys = n_keys;
+    }
+
+    return event;
+}
+
+static void m_free_event(ChangeEvent *event) 
+{
+    if (event->old_value)
+        g_variant_unref(event->old_value);
+    if (event->new_value)
+        g_variant_unref(event->new_value);
+    m_entry_unref(event->entry);
+    g_free(event->keys);
+    g_free(event);
+}
+
+static void m_changed_cb(GSettings *settings, gchar *key, gpointer user_data) 
+{
+    SettingsEntry *entry = (SettingsEntry *) user_data;
+    PyGILState_STATE gstate;
+    GQuark quark = g_quark_try_string(key);
+    gboolean key_listener = m_key_watched(entry, quark);
+    gboolean listening = FALSE;
+    gboolean diff = FALSE;
+    GVariant *old_value = NULL;
+    GVariant *new_value = NULL;
+    ChangeEvent *event = NULL;
+    gint64 start = 0;
+
+    /* Keys nobody subscribed to, only "changes" handlers, or "diff" handlers 
+     * that already have the value never take the GIL or get queued. A read 
+     * cache counts in n_listeners
+     */
+    diff = m_diff_key(entry, settings, key, quark, &old_value, &new_value);
+    listening = key_listener || g_atomic_int_get(&entry->n_listeners);
+    if (!listening && !diff) 
+        return;
+
+    if (g_atomic_int_get(&m_dispatch_queued)) {
+        g_atomic_int_inc(&entry->dirty);
+        event = m_new_event(entry, quark, NULL, 0);
+        event->diff = diff;
+        event->old_value = old_value;
+        event->new_value = new_value;
+        m_push_event(event);
+        return;
+    }
+
+    start = m_stats_begin(entry->state);
+    gstate = PyGILState_Ensure();
+    m_stats_end(entry->state, STAT_GIL_WAIT, start);
+    start = m_stats_begin(entry->state);
+    if (listening)
+        m_emit_changed(entry, key, quark);
+    if (diff)
+        m_emit_diff(entry, key, quark, old_value, new_value);
+    m_stats_end(entry->state, STAT_CALLBACK, start);
+    PyGILState_Release(gstate);
+
+    if (old_value)
+        g_variant_unref(old_value);
+    if (new_value)
+        g_variant_unref(new_value);
+}
+
+/* Emitted once per backend change with every key it touched, so an applied 
+ * batch reaches Python as a single call
+ */
+static gboolean m_change_event_cb(GSettings *settings, 
+                                  GQuark *keys, 
+                                  gint n_keys, 
+                                  gpointer user_data) 
+{
+    SettingsEntry *entry = (SettingsEntry *) user_data;
+    PyGILState_STATE gstate;
+    GQuark *all_keys = NULL;
+    gchar **names = NULL;
+    gboolean queued = g_atomic_int_get(&m_dispatch_queued);
+    gint64 start = 0;
+    int i;
+
+    if (!g_atomic_int_get(&entry->n_event_listeners))
+        return FALSE;
+
+    /* No keys means that anything under the path may have changed */
+    if (!keys) {
+        names = g_settings_list_keys(settings);
+        n_keys = g_strv_length(names);
+        all_keys = g_new(GQuark, n_keys);
+        for (i = 0; i < n_keys; i++)
+            all_keys[i] = g_quark_from_string(names[i]);
+        g_strfreev(names);
+        keys = all_keys;
+    }
+
+    if (queued) {
+        m_push_event(m_new_event(entry, 0, keys, n_keys));
+    } else {
+        start = m_stats_begin(entry->state);
+        gstate = PyGILState_Ensure();
+        m_stats_end(entry->state, STAT_GIL_WAIT, start);
+        start = m_stats_begin(entry->state);
+        m_emit_change_event(entry, keys, n_keys);
+        m_stats_end(entry->state, STAT_CALLBACK, start);
+        PyGILState_Release(gstate);
+    }
+
+    g_free(all_keys);
+
+    return FALSE;
+}
+
+static SettingsEntry *m_entry_ref(SettingsEntry *entry) 
+{
+    g_atomic_int_inc(&entry->ref_count);
+    return entry;
+}
+
+static void m_entry_unref(SettingsEntry *entry) 
+{
+    if (!g_atomic_int_dec_and_test(&entry->ref_count))
+        return;
+
+    g_free(entry->schema_id);
+    g_free(entry->path);
+    g_object_unref(entry->handle);
+    if (entry->schema)
+        g_settings_schema_unref(entry->schema);
+    g_slist_free(entry->subscribers);
+    g_mutex_clear(&entry->lock);
+    g_hash_table_destroy(entry->key_listeners);
+    g_hash_table_destroy(entry->diff_keys);
+    g_hash_table_destroy(entry->last_seen);
+    g_free(entry);
+}
+
+static void m_entry_closure_notify(gpointer data, GClosure *closure) 
+{
+    m_entry_unref((SettingsEntry *) data);
+}
+
+/* The library keeps the settings cached while few enough are idle */
+static void m_release_entry(SettingsEntry *entry) 
+{
+    g_hash_table_remove(entry->state->settings_cache, entry->settings);
+
+    /* Queued events and async writes may keep the handle a while longer, 
+     * nothing of it is delivered to the released entry any more
+     */
+    g_signal_handler_disconnect(entry->handle, entry->changed_id);
+    g_signal_handler_disconnect(entry->handle, entry->change_event_id);
+
+    deepin_gsettings_release(entry->settings);
+    m_entry_unref(entry);
+}
+
+/* Settings are cached by the library, in the dispatcher context once there 
+ * is one. Creating them there may wait for the dispatcher thread, so the 
+ * GIL is released then
+ */
+static DeepinGSettings *m_get_settings(const gchar *schema_id, const gchar *path) 
+{
+    DeepinGSettings *settings = NULL;
+
+    if (!deepin_gsettings_get_context())
+        return deepin_gsettings_get(schema_id, path);
+
+    Py_BEGIN_ALLOW_THREADS
+    settings = deepin_gsettings_get(schema_id, path);
+    Py_END_ALLOW_THREADS
+
+    return settings;
+}
+
+static SettingsEntry *m_lookup_entry(ModuleState *state, 
+                                     const gchar *schema_id, 
+                                     const gchar *path) 
+{
+    SettingsEntry *entry = NULL;
+    DeepinGSettings *settings = NULL;
+    GSettingsSchema *schema = NULL;
+    SchemaInfo *info = NULL;
+
+    settings = m_get_settings(schema_id, path);
+    if (!settings)
+        return NULL;
+
+    /* An entry holds a single use of its settings */
+    entry = g_hash_table_lookup(state->settings_cache, settings);
+    if (entry) {
+        deepin_gsettings_release(settings);
+        return entry;
+    }
+
+    g_object_get(deepin_gsettings_get_handle(settings), 
+                 "settings-schema", &schema, 
+                 NULL);
+    info = m_schema_info(state, schema);
+    if (!info) {
+        g_settings_schema_unref(schema);
+        deepin_gsettings_release(settings);
+        return NULL;
+    }
+
+    entry = g_new0(SettingsEntry, 1);
+    entry->ref_count = 1;
+    entry->state = state;
+    entry->settings = settings;
+    entry->schema_id = g_strdup(schema_id);
+    entry->path = g_strdup(path);
+    g_mutex_init(&entry->lock);
+    entry->key_listeners = g_hash_table_new(NULL, NULL);
+    entry->diff_keys = g_hash_table_new(NULL, NULL);
+    entry->last_seen = g_hash_table_new_full(NULL, 
+                                             NULL, 
+                                             NULL, 
+                                             (GDestroyNotify) g_variant_unref);
+    entry->handle = g_object_ref(deepin_gsettings_get_handle(settings));
+    entry->schema = schema;
+    entry->info = info;
+
+    entry->changed_id = g_signal_connect_data(entry->handle, 
+                                              "changed", 
+                                              G_CALLBACK(m_changed_cb), 
+                                              m_entry_ref(entry), 
+                                              m_entry_closure_notify, 
+                                              0);
+    entry->change_event_id = g_signal_connect_data(entry->handle, 
+                                                   "change-event", 
+                                                   G_CALLBACK(m_change_event_cb), 
+                                                   m_entry_ref(entry), 
+                                                   m_entry_closure_notify, 
+                                                   0);
+
+    g_hash_table_insert(state->settings_cache, settings, entry);
+
+    return entry;
+}
+
+/* Counts a subscriber with a "diff" handler for every key in or out */
+static void m_add_diff_listener(SettingsEntry *entry, gint delta) 
+{
+    g_mutex_lock(&entry->lock);
+    g_atomic_int_add(&entry->n_diff_listeners, delta);
+    if (delta < 0)
+        m_forget_unwatched(entry);
+    g_mutex_unlock(&entry->lock);
+}
+
+/* Keeps entry->n_listeners, n_event_listeners and n_diff_listeners in step 
+ * with the object's handlers. changed::key and diff::key handlers are 
+ * counted per key by m_add_key_listener
+ */
+static void m_update_listening(DeepinGSettingsObject *self) 
+{
+    SignalHandler *handler = NULL;
+    gboolean listening = FALSE;
+    gboolean listening_events = FALSE;
+    gboolean listening_changes = FALSE;
+    gboolean listening_diffs = FALSE;
+    guint i;
+
+    if (!self->entry)
+        return;
+
+    /* The read cache must hear about every key */
+    listening = self->value_cache != NULL;
+    for (i = 0; self->handlers && i < self->handlers->len; i++) {
+        handler = &g_array_index(self->handlers, SignalHandler, i);
+        if (handler->signal == SIGNAL_CHANGE_EVENT)
+            listening_events = TRUE;
+        else if (handler->signal == SIGNAL_CHANGES)
+            listening_changes = TRUE;
+        else if (handler->signal == SIGNAL_DIFF)
+            listening_diffs = listening_diffs || !handler->detail;
+        else if (!handler->detail)
+            listening = TRUE;
+    }
+
+    if (listening_changes && !self->changes)
+        m_attach_changes(self);
+    else if (!listening_changes && self->changes)
+        m_detach_changes(self, self->entry);
+
+    if (listening != self->listening) {
+        g_atomic_int_add(&self->entry->n_listeners, listening ? 1 : -1);
+        self->listening = listening;
+    }
+    if (listening_events != self->listening_events) {
+        g_atomic_int_add(&self->entry->n_event_listeners, 
+                         listening_events ? 1 : -1);
+        self->listening_events = listening_events;
+    }
+    if (listening_diffs != self->listening_diffs) {
+        m_add_diff_listener(self->entry, listening_diffs ? 1 : -1);
+        self->listening_diffs = listening_diffs;
+    }
+}
+
+/* Drops every handler. Callbacks are released last, their destructors may 
+ * run Python code that touches this object
+ */
+static void m_clear_handlers(DeepinGSettingsObject *self) 
+{
+    GArray *handlers = self->handlers;
+    SignalHandler *handler = NULL;
+    guint i;
+
+    if (!handlers)
+        return;
+
+    self->handlers = NULL;
+    for (i = 0; i < handlers->len; i++) {
+        handler = &g_array_index(handlers, SignalHandler, i);
+        if (handler->detail && self->entry)
+            m_add_key_listener(self->entry, 
+                               handler->signal, 
+                               handler->detail, 
+                               -1);
+    }
+    m_update_listening(self);
+
+    for (i = 0; i < handlers->len; i++)
+        Py_DECREF(g_array_index(handlers, SignalHandler, i).callback);
+    g_array_free(handlers, TRUE);
+}
+
+static void m_unsubscribe(DeepinGSettingsObject *self) 
+{
+    SettingsEntry *entry = self->entry;
+    SignalHandler *handler = NULL;
+    guint i;
+
+    if (!entry)
+        return;
+
+    if (self->listening) {
+        g_atomic_int_add(&entry->n_listeners, -1);
+        self->listening = FALSE;
+    }
+    if (self->listening_events) {
+        g_atomic_int_add(&entry->n_event_listeners, -1);
+        self->listening_events = FALSE;
+    }
+    if (self->listening_diffs) {
+        m_add_diff_listener(entry, -1);
+        self->listening_diffs = FALSE;
+    }
+    m_detach_changes(self, entry);
+    for (i = 0; self->handlers && i < self->handlers->len; i++) {
+        handler = &g_array_index(self->handlers, SignalHandler, i);
+        if (handler->detail)
+            m_add_key_listener(entry, handler->signal, handler->detail, -1);
+    }
+    entry->subscribers = g_slist_remove(entry->subscribers, self);
+    self->entry = NULL;
+
+    if (!--entry->n_objects)
+        m_release_entry(entry);
+}
+
+static gboolean m_attach_entry(DeepinGSettingsObject *self, 
+                               const gchar *schema_id, 
+                               const gchar *path) 
+{
+    SettingsEntry *entry = NULL;
+
+    entry = m_lookup_entry(m_get_state(self->module), schema_id, path);
+    if (!entry) {
+        ERROR(path ? "g_settings_new_with_path error" : "g_settings_new error");
+        return FALSE;
+    }
+    entry->n_objects++;
+
+    self->entry = entry;
+    self->handle = g_object_ref(entry->handle);
+    self->writer = deepin_gsettings_writer_new(entry->settings);
+    deepin_gsettings_writer_set_sync_policy(self->writer, 
+                                            self->sync_policy, 
+                                            self->sync_interval);
+    entry->subscribers = g_slist_prepend(entry->subscribers, self);
+    /* Cached handles skip deepin_gsettings_new_handle(), which drops it too */
+    deepin_gsettings_drop_snapshot();
+
+    return TRUE;
+}
+
+/* Attaches a lazy object to its handle, creating it if need be. FALSE 
+ * with an exception set when that fails
+ */
+static gboolean m_realize(DeepinGSettingsObject *self) 
+{
+    gchar *schema_id = self->lazy_schema_id;
+    gchar *path = self->lazy_path;
+    gboolean ret = FALSE;
+
+    if (!schema_id)
+        return TRUE;
+
+    /* Taken first, m_lookup_entry may release the GIL */
+    self->lazy_schema_id = NULL;
+    self->lazy_path = NULL;
+    ret = m_attach_entry(self, schema_id, path);
+    g_free(schema_id);
+    g_free(path);
+
+    return ret;
+}
+
+/* A lazy object only keeps its arguments, the GSettings, its schema 
+ * lookup and its signal handlers come with the first call that needs them
+ */
+static DeepinGSettingsObject *m_new_from_cache(PyObject *module, 
+                                               const gchar *schema_id, 
+                                               const gchar *path, 
+                                               int lazy) 
+{
+    DeepinGSettingsObject *self = NULL;
+
+    self = m_init_deepin_gsettings_object(module);
+    if (!self)
+        return NULL;
+
+    if (lazy) {
+        self->lazy_schema_id = g_strdup(schema_id);
+        self->lazy_path = g_strdup(path);
+    } else if (!m_attach_entry(self, schema_id, path)) {
+        Py_DECREF(self);
+        return NULL;
+    }
+
+    return self;
+}
+
+static DeepinGSettingsObject *m_new(PyObject *module, 
+                                    PyObject *args, 
+                                    PyObject *kwds) 
+{
+    static char *kwlist[] = {"schema_id", "lazy", NULL};
+    gchar *schema_id = NULL;
+    int lazy = 0;
+
+    if (!PyArg_ParseTupleAndKeywords(args, kwds, "s|p", kwlist, 
+                                     &schema_id, &lazy))
+        return NULL;
+
+    return m_new_from_cache(module, schema_id, NULL, lazy);
+}
+
+static DeepinGSettingsObject *m_new_with_path(PyObject *module, 
+                                              PyObject *args, 
+                                              PyObject *kwds) 
+{
+    static char *kwlist[] = {"schema_id", "path", "lazy", NULL};
+    gchar *schema_id = NULL;
+    gchar *path = NULL;    
+    int lazy = 0;
+
+    if (!PyArg_ParseTupleAndKeywords(args, kwds, "ss|p", kwlist, 
+                                     &schema_id, &path, &lazy))
+        return NULL;
+
+    return m_new_from_cache(module, schema_id, path, lazy);
+}
+
+/* Arguments of m_list_handle_cb */
+typedef struct {
+    GHashTable *entries;
+    PyObject *list;         /* NULL once an append failed */
+} HandleListing;
+
+static void m_list_handle_cb(DeepinGSettings *settings, 
+                             const gchar *schema_id, 
+                             const gchar *path, 
+                             guint n_users, 
+                             gpointer user_data) 
+{
+    HandleListing *listing = (HandleListing *) user_data;
+    SettingsEntry *entry = g_hash_table_lookup(listing->entries, settings);
+    PyObject *item = NULL;
+
+    if (!listing->list)
+        return;
+
+    item = Py_BuildValue("(szI)", 
+                         schema_id, 
+                         path, 
+                         entry ? entry->n_objects : 0);
+    if (!item || PyList_Append(listing->list, item) < 0)
+        ZAP(listing->list);
+    Py_XDECREF(item);
+}
+
+static PyObject *m_handle_cache_info(PyObject *module, 
+                                     PyObject *Py_UNUSED(ignored)) 
+{
+    HandleListing listing = {m_get_state(module)->settings_cache, NULL};
+
+    listing.list = PyList_New(0);
+    if (!listing.list)
+        return NULL;
+
+    deepin_gsettings_foreach(m_list_handle_cb, &listing);
+
+    return listing.list;
+}
+
+static PyObject *m_clear_handle_cache(PyObject *module, 
+                                      PyObject *Py_UNUSED(ignored)) 
+{
+    return INT(deepin_gsettings_clear_cache());
+}
+
+static gpointer m_dispatch_thread_func(gpointer data) 
+{
+    GMainLoop *loop = (GMainLoop *) data;
+    GMainContext *context = g_main_loop_get_context(loop);
+
+    /* Handles created from callbacks run in place, see m_new_handle */
+    g_main_context_push_thread_default(context);
+    g_main_loop_run(loop);
+    g_main_context_pop_thread_default(context);
+    return NULL;
+}
+
+/* Quitting from the dispatcher context also stops a loop that is not 
+ * running yet, g_main_loop_quit() before g_main_loop_run() is lost
+ */
+static gboolean m_quit_dispatcher_cb(gpointer data) 
+{
+    g_main_loop_quit((GMainLoop *) data);
+    return FALSE;
+}
+
+static PyObject *m_start_dispatcher(PyObject *module, 
+                                    PyObject *args, 
+                                    PyObject *kwds) 
+{
+    static char *kwlist[] = {"queue", NULL};
+    PyObject *queue = Py_False;
+    int queued = 0;
+
+    if (!PyArg_ParseTupleAndKeywords(args, kwds, "|O", kwlist, &queue)) {
+        ERROR("invalid arguments to start_dispatcher");
+        return NULL;
+    }
+    queued = PyObject_IsTrue(queue);
+    if (queued < 0)
+        return NULL;
+
+    if (queued && m_event_fd < 0) {
+        m_event_fd = eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC);
+        if (m_event_fd < 0)
+            return PyErr_SetFromErrno(PyExc_OSError);
+    }
+    g_atomic_int_set(&m_dispatch_queued, queued);
+
+    if (m_dispatch_loop) {
+        Py_INCREF(Py_False);
+        return Py_False;
+    }
+
+    /* Cached handles deliver to the default context, the library drops them */
+    m_dispatch_context = g_main_context_new();
+    deepin_gsettings_set_context(m_dispatch_context);
+
+    m_dispatch_loop = g_main_loop_new(m_dispatch_context, FALSE);
+    m_dispatch_thread = g_thread_new("deepin-gsettings", 
+                                     m_dispatch_thread_func, 
+                                     m_dispatch_loop);
+
+    Py_INCREF(Py_True);
+    return Py_True;
+}
+
+static PyObject *m_stop_dispatcher(PyObject *module, 
+                                   PyObject *Py_UNUSED(ignored)) 
+{
+    GMainLoop *loop = m_dispatch_loop;
+    GThread *thread = m_dispatch_thread;
+    GMainContext *context = m_dispatch_context;
+    GSource *quit = NULL;
+
+    if (!loop) {
+        Py_INCREF(Py_False);
+        return Py_False;
+    }
+
+    m_dispatch_loop = NULL;
+    m_dispatch_thread = NULL;
+    quit = g_idle_source_new();
+    g_source_set_callback(quit, m_quit_dispatcher_cb, loop, NULL);
+    g_source_attach(quit, context);
+    g_source_unref(quit);
+
+    /* Handles and sources made from now on use the default context again, 
+     * and cached handles, which would deliver to the dropped one, go
+     */
+    m_dispatch_context = NULL;
+    deepin_gsettings_set_context(NULL);
+
+    /* The thread may be waiting for the GIL in a callback. Pending flushes 
+     * and deliveries run then, and handle creations other threads wait for
+     */
+    Py_BEGIN_ALLOW_THREADS
+    g_thread_join(thread);
+    deepin_gsettings_drain_context(context);
+    Py_END_ALLOW_THREADS
+    g_main_loop_unref(loop);
+    g_main_context_unref(context);
+
+    Py_INCREF(Py_True);
+    return Py_True;
+}
+
+static PyObject *m_changes_fd(PyObject *dummy, PyObject *Py_UNUSED(ignored)) 
+{
+    if (m_event_fd < 0) {
+        ERROR("changes_fd needs start_dispatcher(queue=True)");
+        return NULL;
+    }
+
+    return INT(m_event_fd);
+}
+
+/* Runs the handlers of the queued events in the calling thread and returns 
+ * them as (schema_id, path, key) tuples, path being None for new()
+ */
+static PyObject *m_wait_changes(PyObject *dummy, PyObject *args) 
+{
+    PyObject *timeout = Py_None;
+    PyObject *list = NULL;
+    PyObject *item = NULL;
+    ChangeEvent *events = NULL;
+    ChangeEvent *event = NULL;
+    SettingsEntry *entry = NULL;
+    struct pollfd pfd;
+    gint64 deadline = -1;
+    gint64 now = 0;
+    double seconds = 0;
+    int wait = -1;
+
+    if (!PyArg_ParseTuple(args, "|O", &timeout)) {
+        ERROR("invalid arguments to wait_changes");
+        return NULL;
+    }
+
+    if (m_event_fd < 0) {
+        ERROR("wait_changes needs start_dispatcher(queue=True)");
+        return NULL;
+    }
+
+    if (timeout != Py_None) {
+        seconds = PyFloat_AsDouble(timeout);
+        if (seconds == -1 && PyErr_Occurred())
+            return NULL;
+        deadline = g_get_monotonic_time() + (gint64) (seconds * G_USEC_PER_SEC);
+    }
+
+    list = PyList_New(0);
+    while (list) {
+        events = m_take_events();
+        for (event = events; event; event = events) {
+            events = event->next;
+            entry = event->entry;
+            if (list && event->key) {
+                m_emit_changed(entry, g_quark_to_string(event->key), event->key);
+                if (event->diff)
+                    m_emit_diff(entry, 
+                                g_quark_to_string(event->key), 
+                                event->key, 
+                                event->old_value, 
+                                event->new_value);
+                item = Py_BuildValue("(szs)", 
+                                     entry->schema_id, 
+                                     entry->path, 
+                                     g_quark_to_string(event->key));
+                if (!item || PyList_Append(list, item) < 0)
+                    ZAP(list);
+                Py_XDECREF(item);
+            } else if (list) {
+                m_emit_change_event(entry, event->keys, event->n_keys);
+            }
+            m_free_event(event);
+        }
+
+        /* A "change-event" alone does not end the wait */
+        if (!list || PyList_GET_SIZE(list))
+            break;
+
+        if (deadline >= 0) {
+            now = g_get_monotonic_time();
+            if (now >= deadline)
+                break;
+            wait = (deadline - now + 999) / 1000;
+        }
+
+        pfd.fd = m_event_fd;
+        pfd.events = POLLIN;
+        Py_BEGIN_ALLOW_THREADS
+        poll(&pfd, 1, wait);
+        Py_END_ALLOW_THREADS
+
+        if (PyErr_CheckSignals() < 0)
+            ZAP(list);
+    }
+
+    return list;
+}
+
+static void m_free_write_job(WriteJob *job) 
+{
+    guint i;
+
+    for (i = 0; i < job->n_values; i++)
+        g_variant_unref(job->values[i]);
+    g_free(job->values);
+    g_strfreev(job->keys);
+    g_free(job);
+}
+
+/* The library's write worker holds the GIL around its callbacks */
+static gpointer m_write_lock_gil(void) 
+{
+    return GINT_TO_POINTER(PyGILState_Ensure());
+}
+
+static void m_write_unlock_gil(gpointer token) 
+{
+    PyGILState_Release((PyGILState_STATE) GPOINTER_TO_INT(token));
+}
+
+/* Resolves the future of a write, GIL held by the write worker */
+static void m_write_done(gboolean written, gpointer user_data) 
+{
+    PyObject *future = (PyObject *) user_data;
+    PyObject *ret = NULL;
+
+    ret = PyObject_CallMethod(future, 
+                              "set_result", 
+                              "O", 
+                              written ? Py_True : Py_False);
+    if (!ret)
+        PyErr_Print();
+    Py_XDECREF(ret);
+    Py_DECREF(future);
+}
+
+static PyObject *m_wait_writes(PyObject *dummy, PyObject *Py_UNUSED(ignored)) 
+{
+    Py_BEGIN_ALLOW_THREADS
+    deepin_gsettings_wait_writes();
+    Py_END_ALLOW_THREADS
+
+    Py_INCREF(Py_True);
+    return Py_True;
+}
+
+static PyObject *m_enable_stats(PyObject *module, PyObject *enabled) 
+{
+    ModuleState *state = m_get_state(module);
+    int on = PyObject_IsTrue(enabled);
+    gboolean was_on = FALSE;
+
+    if (on < 0)
+        return NULL;
+
+    was_on = g_atomic_int_get(&state->stats_enabled);
+    g_atomic_int_set(&state->stats_enabled, on);
+
+    return PyBool_FromLong(was_on);
+}
+
+/* Buckets are read one by one while other threads may add to them, so a 
+ * probe's buckets can be a few calls ahead of its calls
+ */
+static PyObject *m_histogram_to_object(Histogram *histogram) 
+{
+    PyObject *buckets = PyList_New(0);
+    PyObject *bucket = NULL;
+    guint64 count;
+    int i;
+
+    if (!buckets)
+        return NULL;
+
+    for (i = 0; i < STAT_BUCKETS; i++) {
+        count = STAT_GET(histogram->buckets[i]);
+        if (!count)
+            continue;
+        bucket = Py_BuildValue("(KK)", 
+                               (unsigned long long) 1 << i, 
+                               (unsigned long long) count);
+        if (!bucket || PyList_Append(buckets, bucket) < 0) {
+            Py_XDECREF(bucket);
+            Py_DECREF(buckets);
+            return NULL;
+        }
+        Py_DECREF(bucket);
+    }
+
+    return Py_BuildValue("{s:K,s:K,s:N}", 
+                         "calls", 
+                         (unsigned long long) STAT_GET(histogram->calls), 
+                         "total_ns", 
+                         (unsigned long long) STAT_GET(histogram->total_ns), 
+                         "histogram", buckets);
+}
+
+static PyObject *m_stats(PyObject *module, PyObject *Py_UNUSED(ignored)) 
+{
+    ModuleState *state = m_get_state(module);
+    PyObject *probes = PyDict_New();
+    PyObject *probe = NULL;
+    int i;
+
+    if (!probes)
+        return NULL;
+
+    for (i = 0; i < STAT_COUNT; i++) {
+        probe = m_histogram_to_object(&state->stats[i]);
+        if (!probe || PyDict_SetItemString(probes, m_stat_names[i], probe) < 0) {
+            Py_XDECREF(probe);
+            Py_DECREF(probes);
+            return NULL;
+        }
+        Py_DECREF(probe);
+    }
+
+    return Py_BuildValue("{s:O,s:N,s:K}", 
+                         "enabled", 
+                         g_atomic_int_get(&state->stats_enabled) ? 
+                         Py_True : Py_False, 
+                         "probes", probes, 
+                         "diff_suppressed", 
+                         (unsigned long long) STAT_GET(state->diff_suppressed));
+}
+
+static PyObject *m_reset_stats(PyObject *module, PyObject *Py_UNUSED(ignored)) 
+{
+    ModuleState *state = m_get_state(module);
+    Histogram *histogram = NULL;
+    int i, j;
+
+    for (i = 0; i < STAT_COUNT; i++) {
+        histogram = &state->stats[i];
+        STAT_ZERO(histogram->calls);
+        STAT_ZERO(histogram->total_ns);
+        for (j = 0; j < STAT_BUCKETS; j++)
+            STAT_ZERO(histogram->buckets[j]);
+    }
+    STAT_ZERO(state->diff_suppressed);
+
+    Py_INCREF(Py_True);
+    return Py_True;
+}
+
+static PyObject *m_delete(DeepinGSettingsObject *self, 
+                          PyObject *Py_UNUSED(ignored)) 
+{
+    DeepinGSettingsWriter *writer = NULL;
+
+    /* Leave the subscriber list before anything releases the GIL, another 
+     * thread delivering a signal must not pick this object up any more
+     */
+    m_unsubscribe(self);
+
+    g_free(self->lazy_schema_id);
+    self->lazy_schema_id = NULL;
+    g_free(self->lazy_path);
+    self->lazy_path = NULL;
+
+    writer = self->writer;
+    self->writer = NULL;
+    if (writer) {
+        Py_BEGIN_ALLOW_THREADS
+        deepin_gsettings_writer_flush(writer);
+        deepin_gsettings_writer_unref(writer);
+        Py_END_ALLOW_THREADS
+    }
+
+    if (self->handle) {
+        g_object_unref(self->handle);
+        self->handle = NULL;
+    }
+
+    /* Unapplied batch writes are dropped with the delayed handle */
+    if (self->batch_handle) {
+        g_object_unref(self->batch_handle);
+        self->batch_handle = NULL;
+        self->batch_depth = 0;
+    }
+
+    m_clear_handlers(self);
+    ZAP(self->value_cache);
+
+    Py_INCREF(Py_None);
+    return Py_None;
+}
+
+static PyObject *m_set_sync_policy(DeepinGSettingsObject *self, 
+                                   PyObject *args) 
+{
+    int policy = SYNC_IMMEDIATE;
+    unsigned int interval = 0;
+
+    if (!PyArg_ParseTuple(args, "i|I", &policy, &interval)) {
+        ERROR("invalid arguments to set_sync_policy");
+        return NULL;
+    }
+
+    if (policy < SYNC_IMMEDIATE || policy > SYNC_MANUAL) {
+        ERROR("invalid sync policy");
+        return NULL;
+    }
+
+    /* Whatever is queued under the old policy goes out now */
+    m_flush_pending(self);
+
+    self->sync_policy = policy;
+    self->sync_interval = interval;
+    if (self->writer)
+        deepin_gsettings_writer_set_sync_policy(self->writer, policy, interval);
+
+    Py_INCREF(Py_True);
+    return Py_True;
+}
+
+static PyObject *m_get_sync_policy(DeepinGSettingsObject *self, 
+                                   PyObject *Py_UNUSED(ignored)) 
+{
+    return INT(self->sync_policy);
+}
+
+static PyObject *m_flush(DeepinGSettingsObject *self, 
+                         PyObject *Py_UNUSED(ignored)) 
+{
+    m_flush_pending(self);
+
+    Py_INCREF(Py_True);
+    return Py_True;
+}
+
+static PyObject *m_batch(DeepinGSettingsObject *self, 
+                         PyObject *Py_UNUSED(ignored)) 
+{
+    DeepinGSettingsBatchObject *batch = NULL;
+
+    batch = PyObject_GC_New(DeepinGSettingsBatchObject, 
+                            m_get_state(self->module)->batch_type);
+    if (!batch)
+        return NULL;
+
+    Py_INCREF(self);
+    batch->settings = self;
+    PyObject_GC_Track(batch);
+
+    return (PyObject *) batch;
+}
+
+static PyObject *m_batch_enter(DeepinGSettingsBatchObject *self, 
+                               PyObject *Py_UNUSED(ignored)) 
+{
+    if (!self->settings || !m_begin_batch(self->settings))
+        return NULL;
+
+    Py_INCREF(self->settings);
+    return (PyObject *) self->settings;
+}
+
+static PyObject *m_batch_exit(DeepinGSettingsBatchObject *self, 
+                              PyObject *args) 
+{
+    PyObject *exc_type = NULL;
+    PyObject *exc_value = NULL;
+    PyObject *traceback = NULL;
+
+    if (!PyArg_ParseTuple(args, "OOO", &exc_type, &exc_value, &traceback)) {
+        ERROR("invalid arguments to __exit__");
+        return NULL;
+    }
+
+    if (self->settings)
+        m_end_batch(self->settings, exc_type == Py_None);
+
+    /* Never swallow the exception that caused the revert */
+    Py_INCREF(Py_False);
+    return Py_False;
+}
+
+static PyObject *m_set_many(DeepinGSettingsObject *self, PyObject *args) 
+{
+    PyObject *values = NULL;
+    PyObject *key = NULL;
+    PyObject *value = NULL;
+    Py_ssize_t pos = 0;
+    const KeyInfo *key_info = NULL;
+    GVariant *variant = NULL;
+
+    if (!PyArg_ParseTuple(args, "O!", &PyDict_Type, &values)) {
+        ERROR("invalid arguments to set_many");
+        return NULL;
+    }
+
+    if (!m_begin_batch(self))
+        return NULL;
+
+    while (PyDict_Next(values, &pos, &key, &value)) {
+        key_info = m_key_info(self, key, NULL);
+        if (!key_info)
+            goto fail;
+        variant = m_object_to_variant(value, key_info->type);
+        if (!variant)
+            goto fail;
+
+        if (!m_write_value(self, key_info, variant)) {
+            m_end_batch(self, FALSE);
+            Py_INCREF(Py_False);
+            return Py_False;
+        }
+    }
+
+    if (!m_end_batch(self, TRUE)) {
+        Py_INCREF(Py_False);
+        return Py_False;
+    }
+
+    Py_INCREF(Py_True);
+    return Py_True;
+
+fail:
+    m_end_batch(self, FALSE);
+    return NULL;
+}
+
+/* A running concurrent.futures.Future, queued writes can not be cancelled */
+static PyObject *m_new_future(ModuleState *state) 
+{
+    PyObject *futures = NULL;
+    PyObject *future = NULL;
+    PyObject *ret = NULL;
+
+    if (!state->future_type) {
+        futures = PyImport_ImportModule("concurrent.futures");
+        if (!futures)
+            return NULL;
+        state->future_type = PyObject_GetAttrString(futures, "Future");
+        Py_DECREF(futures);
+        if (!state->future_type)
+            return NULL;
+    }
+
+    future = PyObject_CallObject(state->future_type, NULL);
+    if (!future)
+        return NULL;
+    ret = PyObject_CallMethod(future, "set_running_or_notify_cancel", NULL);
+    if (!ret) {
+        Py_DECREF(future);
+        return NULL;
+    }
+    Py_DECREF(ret);
+
+    return future;
+}
+
+static gpointer m_preload_thread_func(gpointer data) 
+{
+    PreloadJob *job = (PreloadJob *) data;
+    GSettingsSchemaSource *source = NULL;
+    GSettingsSchema *schema = NULL;
+    GSettings *settings = NULL;
+    PyGILState_STATE gstate;
+    GSList *l = NULL;
+    gchar **id = NULL;
+
+    /* Maps the compiled schemas on first use */
+    source = g_settings_schema_source_get_default();
+    for (id = job->schema_ids; source && *id; id++) {
+        schema = g_settings_schema_source_lookup(source, *id, TRUE);
+        if (schema)
+            job->schemas = g_slist_prepend(job->schemas, schema);
+    }
+
+    /* The first GSettings of the process loads the backend module */
+    if (job->schemas) {
+        schema = (GSettingsSchema *) job->schemas->data;
+        settings = g_settings_new_full(schema, 
+                                       NULL, 
+                                       g_settings_schema_get_path(schema) ? 
+                                       NULL : "/deepin-gsettings/preload/");
+        /* A loaded snapshot stays, the objects reading it hear no changes 
+         * until they get a handle of their own
+         */
+        g_object_unref(settings);
+    }
+
+    gstate = PyGILState_Ensure();
+    for (l = job->schemas; l; l = l->next) {
+        if (!m_schema_info(m_get_state(job->module), l->data))
+            PyErr_Print();
+    }
+    Py_DECREF(job->module);
+    PyGILState_Release(gstate);
+
+    g_slist_free_full(job->schemas, (GDestroyNotify) g_settings_schema_unref);
+    g_strfreev(job->schema_ids);
+    g_free(job);
+
+    g_mutex_lock(&m_preload_lock);
+    m_preloads_in_flight--;
+    g_cond_broadcast(&m_preload_cond);
+    g_mutex_unlock(&m_preload_lock);
+
+    return NULL;
+}
+
+/* Startup work of GIO that new() would otherwise do on first use: the 
+ * schema source, the schemas, the backend and the key tables. Nothing is 
+ * imported, concurrent.futures alone would cost more than it saves
+ */
+static PyObject *m_preload(PyObject *module, PyObject *schema_ids) 
+{
+    PyObject *seq = NULL;
+    const char *schema_id = NULL;
+    PreloadJob *job = NULL;
+    Py_ssize_t n = 0;
+    Py_ssize_t i;
+
+    seq = PySequence_Fast(schema_ids, "preload takes a list of schema ids");
+    if (!seq)
+        return NULL;
+    n = PySequence_Fast_GET_SIZE(seq);
+
+    job = g_new0(PreloadJob, 1);
+    job->schema_ids = g_new0(gchar *, n + 1);
+    for (i = 0; i < n; i++) {
+        schema_id = m_object_as_utf8(PySequence_Fast_GET_ITEM(seq, i));
+        if (!schema_id) {
+            g_strfreev(job->schema_ids);
+            g_free(job);
+            Py_DECREF(seq);
+            return NULL;
+        }
+        job->schema_ids[i] = g_strdup(schema_id);
+    }
+    Py_DECREF(seq);
+
+    Py_INCREF(module);
+    job->module = module;
+
+    g_mutex_lock(&m_preload_lock);
+    m_preloads_in_flight++;
+    g_mutex_unlock(&m_preload_lock);
+
+    g_thread_unref(g_thread_new("deepin-gsettings-preload", 
+                                m_preload_thread_func, 
+                                job));
+
+    Py_INCREF(Py_None);
+    return Py_None;
+}
+
+static PyObject *m_wait_preload(PyObject *dummy, PyObject *Py_UNUSED(ignored)) 
+{
+    Py_BEGIN_ALLOW_THREADS
+    g_mutex_lock(&m_preload_lock);
+    while (m_preloads_in_flight)
+        g_cond_wait(&m_preload_cond, &m_preload_lock);
+    g_mutex_unlock(&m_preload_lock);
+    Py_END_ALLOW_THREADS
+
+    Py_INCREF(Py_True);
+    return Py_True;
+}
+
+static PyObject *m_save_snapshot(PyObject *dummy, PyObject *args) 
+{
+    const char *filename = NULL;
+    PyObject *schemas = NULL;
+    PyObject *seq = NULL;
+    PyObject *item = NULL;
+    const gchar **schema_ids = NULL;
+    const gchar **paths = NULL;
+    GError *error = NULL;
+    gboolean saved = FALSE;
+    Py_ssize_t n = 0;
+    Py_ssize_t i;
+
+    if (!PyArg_ParseTuple(args, "sO", &filename, &schemas)) {
+        ERROR("invalid arguments to save_snapshot");
+        return NULL;
+    }
+    seq = PySequence_Fast(schemas, 
+                          "save_snapshot takes a list of schema ids or "
+                          "(schema_id, path) pairs");
+    if (!seq)
+        return NULL;
+    n = PySequence_Fast_GET_SIZE(seq);
+
+    schema_ids = g_new0(const gchar *, n);
+    paths = g_new0(const gchar *, n);
+    for (i = 0; i < n; i++) {
+        item = PySequence_Fast_GET_ITEM(seq, i);
+        if (PyTuple_Check(item)) {
+            if (!PyArg_ParseTuple(item, "ss", &schema_ids[i], &paths[i]))
+                break;
+        } else {
+            schema_ids[i] = m_object_as_utf8(item);
+            if (!schema_ids[i])
+                break;
+        }
+    }
+
+    if (i == n) {
+        Py_BEGIN_ALLOW_THREADS
+        saved = deepin_gsettings_save_snapshot(filename, 
+                                               schema_ids, 
+                                               paths, 
+                                               n, 
+                                               &error);
+        Py_END_ALLOW_THREADS
+        if (!saved) {
+            PyErr_SetString(error->domain == G_IO_ERROR ? PyExc_ValueError 
+                                                        : PyExc_OSError, 
+                            error->message);
+            g_error_free(error);
+        }
+    }
+    g_free(schema_ids);
+    g_free(paths);
+    Py_DECREF(seq);
+
+    if (!saved)
+        return NULL;
+
+    Py_INCREF(Py_True);
+    return Py_True;
+}
+
+static PyObject *m_load_snapshot(PyObject *dummy, PyObject *filename) 
+{
+    const char *c_filename = NULL;
+    gboolean loaded = FALSE;
+
+    c_filename = m_object_as_utf8(filename);
+    if (!c_filename)
+        return NULL;
+
+    Py_BEGIN_ALLOW_THREADS
+    loaded = deepin_gsettings_load_snapshot(c_filename);
+    Py_END_ALLOW_THREADS
+
+    return PyBool_FromLong(loaded);
+}
+
+static PyObject *m_drop_snapshot(PyObject *dummy, 
+                                 PyObject *Py_UNUSED(ignored)) 
+{
+    return PyBool_FromLong(deepin_gsettings_drop_snapshot());
+}
+
+static PyObject *m_start_recording(PyObject *dummy, 
+                                   PyObject *args, 
+                                   PyObject *kwds) 
+{
+    static char *kwlist[] = {"filename", "capacity", NULL};
+    const char *filename = NULL;
+    Py_ssize_t capacity = RECORD_RING_CAPACITY;
+    GError *error = NULL;
+
+    if (!PyArg_ParseTupleAndKeywords(args, 
+                                     kwds, 
+                                     "|zn", 
+                                     kwlist, 
+                                     &filename, 
+                                     &capacity)) {
+        ERROR("invalid arguments to start_recording");
+        return NULL;
+    }
+    if (capacity <= 0) {
+        PyErr_SetString(PyExc_ValueError, "capacity must be positive");
+        return NULL;
+    }
+
+    if (deepin_gsettings_start_recording(filename, capacity, &error)) {
+        Py_INCREF(Py_True);
+        return Py_True;
+    }
+    if (g_error_matches(error, G_IO_ERROR, G_IO_ERROR_BUSY)) {
+        g_error_free(error);
+        Py_INCREF(Py_False);
+        return Py_False;
+    }
+    PyErr_SetString(PyExc_OSError, error->message);
+    g_error_free(error);
+    return NULL;
+}
+
+static PyObject *m_stop_recording(PyObject *dummy, 
+                                  PyObject *Py_UNUSED(ignored)) 
+{
+    GBytes *recording = NULL;
+    gconstpointer data = NULL;
+    PyObject *ret = NULL;
+    GError *error = NULL;
+    gsize size = 0;
+
+    /* Closing the file may block */
+    Py_BEGIN_ALLOW_THREADS
+    recording = deepin_gsettings_stop_recording(&error);
+    Py_END_ALLOW_THREADS
+
+    if (error) {
+        PyErr_SetString(PyExc_OSError, error->message);
+        g_error_free(error);
+        return NULL;
+    }
+    if (!recording) {
+        Py_INCREF(Py_None);
+        return Py_None;
+    }
+    data = g_bytes_get_data(recording, &size);
+    ret = PyBytes_FromStringAndSize(data, size);
+    g_bytes_unref(recording);
+
+    return ret;
+}
+
+/* Appends a record to the list of read_recording(), none after an error */
+static void m_append_record(gint64 time, 
+                            const gchar *schema_id, 
+                            const gchar *path, 
+                            const gchar *key, 
+                            GVariant *value, 
+                            gpointer user_data) 
+{
+    PyObject *records = (PyObject *) user_data;
+    PyObject *record = NULL;
+    PyObject *obj = NULL;
+
+    if (PyErr_Occurred())
+        return;
+
+    obj = m_variant_to_object(value);
+    if (!obj)
+        return;
+    record = Py_BuildValue("(dszsN)", time / 1e6, schema_id, path, key, obj);
+    if (!record)
+        return;
+    PyList_Append(records, record);
+    Py_DECREF(record);
+}
+
+static PyObject *m_read_recording(PyObject *dummy, PyObject *source) 
+{
+    const char *filename = NULL;
+    GMappedFile *file = NULL;
+    GBytes *data = NULL;
+    GError *error = NULL;
+    PyObject *records = NULL;
+    gboolean read = FALSE;
+
+    if (PyBytes_Check(source)) {
+        data = g_bytes_new(PyBytes_AS_STRING(source), PyBytes_GET_SIZE(source));
+    } else {
+        filename = m_object_as_utf8(source);
+        if (!filename)
+            return NULL;
+        file = g_mapped_file_new(filename, FALSE, &error);
+        if (!file) {
+            PyErr_SetString(PyExc_OSError, error->message);
+            g_error_free(error);
+            return NULL;
+        }
+        data = g_mapped_file_get_bytes(file);
+        g_mapped_file_unref(file);
+    }
+
+    records = PyList_New(0);
+    if (records)
+        read = deepin_gsettings_read_recording(data, 
+                                               m_append_record, 
+                                               records, 
+                                               &error);
+    g_bytes_unref(data);
+    if (!records)
+        return NULL;
+
+    if (!read) {
+        PyErr_SetString(PyExc_ValueError, error->message);
+        g_error_free(error);
+    }
+    if (PyErr_Occurred()) {
+        Py_DECREF(records);
+        return NULL;
+    }
+
+    return records;
+}
+
+/* Converts and range checks value for key of job. -1 with an exception 
+ * set, 0 when the schema refuses the value
+ */
+static int m_add_write(DeepinGSettingsObject *self, 
+                       WriteJob *job, 
+                       PyObject *key, 
+                       PyObject *value) 
+{
+    const KeyInfo *key_info = NULL;
+    GVariant *variant = NULL;
+
+    key_info = m_key_info(self, key, NULL);
+    if (!key_info)
+        return -1;
+    variant = m_object_to_variant(value, key_info->type);
+    if (!variant)
+        return -1;
+
+    g_variant_ref_sink(variant);
+    if (key_info->ranged && 
+        !g_settings_schema_key_range_check(key_info->key, variant)) {
+        g_variant_unref(variant);
+        return 0;
+    }
+
+    job->keys[job->n_values] = g_strdup(key_info->c_name);
+    job->values[job->n_values++] = variant;
+
+    return 1;
+}
+
+/* Hands job to the library's write worker and returns its future. Older writes to 
+ * the same keys waiting for a flush are superseded, as by a batch
+ */
+static PyObject *m_submit_write(DeepinGSettingsObject *self, 
+                                WriteJob *job, 
+                                gboolean refused) 
+{
+    PyObject *future = m_new_future(m_get_state(self->module));
+    PyObject *ret = NULL;
+    guint i;
+
+    if (!future || refused || !self->handle) {
+        if (future)
+            ret = PyObject_CallMethod(future, "set_result", "O", Py_False);
+        m_free_write_job(job);
+        if (future && !ret)
+            Py_CLEAR(future);
+        Py_XDECREF(ret);
+        return future;
+    }
+
+    for (i = 0; i < job->n_values; i++) {
+        m_cache_invalidate(self, job->keys[i]);
+        if (self->writer)
+            deepin_gsettings_writer_discard(self->writer, job->keys[i]);
+    }
+
+    /* The library owns the keys and values from here */
+    Py_INCREF(future);
+    deepin_gsettings_write_async(self->handle, 
+                                 job->keys, 
+                                 job->values, 
+                                 job->n_values, 
+                                 m_write_done, 
+                                 future);
+    g_free(job);
+
+    return future;
+}
+
+static WriteJob *m_new_write_job(gsize n_values) 
+{
+    WriteJob *job = g_new0(WriteJob, 1);
+
+    job->keys = g_new0(gchar *, n_values + 1);
+    job->values = g_new0(GVariant *, n_values);
+
+    return job;
+}
+
+static PyObject *m_set_value_async(DeepinGSettingsObject *self, 
+                                   PyObject *const *args, 
+                                   Py_ssize_t nargs) 
+{
+    WriteJob *job = NULL;
+    int added;
+
+    if (!m_check_nargs("set_value_async", nargs, 2))
+        return NULL;
+
+    job = m_new_write_job(1);
+    added = m_add_write(self, job, args[0], args[1]);
+    if (added < 0) {
+        m_free_write_job(job);
+        return NULL;
+    }
+
+    return m_submit_write(self, job, !added);
+}
+
+static PyObject *m_apply_async(DeepinGSettingsObject *self, PyObject *values) 
+{
+    WriteJob *job = NULL;
+    PyObject *key = NULL;
+    PyObject *value = NULL;
+    Py_ssize_t pos = 0;
+    gboolean refused = FALSE;
+    int added;
+
+    if (!PyDict_Check(values)) {
+        ERROR("apply_async takes a {key: value} dict");
+        return NULL;
+    }
+
+    if (!m_realize(self))
+        return NULL;
+
+    job = m_new_write_job(PyDict_Size(values));
+    while (PyDict_Next(values, &pos, &key, &value)) {
+        added = m_add_write(self, job, key, value);
+        if (added < 0) {
+            m_free_write_job(job);
+            return NULL;
+        }
+        refused = refused || !added;
+    }
+
+    return m_submit_write(self, job, refused);
+}
+
+static PyObject *m_set_read_cache(DeepinGSettingsObject *self, PyObject *args) 
+{
+    PyObject *enabled = NULL;
+
+    if (!PyArg_ParseTuple(args, "O", &enabled)) {
+        ERROR("invalid arguments to set_read_cache");
+        return NULL;
+    }
+
+    if (!PyObject_IsTrue(enabled)) {
+        ZAP(self->value_cache);
+    } else if (!self->value_cache) {
+        self->value_cache = PyDict_New();
+        if (!self->value_cache)
+            return NULL;
+    }
+    self->cache_generation++;
+    m_update_listening(self);
+
+    Py_INCREF(Py_True);
+    return Py_True;
+}
+
+static PyObject *m_read_cache_stats(DeepinGSettingsObject *self, 
+                                    PyObject *Py_UNUSED(ignored)) 
+{
+    return Py_BuildValue("{s:k,s:k,s:n}", 
+                         "hits", self->cache_hits, 
+                         "misses", self->cache_misses, 
+                         "size", 
+                         self->value_cache ? PyDict_Size(self->value_cache) : 0);
+}
+
+static PyObject *m_object_stats(DeepinGSettingsObject *self, 
+                                PyObject *Py_UNUSED(ignored)) 
+{
+    PyObject *calls = PyDict_New();
+    PyObject *keys = PyDict_New();
+    PyObject *count = NULL;
+    SchemaInfo *info = self->entry ? self->entry->info : NULL;
+    gsize i;
+
+    if (!calls || !keys)
+        goto fail;
+
+    for (i = 0; self->stat_calls && i < STAT_COUNT; i++) {
+        if (!STAT_GET(self->stat_calls[i]))
+            continue;
+        count = PyLong_FromUnsignedLongLong(STAT_GET(self->stat_calls[i]));
+        if (!count || PyDict_SetItemString(calls, m_stat_names[i], count) < 0)
+            goto fail;
+        Py_DECREF(count);
+    }
+
+    /* Per key counts are only known while the object has its schema */
+    for (i = 0; info && self->key_calls && i < info->n_keys; i++) {
+        if (!STAT_GET(self->key_calls[i]))
+            continue;
+        count = PyLong_FromUnsignedLongLong(STAT_GET(self->key_calls[i]));
+        if (!count || PyDict_SetItem(keys, info->keys[i].name, count) < 0)
+            goto fail;
+        Py_DECREF(count);
+    }
+
+    return Py_BuildValue("{s:N,s:N,s:K}", 
+                         "calls", calls, 
+                         "keys", keys, 
+                         "callbacks", 
+                         (unsigned long long) STAT_GET(self->callbacks));
+
+fail:
+    Py_XDECREF(count);
+    Py_XDECREF(calls);
+    Py_XDECREF(keys);
+    return NULL;
+}
+
+static PyObject *m_object_reset_stats(DeepinGSettingsObject *self, 
+                                      PyObject *Py_UNUSED(ignored)) 
+{
+    g_free(self->stat_calls);
+    self->stat_calls = NULL;
+    g_free(self->key_calls);
+    self->key_calls = NULL;
+    self->callbacks = 0;
+
+    Py_INCREF(Py_True);
+    return Py_True;
+}
+
+static PyObject *m_connect(DeepinGSettingsObject *self, PyObject *args) 
+{
+    gchar *name = NULL;
+    const gchar *detail = NULL;
+    PyObject *fptr = NULL;
+    SignalHandler handler;
+
+    if (!PyArg_ParseTuple(args, "sO:set_callback", &name, &fptr)) { 
+        ERROR("invalid arguments to connect");
+        return NULL;
+    }
+
+    if (!PyCallable_Check(fptr)) {
+        Py_INCREF(Py_False);
+        return Py_False;
+    }
+
+    if (!m_realize(self))
+        return NULL;
+
+    handler.detail = 0;
+    if (strcmp(name, "changed") == 0) { 
+        handler.signal = SIGNAL_CHANGED;
+    } else if (g_str_has_prefix(name, "changed::")) {
+        handler.signal = SIGNAL_CHANGED;
+        detail = name + strlen("changed::");
+    } else if (strcmp(name, "change-event") == 0) {
+        handler.signal = SIGNAL_CHANGE_EVENT;
+    } else if (strcmp(name, "changes") == 0) {
+        handler.signal = SIGNAL_CHANGES;
+    } else if (strcmp(name, "diff") == 0) {
+        handler.signal = SIGNAL_DIFF;
+    } else if (g_str_has_prefix(name, "diff::")) {
+        handler.signal = SIGNAL_DIFF;
+        detail = name + strlen("diff::");
+    } else {
+        Py_INCREF(Py_False);
+        return Py_False;
+    }
+
+    if (detail) {
+        if (self->entry && 
+            !PyDict_GetItemString(self->entry->info->index, detail)) {
+            PyErr_SetString(PyExc_KeyError, detail);
+            return NULL;
+        }
+        handler.detail = g_quark_from_string(detail);
+    }
+
+    if (!self->handlers)
+        self->handlers = g_array_new(FALSE, FALSE, sizeof(SignalHandler));
+    handler.id = ++m_get_state(self->module)->last_handler_id;
+    handler.callback = fptr;
+    Py_INCREF(fptr);
+    g_array_append_val(self->handlers, handler);
+
+    if (handler.detail && self->entry)
+        m_add_key_listener(self->entry, handler.signal, handler.detail, 1);
+    m_update_listening(self);
+    if (handler.signal == SIGNAL_DIFF && self->entry)
+        m_seed_last_seen(self->entry, handler.detail);
+
+    return PyLong_FromLong(handler.id);
+}
+
+static PyObject *m_disconnect(DeepinGSettingsObject *self, PyObject *args) 
+{
+    SignalHandler *handler = NULL;
+    PyObject *callback = NULL;
+    long id = 0;
+    guint i;
+
+    if (!PyArg_ParseTuple(args, "l", &id)) {
+        ERROR("invalid arguments to disconnect");
+        return NULL;
+    }
+
+    for (i = 0; self->handlers && i < self->handlers->len; i++) {
+        handler = &g_array_index(self->handlers, SignalHandler, i);
+        if (handler->id != id)
+            continue;
+
+        if (handler->detail && self->entry)
+            m_add_key_listener(self->entry, 
+                               handler->signal, 
+                               handler->detail, 
+                               -1);
+        callback = handler->callback;
+        g_array_remove_index(self->handlers, i);
+        m_update_listening(self);
+        Py_DECREF(callback);
+
+        Py_INCREF(Py_True);
+        return Py_True;
+    }
+
+    Py_INCREF(Py_False);
+    return Py_False;
+}
+
+static PyObject *m_set_changes_interval(DeepinGSettingsObject *self, 
+                                        PyObject *args) 
+{
+    unsigned int interval = 0;
+
+    if (!PyArg_ParseTuple(args, "I", &interval)) {
+        ERROR("invalid arguments to set_changes_interval");
+        return NULL;
+    }
+
+    self->changes_interval = interval;
+    if (self->changes)
+        deepin_gsettings_set_changes_interval(self->entry->settings, 
+                                              self->changes_id, 
+                                              interval);
+
+    Py_INCREF(Py_None);
+    return Py_None;
+}
+
+static PyObject *m_reset(DeepinGSettingsObject *self, PyObject *key) 
+{
+    const KeyInfo *key_info = NULL;
+    GSettings *handle = NULL;
+
+    key_info = m_key_info(self, key, NULL);
+    if (!key_info)
+        return NULL;
+
+    /* A queued write would undo the reset on the next flush */
+    if (self->writer)
+        deepin_gsettings_writer_discard(self->writer, key_info->c_name);
+    m_cache_invalidate(self, key_info->c_name);
+
+    /* Inside a batch the reset is applied, or reverted, with the batch */
+    handle = m_ref_handle(self->batch_depth ? self->batch_handle : self->handle);
+    if (!handle) {
+        Py_INCREF(Py_False);
+        return Py_False;
+    }
+
+    Py_BEGIN_ALLOW_THREADS
+    g_settings_reset(handle, key_info->c_name);
+    g_object_unref(handle);
+    Py_END_ALLOW_THREADS
+
+    Py_INCREF(Py_True);                                                         
+    return Py_True;        
+}
+
+static PyObject *m_list_keys(DeepinGSettingsObject *self, 
+                             PyObject *Py_UNUSED(ignored)) 
+{
+    if (!m_realize(self))
+        return NULL;
+
+    if (!self->entry) {
+        ERROR("deepin_gsettings object has been deleted");
+        return NULL;
+    }
+
+    /* A new list, but of the schema's shared interned names */
+    return PySequence_List(self->entry->info->names);
+}
+
+/* Reads all requested values in one GIL-released pass, then converts them 
+ * with m_variant_to_object. Unflushed writes are taken from pending
+ */
+static PyObject *m_snapshot(DeepinGSettingsObject *self, 
+                            PyObject *args, 
+                            PyObject *kwds) 
+{
+    static char *kwlist[] = {"keys", NULL};
+    PyObject *keys = Py_None;
+    PyObject *seq = NULL;
+    PyObject *ret = NULL;
+    PyObject *item = NULL;
+    GSettings *handle = NULL;
+    const KeyInfo **key_infos = NULL;
+    GVariant **values = NULL;
+    SchemaInfo *info = NULL;
+    gsize n = 0;
+    gsize i;
+
+    if (!PyArg_ParseTupleAndKeywords(args, kwds, "|O", kwlist, &keys)) {
+        ERROR("invalid arguments to snapshot");
+        return NULL;
+    }
+
+    if (!m_realize(self))
+        return NULL;
+
+    handle = m_ref_handle(m_read_handle(self));
+    if (!handle || !self->entry) {
+        ERROR("deepin_gsettings object has been deleted");
+        return NULL;
+    }
+    info = self->entry->info;
+
+    if (keys == Py_None) {
+        n = info->n_keys;
+        key_infos = g_new(const KeyInfo *, n);
+        for (i = 0; i < n; i++)
+            key_infos[i] = &info->keys[i];
+    } else {
+        seq = PySequence_Fast(keys, "snapshot keys must be iterable");
+        if (!seq)
+            goto out;
+        n = PySequence_Fast_GET_SIZE(seq);
+        key_infos = g_new(const KeyInfo *, n);
+        for (i = 0; i < n; i++) {
+            key_infos[i] = m_key_info(self, PySequence_Fast_GET_ITEM(seq, i), NULL);
+            if (!key_infos[i])
+                goto out;
+        }
+    }
+
+    values = g_new0(GVariant *, n);
+    for (i = 0; i < n; i++)
+        values[i] = m_pending_value(self, key_infos[i]->c_name);
+
+    Py_BEGIN_ALLOW_THREADS
+    for (i = 0; i < n; i++) {
+        if (!values[i]) {
+            values[i] = g_settings_get_value(handle, 
+                                             key_infos[i]->c_name);
+        }
+    }
+    Py_END_ALLOW_THREADS
+
+    /* Keyed by the interned names, shared by snapshots of every path */
+    ret = PyDict_New();
+    for (i = 0; ret && i < n; i++) {
+        item = m_variant_to_object(values[i]);
+        if (!item || PyDict_SetItem(ret, key_infos[i]->name, item) < 0)
+            ZAP(ret);
+        Py_XDECREF(item);
+    }
+
+out:
+    if (values) {
+        for (i = 0; i < n; i++) {
+            if (values[i])
+                g_variant_unref(values[i]);
+        }
+        g_free(values);
+    }
+    g_free(key_infos);
+    Py_XDECREF(seq);
+    g_object_unref(handle);
+
+    return ret;
+}
+
+/* Getters take their key with METH_O and setters take (key, value) with 
+ * METH_FASTCALL, so neither an argument tuple nor a PyArg format string is 
+ * involved in a call
+ */
+static gboolean m_check_nargs(const char *name, 
+                              Py_ssize_t nargs, 
+                              Py_ssize_t expected) 
+{
+    if (nargs == expected)
+        return TRUE;
+
+    PyErr_Format(PyExc_TypeError, 
+                 "%s() takes exactly %zd arguments (%zd given)", 
+                 name, 
+                 expected, 
+                 nargs);
+    return FALSE;
+}
+
+/* Read cache, key of type, read and conversion shared by the typed getters */
+static PyObject *m_get_typed(DeepinGSettingsObject *self, 
+                             PyObject *key, 
+                             const GVariantType *type) 
+{
+    GVariant *value = NULL;
+    PyObject *cached = NULL;
+    PyObject *ret = NULL;
+    guint generation = 0;
+
+    cached = m_cache_lookup(self, key, type, &generation);
+    if (cached) {
+        Py_INCREF(cached);
+        return cached;
+    }
+
+    value = m_read_key(self, key, type);
+    if (!value)
+        return NULL;
+    ret = m_variant_to_object(value);
+    g_variant_unref(value);
+
+    return m_cache_store(self, key, type, generation, ret);
+}
+
+/* TIP: Please do not directly return Py_True, call Py_INCREF(Py_True) at first
+ *      Python GC will free Py_True when reference counting is 0
+ */
+static PyObject *m_set_typed(DeepinGSettingsObject *self, 
+                             const char *name, 
+                             PyObject *const *args, 
+                             Py_ssize_t nargs, 
+                             const GVariantType *type) 
+{
+    const KeyInfo *key_info = NULL;
+    GVariant *variant = NULL;
+
+    if (!m_check_nargs(name, nargs, 2))
+        return NULL;
+
+    key_info = m_key_info(self, args[0], type);
+    if (!key_info)
+        return NULL;
+    variant = m_object_to_variant(args[1], key_info->type);
+    if (!variant)
+        return NULL;
+
+    if (!m_write_value(self, key_info, variant)) {
+        Py_INCREF(Py_False);
+        return Py_False;
+    }
+
+    Py_INCREF(Py_True);
+    return Py_True;
+}
+
+/* get_value never uses the read cache, its values may be mutable */
+static PyObject *m_get_any(DeepinGSettingsObject *self, PyObject *key) 
+{
+    GVariant *value = NULL;
+    PyObject *ret = NULL;
+
+    value = m_read_key(self, key, NULL);
+    if (!value)
+        return NULL;
+    ret = m_variant_to_object(value);
+    g_variant_unref(value);
+
+    return ret;
+}
+
+/* False for a value a setter refuses before conversion, still counted */
+static PyObject *m_refuse(DeepinGSettingsObject *self, int probe, PyObject *key) 
+{
+    Py_INCREF(Py_False);
+    STATS_RETURN(self, probe, key, Py_False);
+}
+
+static PyObject *m_get_value(DeepinGSettingsObject *self, PyObject *key) 
+{
+    STATS_RETURN(self, STAT_GET_VALUE, key, m_get_any(self, key));
+}
+
+static PyObject *m_get_default(DeepinGSettingsObject *self, PyObject *key) 
+{
+    const KeyInfo *key_info = NULL;
+
+    key_info = m_key_info(self, key, NULL);
+    if (!key_info)
+        return NULL;
+
+    return m_variant_to_object(key_info->default_value);
+}
+
+static PyObject *m_set_value(DeepinGSettingsObject *self, 
+                             PyObject *const *args, 
+                             Py_ssize_t nargs) 
+{
+    STATS_RETURN(self, STAT_SET_VALUE, nargs ? args[0] : NULL, 
+                 m_set_typed(self, "set_value", args, nargs, NULL));
+}
+
+static PyObject *m_get_boolean(DeepinGSettingsObject *self, PyObject *key) 
+{
+    STATS_RETURN(self, STAT_GET_BOOLEAN, key, 
+                 m_get_typed(self, key, G_VARIANT_TYPE_BOOLEAN));
+}
+
+static PyObject *m_set_boolean(DeepinGSettingsObject *self, 
+                               PyObject *const *args, 
+                               Py_ssize_t nargs) 
+{
+    /* Only True and False are taken, anything else is refused */
+    if (nargs == 2 && !PyBool_Check(args[1]))
+        return m_refuse(self, STAT_SET_BOOLEAN, args[0]);
+
+    STATS_RETURN(self, STAT_SET_BOOLEAN, nargs ? args[0] : NULL, 
+                 m_set_typed(self, "set_boolean", args, nargs, 
+                             G_VARIANT_TYPE_BOOLEAN));
+}
+
+static PyObject *m_get_int(DeepinGSettingsObject *self, PyObject *key) 
+{
+    STATS_RETURN(self, STAT_GET_INT, key, 
+                 m_get_typed(self, key, G_VARIANT_TYPE_INT32));
+}
+
+static PyObject *m_set_int(DeepinGSettingsObject *self, 
+                           PyObject *const *args, 
+                           Py_ssize_t nargs) 
+{
+    STATS_RETURN(self, STAT_SET_INT, nargs ? args[0] : NULL, 
+                 m_set_typed(self, "set_int", args, nargs, G_VARIANT_TYPE_INT32));
+}
+
+static PyObject *m_get_uint(DeepinGSettingsObject *self, PyObject *key) 
+{
+    STATS_RETURN(self, STAT_GET_UINT, key, 
+                 m_get_typed(self, key, G_VARIANT_TYPE_UINT32));
+}
+
+static PyObject *m_set_uint(DeepinGSettingsObject *self, 
+                            PyObject *const *args, 
+                            Py_ssize_t nargs) 
+{
+    STATS_RETURN(self, STAT_SET_UINT, nargs ? args[0] : NULL, 
+                 m_set_typed(self, "set_uint", args, nargs, G_VARIANT_TYPE_UINT32));
+}
+
+static PyObject *m_get_double(DeepinGSettingsObject *self, PyObject *key) 
+{
+    STATS_RETURN(self, STAT_GET_DOUBLE, key, 
+                 m_get_typed(self, key, G_VARIANT_TYPE_DOUBLE));
+}
+
+static PyObject *m_set_double(DeepinGSettingsObject *self, 
+                              PyObject *const *args, 
+                              Py_ssize_t nargs) 
+{
+    STATS_RETURN(self, STAT_SET_DOUBLE, nargs ? args[0] : NULL, 
+                 m_set_typed(self, "set_double", args, nargs, G_VARIANT_TYPE_DOUBLE));
+}
+
+static PyObject *m_get_string(DeepinGSettingsObject *self, PyObject *key) 
+{
+    STATS_RETURN(self, STAT_GET_STRING, key, 
+                 m_get_typed(self, key, G_VARIANT_TYPE_STRING));
+}
+
+static PyObject *m_set_string(DeepinGSettingsObject *self, 
+                              PyObject *const *args, 
+                              Py_ssize_t nargs) 
+{
+    STATS_RETURN(self, STAT_SET_STRING, nargs ? args[0] : NULL, 
+                 m_set_typed(self, "set_string", args, nargs, G_VARIANT_TYPE_STRING));
+}
+
+static PyObject *m_get_strv(DeepinGSettingsObject *self, PyObject *key) 
+{
+    STATS_RETURN(self, STAT_GET_STRV, key, m_get_strv_list(self, key));
+}
+
+static PyObject *m_get_strv_list(DeepinGSettingsObject *self, PyObject *key) 
+{
+    GVariant *value = NULL;
+    PyObject *cached = NULL;
+    PyObject *list = NULL;
+    guint generation = 0;
+
+    /* Lists are mutable, callers always get their own copy */
+    cached = m_cache_lookup(self, key, G_VARIANT_TYPE_STRING_ARRAY, 
+                            &generation);
+    if (cached)
+        return PySequence_List(cached);
+
+    value = m_read_key(self, key, G_VARIANT_TYPE_STRING_ARRAY);
+    if (!value)
+        return NULL;
+
+    /* The cache holds the same interned tuple get_strv_tuple returns */
+    if (!self->value_cache) {
+        list = m_strv_to_object(value, FALSE);
+        g_variant_unref(value);
+        return list;
+    }
+
+    cached = m_cache_store(self, key, G_VARIANT_TYPE_STRING_ARRAY, 
+                           generation, m_strv_to_object(value, TRUE));
+    g_variant_unref(value);
+    if (!cached)
+        return NULL;
+    list = PySequence_List(cached);
+    Py_DECREF(cached);
+    return list;
+}
+
+static PyObject *m_get_strv_tuple(DeepinGSettingsObject *self, PyObject *key) 
+{
+    STATS_RETURN(self, STAT_GET_STRV_TUPLE, key, m_get_strv_interned(self, key));
+}
+
+/* Immutable, so a read cache hit hands out the cached tuple itself */
+static PyObject *m_get_strv_interned(DeepinGSettingsObject *self, PyObject *key) 
+{
+    GVariant *value = NULL;
+    PyObject *cached = NULL;
+    PyObject *tuple = NULL;
+    guint generation = 0;
+
+    /* get_strv shares the cache entry, and stores tuples there too */
+    cached = m_cache_lookup(self, key, G_VARIANT_TYPE_STRING_ARRAY, 
+                            &generation);
+    if (cached) {
+        Py_INCREF(cached);
+        return cached;
+    }
+
+    value = m_read_key(self, key, G_VARIANT_TYPE_STRING_ARRAY);
+    if (!value)
+        return NULL;
+    tuple = m_strv_to_object(value, TRUE);
+    g_variant_unref(value);
+
+    return m_cache_store(self, key, G_VARIANT_TYPE_STRING_ARRAY, generation, 
+                         tuple);
+}
+
+static PyObject *m_set_strv(DeepinGSettingsObject *self, 
+                            PyObject *const *args, 
+                            Py_ssize_t nargs) 
+{
+    PyObject *value = nargs == 2 ? args[1] : NULL;
+
+    /* A lone string or a non-iterable is refused, as non-lists were before */
+    if (value && 
+        (PyUnicode_Check(value) || PyBytes_Check(value) || 
+         (!Py_TYPE(value)->tp_iter && !PySequence_Check(value))))
+        return m_refuse(self, STAT_SET_STRV, args[0]);
+
+    STATS_RETURN(self, STAT_SET_STRV, nargs ? args[0] : NULL, 
+                 m_set_typed(self, "set_strv", args, nargs, 
+                             G_VARIANT_TYPE_STRING_ARRAY));
+}
+
+static CollectionRouter *m_router_ref(CollectionRouter *router) 
+{
+    g_atomic_int_inc(&router->ref_count);
+    return router;
+}
+
+static void m_router_unref(gpointer data, GClosure *closure) 
+{
+    CollectionRouter *router = (CollectionRouter *) data;
+
+    if (!g_atomic_int_dec_and_test(&router->ref_count))
+        return;
+
+    g_free(router->schema_id);
+    g_free(router);
+}
+
+/* GSettings aborts on a malformed path, so they are refused up front */
+static gboolean m_valid_path(const gchar *path) 
+{
+    gsize len = strlen(path);
+
+    return len && path[0] == '/' && path[len - 1] == '/' && 
+           !strstr(path, "//");
+}
+
+/* Calls the handlers whose prefix path starts with, GIL held. The matching 
+ * callbacks are taken first, they may connect or disconnect
+ */
+static void m_route_change(DeepinGSettingsCollectionObject *self, 
+                           const gchar *path, 
+                           const gchar *key) 
+{
+    PathHandler *handler = NULL;
+    PyObject *callbacks = PyList_New(0);
+    PyObject *ret = NULL;
+    Py_ssize_t i;
+
+    for (i = 0; callbacks && self->handlers && i < self->handlers->len; i++) {
+        handler = &g_array_index(self->handlers, PathHandler, i);
+        if (strncmp(path, handler->prefix, handler->prefix_len) == 0 && 
+            PyList_Append(callbacks, handler->callback) < 0)
+            ZAP(callbacks);
+    }
+
+    for (i = 0; callbacks && i < PyList_GET_SIZE(callbacks); i++) {
+        ret = PyObject_CallFunction(PyList_GET_ITEM(callbacks, i), 
+                                    "ss", 
+                                    path, 
+                                    key);
+        if (!ret)
+            PyErr_Print();
+        Py_XDECREF(ret);
+    }
+
+    if (!callbacks)
+        PyErr_Print();
+    Py_XDECREF(callbacks);
+}
+
+static void m_collection_changed_cb(GSettings *settings, 
+                                    gchar *key, 
+                                    gpointer user_data) 
+{
+    CollectionRouter *router = (CollectionRouter *) user_data;
+    DeepinGSettingsCollectionObject *self = NULL;
+    PyGILState_STATE gstate;
+
+    deepin_gsettings_record_change(settings, 
+                                   router->schema_id, 
+                                   g_object_get_data(G_OBJECT(settings), 
+                                                     "deepin-gsettings-path"), 
+                                   key);
+
+    /* Collections without handlers never take the GIL */
+    if (!g_atomic_int_get(&router->n_handlers))
+        return;
+
+    gstate = PyGILState_Ensure();
+    self = (DeepinGSettingsCollectionObject *) router->owner;
+    if (self) {
+        Py_INCREF(self);
+        m_route_change(self, 
+                       g_object_get_data(G_OBJECT(settings), "deepin-gsettings-path"), 
+                       key);
+        Py_DECREF(self);
+    }
+    PyGILState_Release(gstate);
+}
+
+static void m_collection_drop_handle(DeepinGSettingsCollectionObject *self, 
+                                     GSettings *handle) 
+{
+    g_signal_handlers_disconnect_by_func(handle, 
+                                         m_collection_changed_cb, 
+                                         self->router);
+    g_object_unref(handle);
+}
+
+/* New reference to the GSettings of path, created on its first use. 
+ * Unless keep is set a path without one gets a transient GSettings that is 
+ * neither cached nor watched, so bulk reads over many paths leave nothing 
+ * behind
+ */
+static GSettings *m_collection_handle(DeepinGSettingsCollectionObject *self, 
+                                      PyObject *path_obj, 
+                                      gboolean keep) 
+{
+    const char *path = m_object_as_utf8(path_obj);
+    GSettings *handle = NULL;
+    GSettings *other = NULL;
+
+    if (!path)
+        return NULL;
+
+    handle = g_hash_table_lookup(self->handles, path);
+    if (handle)
+        return g_object_ref(handle);
+
+    if (!m_valid_path(path)) {
+        PyErr_Format(PyExc_ValueError, "invalid path '%s'", path);
+        return NULL;
+    }
+
+    handle = m_new_handle(NULL, path, self->schema);
+    if (!handle) {
+        ERROR("g_settings_new_full error");
+        return NULL;
+    }
+    if (!keep)
+        return handle;
+
+    /* m_new_handle may have waited without the GIL */
+    other = g_hash_table_lookup(self->handles, path);
+    if (other) {
+        g_object_unref(handle);
+        return g_object_ref(other);
+    }
+
+    g_object_set_data_full(G_OBJECT(handle), 
+                           "deepin-gsettings-path", 
+                           g_strdup(path), 
+                           g_free);
+    g_signal_connect_data(handle, 
+                          "changed", 
+                          G_CALLBACK(m_collection_changed_cb), 
+                          m_router_ref(self->router), 
+                          m_router_unref, 
+                          (GConnectFlags) 0);
+    g_hash_table_insert(self->handles, g_strdup(path), handle);
+
+    return g_object_ref(handle);
+}
+
+static PyObject *m_collection(PyObject *module, PyObject *args) 
+{
+    ModuleState *state = m_get_state(module);
+    DeepinGSettingsCollectionObject *self = NULL;
+    GSettingsSchemaSource *source = g_settings_schema_source_get_default();
+    GSettingsSchema *schema = NULL;
+    SchemaInfo *info = NULL;
+    gchar *schema_id = NULL;
+
+    if (!PyArg_ParseTuple(args, "s", &schema_id))
+        return NULL;
+
+    schema = source ? 
+        g_settings_schema_source_lookup(source, schema_id, TRUE) : NULL;
+    if (!schema) {
+        PyErr_Format(PyExc_KeyError, "no schema '%s'", schema_id);
+        return NULL;
+    }
+
+    if (g_settings_schema_get_path(schema)) {
+        g_settings_schema_unref(schema);
+        PyErr_Format(PyExc_TypeError, "schema '%s' is not relocatable", schema_id);
+        return NULL;
+    }
+
+    info = m_schema_info(state, schema);
+    if (!info) {
+        g_settings_schema_unref(schema);
+        return NULL;
+    }
+
+    self = PyObject_GC_New(DeepinGSettingsCollectionObject, 
+                           state->collection_type);
+    if (!self) {
+        g_settings_schema_unref(schema);
+        return NULL;
+    }
+
+    self->weakreflist = NULL;
+    Py_INCREF(module);
+    self->module = module;
+    self->schema = schema;
+    self->info = info;
+    self->handles = g_hash_table_new_full(g_str_hash, g_str_equal, g_free, NULL);
+    self->router = g_new0(CollectionRouter, 1);
+    self->router->ref_count = 1;
+    self->router->owner = self;
+    self->router->schema_id = g_strdup(g_settings_schema_get_id(schema));
+    self->handlers = NULL;
+    PyObject_GC_Track(self);
+
+    return (PyObject *) self;
+}
+
+static void m_collection_clear_handlers(DeepinGSettingsCollectionObject *self) 
+{
+    GArray *handlers = self->handlers;
+    PathHandler *handler = NULL;
+    guint i;
+
+    if (!handlers)
+        return;
+
+    self->handlers = NULL;
+    g_atomic_int_set(&self->router->n_handlers, 0);
+    for (i = 0; i < handlers->len; i++) {
+        handler = &g_array_index(handlers, PathHandler, i);
+        g_free(handler->prefix);
+        Py_DECREF(handler->callback);
+    }
+    g_array_free(handlers, TRUE);
+}
+
+static void m_collection_dealloc(DeepinGSettingsCollectionObject *self) 
+{
+    GHashTableIter iter;
+    gpointer value = NULL;
+
+    PyObject_GC_UnTrack(self);
+
+    if (self->weakreflist)
+        PyObject_ClearWeakRefs((PyObject *) self);
+    m_collection_clear_handlers(self);
+
+    self->router->owner = NULL;
+    g_hash_table_iter_init(&iter, self->handles);
+    while (g_hash_table_iter_next(&iter, NULL, &value))
+        m_collection_drop_handle(self, (GSettings *) value);
+    g_hash_table_destroy(self->handles);
+    m_router_unref(self->router, NULL);
+
+    g_settings_schema_unref(self->schema);
+    ZAP(self->module);
+
+    PyObject_GC_Del(self);
+}
+
+static int m_collection_traverse(DeepinGSettingsCollectionObject *self, 
+                                 visitproc visit, 
+                                 void *arg) 
+{
+    guint i;
+
+    Py_VISIT(self->module);
+    for (i = 0; self->handlers && i < self->handlers->len; i++)
+        Py_VISIT(g_array_index(self->handlers, PathHandler, i).callback);
+
+    return 0;
+}
+
+static int m_collection_clear(DeepinGSettingsCollectionObject *self) 
+{
+    m_collection_clear_handlers(self);
+    return 0;
+}
+
+static PyObject *m_collection_get(DeepinGSettingsCollectionObject *self, 
+                                   PyObject *const *args, 
+                                   Py_ssize_t nargs) 
+{
+    const KeyInfo *key_info = NULL;
+    GSettings *handle = NULL;
+    GVariant *value = NULL;
+    PyObject *ret = NULL;
+
+    if (!m_check_nargs("get", nargs, 2))
+        return NULL;
+
+    key_info = m_schema_key(self->info, args[1], NULL);
+    if (!key_info)
+        return NULL;
+
+    handle = m_collection_handle(self, args[0], TRUE);
+    if (!handle)
+        return NULL;
+
+    Py_BEGIN_ALLOW_THREADS
+    value = g_settings_get_value(handle, key_info->c_name);
+    g_object_unref(handle);
+    Py_END_ALLOW_THREADS
+
+    ret = m_variant_to_object(value);
+    g_variant_unref(value);
+
+    return ret;
+}
+
+static PyObject *m_collection_set(DeepinGSettingsCollectionObject *self, 
+                                   PyObject *const *args, 
+                                   Py_ssize_t nargs) 
+{
+    const KeyInfo *key_info = NULL;
+    GSettings *handle = NULL;
+    GVariant *value = NULL;
+    gboolean ret = FALSE;
+
+    if (!m_check_nargs("set", nargs, 3))
+        return NULL;
+
+    key_info = m_schema_key(self->info, args[1], NULL);
+    if (!key_info)
+        return NULL;
+
+    value = m_object_to_variant(args[2], key_info->type);
+    if (!value)
+        return NULL;
+    g_variant_ref_sink(value);
+
+    if (key_info->ranged && 
+        !g_settings_schema_key_range_check(key_info->key, value)) {
+        g_variant_unref(value);
+        Py_INCREF(Py_False);
+        return Py_False;
+    }
+
+    handle = m_collection_handle(self, args[0], TRUE);
+    if (!handle) {
+        g_variant_unref(value);
+        return NULL;
+    }
+
+    /* Collections have no writer, each set is written through at once */
+    Py_BEGIN_ALLOW_THREADS
+    ret = g_settings_set_value(handle, key_info->c_name, value);
+    if (ret)
+        g_settings_sync();
+    g_object_unref(handle);
+    g_variant_unref(value);
+    Py_END_ALLOW_THREADS
+
+    return PyBool_FromLong(ret);
+}
+
+/* The handles are looked up, or created for this call only, first, then 
+ * every value is read in one GIL-released pass
+ */
+static PyObject *m_collection_get_many(DeepinGSettingsCollectionObject *self, 
+                                       PyObject *const *args, 
+                                       Py_ssize_t nargs) 
+{
+    const KeyInfo *key_info = NULL;
+    PyObject *seq = NULL;
+    PyObject *ret = NULL;
+    PyObject *item = NULL;
+    GSettings **handles = NULL;
+    GVariant **values = NULL;
+    Py_ssize_t n = 0;
+    Py_ssize_t i;
+
+    if (!m_check_nargs("get_many", nargs, 2))
+        return NULL;
+
+    key_info = m_schema_key(self->info, args[0], NULL);
+    if (!key_info)
+        return NULL;
+
+    seq = PySequence_Fast(args[1], "get_many paths must be iterable");
+    if (!seq)
+        return NULL;
+    n = PySequence_Fast_GET_SIZE(seq);
+
+    handles = g_new0(GSettings *, n);
+    for (i = 0; i < n; i++) {
+        item = PySequence_Fast_GET_ITEM(seq, i);
+        handles[i] = m_collection_handle(self, item, FALSE);
+        if (!handles[i])
+            goto out;
+    }
+
+    values = g_new0(GVariant *, n);
+    Py_BEGIN_ALLOW_THREADS
+    for (i = 0; i < n; i++)
+        values[i] = g_settings_get_value(handles[i], key_info->c_name);
+    Py_END_ALLOW_THREADS
+
+    ret = PyList_New(n);
+    for (i = 0; ret && i < n; i++) {
+        item = m_variant_to_object(values[i]);
+        if (!item)
+            ZAP(ret);
+        else
+            PyList_SET_ITEM(ret, i, item);
+    }
+
+out:
+    for (i = 0; i < n; i++) {
+        if (handles[i])
+            g_object_unref(handles[i]);
+        if (values && values[i])
+            g_variant_unref(values[i]);
+    }
+    g_free(handles);
+    g_free(values);
+    Py_DECREF(seq);
+
+    return ret;
+}
+
+static PyObject *m_collection_snapshot(DeepinGSettingsCollectionObject *self, 
+                                       PyObject *path) 
+{
+    SchemaInfo *info = self->info;
+    GSettings *handle = NULL;
+    GVariant **values = NULL;
+    PyObject *ret = NULL;
+    PyObject *item = NULL;
+    gsize i;
+
+    handle = m_collection_handle(self, path, FALSE);
+    if (!handle)
+        return NULL;
+
+    values = g_new(GVariant *, info->n_keys);
+    Py_BEGIN_ALLOW_THREADS
+    for (i = 0; i < info->n_keys; i++)
+        values[i] = g_settings_get_value(handle, info->keys[i].c_name);
+    g_object_unref(handle);
+    Py_END_ALLOW_THREADS
+
+    ret = PyDict_New();
+    for (i = 0; ret && i < info->n_keys; i++) {
+        item = m_variant_to_object(values[i]);
+        if (!item || PyDict_SetItem(ret, info->keys[i].name, item) < 0)
+            ZAP(ret);
+        Py_XDECREF(item);
+    }
+
+    for (i = 0; i < info->n_keys; i++)
+        g_variant_unref(values[i]);
+    g_free(values);
+
+    return ret;
+}
+
+static PyObject *m_collection_connect(DeepinGSettingsCollectionObject *self, 
+                                      PyObject *args, 
+                                      PyObject *kwds) 
+{
+    static char *kwlist[] = {"callback", "prefix", NULL};
+    PyObject *callback = NULL;
+    const char *prefix = "";
+    PathHandler handler;
+
+    if (!PyArg_ParseTupleAndKeywords(args, kwds, "O|s", kwlist, 
+                                     &callback, &prefix)) {
+        ERROR("invalid arguments to connect");
+        return NULL;
+    }
+
+    if (!PyCallable_Check(callback)) {
+        Py_INCREF(Py_False);
+        return Py_False;
+    }
+
+    if (!self->handlers)
+        self->handlers = g_array_new(FALSE, FALSE, sizeof(PathHandler));
+    handler.id = ++m_get_state(self->module)->last_handler_id;
+    handler.prefix = g_strdup(prefix);
+    handler.prefix_len = strlen(prefix);
+    handler.callback = callback;
+    Py_INCREF(callback);
+    g_array_append_val(self->handlers, handler);
+    g_atomic_int_inc(&self->router->n_handlers);
 
-static PyMethodDef deepin_gsettings_object_methods[] = 
-{
-    {"delete", m_delete, METH_NOARGS, "Deepin GSettings Object Destruction"}, 
-    {"connect", m_connect, METH_VARARGS, "signal response"}, 
-    {"reset", m_reset, METH_VARARGS, "Resets key to its default value"}, 
-    {"list_keys", m_list_keys, METH_NOARGS, 
-     "Introspects the list of keys on settings"}, 
-    {"get_boolean", m_get_boolean, METH_VARARGS, m_get_value_doc}, 
-    {"set_boolean", m_set_boolean, METH_VARARGS, m_set_value_doc}, 
-    {"get_int", m_get_int, METH_VARARGS, m_get_value_doc}, 
-    {"set_int", m_set_int, METH_VARARGS, m_set_value_doc}, 
-    {"get_uint", m_get_uint, METH_VARARGS, m_get_value_doc}, 
-    {"set_uint", m_set_uint, METH_VARARGS, m_set_value_doc}, 
-    {"get_double", m_get_double, METH_VARARGS, m_get_value_doc}, 
-    {"set_double", m_set_double, METH_VARARGS, m_set_value_doc}, 
-    {"get_string", m_get_string, METH_VARARGS, m_get_value_doc}, 
-    {"set_string", m_set_string, METH_VARARGS, m_set_value_doc}, 
-    {"get_strv", m_get_strv, METH_VARARGS, m_get_value_doc}, 
-    {"set_strv", m_set_strv, METH_VARARGS, m_set_value_doc}, 
-    {NULL, NULL, 0, NULL}
-};
+    return PyLong_FromLong(handler.id);
+}
 
-static void m_deepin_gsettings_dealloc(DeepinGSettingsObject *self) 
+static PyObject *m_collection_disconnect(DeepinGSettingsCollectionObject *self, 
+                                         PyObject *id_obj) 
 {
-    PyObject_GC_UnTrack(self);
-    Py_TRASHCAN_SAFE_BEGIN(self)
+    PathHandler *handler = NULL;
+    PyObject *callback = NULL;
+    long id = PyLong_AsLong(id_obj);
+    guint i;
 
-    ZAP(self->dict);
-    m_delete(self);
+    if (id == -1 && PyErr_Occurred())
+        return NULL;
 
-    PyObject_GC_Del(self);
-    Py_TRASHCAN_SAFE_END(self)
+    for (i = 0; self->handlers && i < self->handlers->len; i++) {
+        handler = &g_array_index(self->handlers, PathHandler, i);
+        if (handler->id != id)
+            continue;
+
+        callback = handler->callback;
+        g_free(handler->prefix);
+        g_array_remove_index(self->handlers, i);
+        g_atomic_int_add(&self->router->n_handlers, -1);
+        Py_DECREF(callback);
+
+        Py_INCREF(Py_True);
+        return Py_True;
+    }
+
+    Py_INCREF(Py_False);
+    return Py_False;
 }
 
-static PyObject *m_getattr(PyObject *co, 
-                           char *name, 
-                           PyObject *dict1, 
-                           PyObject *dict2, 
-                           PyMethodDef *m)
+static PyObject *m_collection_list_keys(DeepinGSettingsCollectionObject *self, 
+                                        PyObject *Py_UNUSED(ignored)) 
 {
-    PyObject *v = NULL;
-    
-    if (dict1)
-        v = PyDict_GetItemString(dict1, name);
-    if (!v && dict2)
-        v = PyDict_GetItemString(dict2, name);
-    if (v) {
-        Py_INCREF(v);
-        return v;
-    }
-    
-    return Py_FindMethod(m, co, name);
+    return PySequence_List(self->info->names);
 }
 
-static int m_setattr(PyObject **dict, char *name, PyObject *v)
+static PyObject *m_collection_paths(DeepinGSettingsCollectionObject *self, 
+                                    PyObject *Py_UNUSED(ignored)) 
 {
-    if (!v) {
-        int rv = -1;
-        if (*dict)
-            rv = PyDict_DelItemString(*dict, name);
-        if (rv < 0) {
-            PyErr_SetString(PyExc_AttributeError, 
-                            "delete non-existing attribute");
-            return rv;
+    GHashTableIter iter;
+    gpointer key = NULL;
+    PyObject *list = PyList_New(0);
+    PyObject *item = NULL;
+
+    if (!list)
+        return NULL;
+
+    g_hash_table_iter_init(&iter, self->handles);
+    while (g_hash_table_iter_next(&iter, &key, NULL)) {
+        item = PyUnicode_FromString((const char *) key);
+        if (!item || PyList_Append(list, item) < 0) {
+            Py_XDECREF(item);
+            Py_DECREF(list);
+            return NULL;
         }
+        Py_DECREF(item);
     }
-    if (!*dict) {
-        *dict = PyDict_New();
-        if (!*dict)
-            return -1;
-    }
-    return PyDict_SetItemString(*dict, name, v);
-}
 
-static PyObject *m_deepin_gsettings_getattr(DeepinGSettingsObject *dgo, 
-                                            char *name) 
-{
-    return m_getattr((PyObject *)dgo, 
-                     name, 
-                     dgo->dict, 
-                     m_deepin_gsettings_object_constants, 
-                     deepin_gsettings_object_methods);
+    return list;
 }
 
-static PyObject *m_deepin_gsettings_setattr(DeepinGSettingsObject *dgo, 
-                                            char *name, 
-                                            PyObject *v) 
+static PyObject *m_collection_discard(DeepinGSettingsCollectionObject *self, 
+                                      PyObject *path_obj) 
 {
-    return m_setattr(&dgo->dict, name, v);
-}
+    const char *path = m_object_as_utf8(path_obj);
+    GSettings *handle = NULL;
 
-static PyObject *m_deepin_gsettings_traverse(DeepinGSettingsObject *self, 
-                                             visitproc visit, 
-                                             void *args) 
-{
-    int err;
-#undef VISIT
-#define VISIT(v)    if ((v) != NULL && ((err = visit(v, args)) != 0)) return err
+    if (!path)
+        return NULL;
 
-    VISIT(self->dict);
+    handle = g_hash_table_lookup(self->handles, path);
+    if (!handle) {
+        Py_INCREF(Py_False);
+        return Py_False;
+    }
 
-    return 0;
-#undef VISIT
+    g_hash_table_remove(self->handles, path);
+    m_collection_drop_handle(self, handle);
+
+    Py_INCREF(Py_True);
+    return Py_True;
 }
 
-static PyObject *m_deepin_gsettings_clear(DeepinGSettingsObject *self) 
+static GroupRouter *m_group_router_ref(GroupRouter *router) 
 {
-    ZAP(self->dict);
-    return 0;
+    g_atomic_int_inc(&router->ref_count);
+    return router;
 }
 
-static PyTypeObject DeepinGSettings_Type = {
-    PyObject_HEAD_INIT(NULL)
-    0, 
-    "deepin_gsettings.new", 
-    sizeof(DeepinGSettingsObject), 
-    0, 
-    (destructor)m_deepin_gsettings_dealloc,
-    0, 
-    (getattrfunc)m_deepin_gsettings_getattr, 
-    (setattrfunc)m_deepin_gsettings_setattr, 
-    0, 
-    0, 
-    0,  
-    0,  
-    0,  
-    0,  
-    0,  
-    0,  
-    0,  
-    0,  
-    Py_TPFLAGS_HAVE_GC,
-    0,  
-    (traverseproc)m_deepin_gsettings_traverse, 
-    (inquiry)m_deepin_gsettings_clear
-};
-
-PyMODINIT_FUNC initdeepin_gsettings() 
+static void m_group_router_unref(gpointer data) 
 {
-    PyObject *m = NULL;
-             
-    m_DeepinGSettings_Type = &DeepinGSettings_Type;
-    DeepinGSettings_Type.ob_type = &PyType_Type;
+    GroupRouter *router = (GroupRouter *) data;
+    guint i;
 
-    m = Py_InitModule("deepin_gsettings", deepin_gsettings_methods);
-    if (!m)
+    if (!g_atomic_int_dec_and_test(&router->ref_count))
         return;
 
-    m_deepin_gsettings_object_constants = PyDict_New();
+    g_mutex_clear(&router->lock);
+    g_array_free(router->changes, TRUE);
+    for (i = 0; i < router->n_members; i++)
+        g_hash_table_destroy(router->seen[i]);
+    g_free(router->seen);
+    g_free(router);
 }
 
-static DeepinGSettingsObject *m_init_deepin_gsettings_object() 
+static void m_group_member_free(gpointer data, GClosure *closure) 
 {
-    DeepinGSettingsObject *self = NULL;
+    GroupMember *member = (GroupMember *) data;
 
-    self = (DeepinGSettingsObject *) PyObject_GC_New(DeepinGSettingsObject, 
-                                                     m_DeepinGSettings_Type);
-    if (!self)
+    m_group_router_unref(member->router);
+    g_free(member);
+}
+
+/* Tuple of the group's callbacks, NULL if none */
+static PyObject *m_group_callbacks(DeepinGSettingsGroupObject *self) 
+{
+    PyObject *callbacks = NULL;
+    PyObject *callback = NULL;
+    guint i;
+
+    if (!self->handlers || !self->handlers->len)
         return NULL;
-    PyObject_GC_Track(self);
 
-    self->dict = NULL;
-    self->handle = NULL;
-    self->changed_cb = NULL;
+    callbacks = PyTuple_New(self->handlers->len);
+    if (!callbacks) {
+        PyErr_Print();
+        return NULL;
+    }
 
-    return self;
+    for (i = 0; i < self->handlers->len; i++) {
+        callback = g_array_index(self->handlers, GroupHandler, i).callback;
+        Py_INCREF(callback);
+        PyTuple_SET_ITEM(callbacks, i, callback);
+    }
+
+    return callbacks;
 }
 
-/* TODO: g_signal_connect work in the g_mainloop thread
- *       and there is also Python looping thread 
- */
-static void m_changed_cb(GSettings *settings, gchar *key, gpointer user_data) 
+static gboolean m_group_deliver_cb(gpointer user_data) 
 {
-    DeepinGSettingsObject *self = (DeepinGSettingsObject *) user_data;
+    GroupRouter *router = (GroupRouter *) user_data;
+    DeepinGSettingsGroupObject *self = NULL;
     PyGILState_STATE gstate;
+    PyObject *callbacks = NULL;
+    PyObject *list = NULL;
+    PyObject *item = NULL;
+    PyObject *ret = NULL;
+    GArray *changes = NULL;
+    GroupChange *change = NULL;
+    gint64 start = 0;
+    Py_ssize_t i;
 
-    if (!self->changed_cb) 
-        return;
-        
-    /* 
-     * TODO: Thanks super _synh_
-     *       Thread mutex lock Python Style 
-     */
+    start = m_stats_begin(router->state);
     gstate = PyGILState_Ensure();
-    PyEval_CallFunction(self->changed_cb, "(s)", key);
+    m_stats_end(router->state, STAT_GIL_WAIT, start);
+
+    g_mutex_lock(&router->lock);
+    changes = router->changes;
+    router->changes = g_array_new(FALSE, FALSE, sizeof(GroupChange));
+    for (i = 0; i < (Py_ssize_t) router->n_members; i++)
+        g_hash_table_remove_all(router->seen[i]);
+    if (router->source == g_main_current_source())
+        m_remove_source(&router->source);
+    g_mutex_unlock(&router->lock);
+
+    self = (DeepinGSettingsGroupObject *) router->owner;
+    callbacks = self ? m_group_callbacks(self) : NULL;
+    if (callbacks) {
+        start = m_stats_begin(router->state);
+        Py_INCREF(self);
+        list = PyList_New(changes->len);
+        for (i = 0; list && i < (Py_ssize_t) changes->len; i++) {
+            change = &g_array_index(changes, GroupChange, i);
+            item = Py_BuildValue("(Os)", 
+                                 PyTuple_GET_ITEM(self->tags, change->member), 
+                                 g_quark_to_string(change->key));
+            if (!item)
+                ZAP(list);
+            else
+                PyList_SET_ITEM(list, i, item);
+        }
+        for (i = 0; list && i < PyTuple_GET_SIZE(callbacks); i++) {
+            ret = PyObject_CallFunctionObjArgs(PyTuple_GET_ITEM(callbacks, i), 
+                                               list, 
+                                               NULL);
+            if (!ret)
+                PyErr_Print();
+            Py_XDECREF(ret);
+        }
+        if (!list)
+            PyErr_Print();
+        Py_XDECREF(list);
+        Py_DECREF(callbacks);
+        Py_DECREF(self);
+        m_stats_end(router->state, STAT_CALLBACK, start);
+    }
+
     PyGILState_Release(gstate);
+    g_array_free(changes, TRUE);
+
+    return FALSE;
 }
 
-static DeepinGSettingsObject *m_new(PyObject *dummy, PyObject *args) 
+/* Router lock held. Nothing is delivered while the group applies, so that 
+ * the changes of all its members reach the handlers in one list. The 
+ * backends hand them to the dispatching context at default priority, 
+ * ahead of the idle delivery scheduled once the apply is over
+ */
+static void m_group_schedule(GroupRouter *router) 
 {
-    DeepinGSettingsObject *self = NULL;
-    gchar *schema_id = NULL;
+    if (router->source || router->held || !router->changes->len)
+        return;
 
-    if (self) 
-        return self;
+    router->source = deepin_gsettings_add_source(0, 
+                                                 m_group_deliver_cb, 
+                                                 m_group_router_ref(router), 
+                                                 m_group_router_unref);
+}
 
-    self = m_init_deepin_gsettings_object();
-    if (!self)
-        return NULL;
+static void m_group_hold(GroupRouter *router, gboolean hold) 
+{
+    g_mutex_lock(&router->lock);
+    router->held += hold ? 1 : -1;
+    m_group_schedule(router);
+    g_mutex_unlock(&router->lock);
+}
 
-    if (!PyArg_ParseTuple(args, "s", &schema_id))
+/* Queues the change and schedules a delivery. Groups without handlers 
+ * never take the lock, let alone the GIL
+ */
+static void m_group_changed_cb(GSettings *settings, 
+                               gchar *key, 
+                               gpointer user_data) 
+{
+    GroupMember *member = (GroupMember *) user_data;
+    GroupRouter *router = member->router;
+    GroupChange change;
+
+    if (!g_atomic_int_get(&router->n_handlers))
+        return;
+
+    change.member = member->member;
+    change.key = g_quark_from_string(key);
+    g_mutex_lock(&router->lock);
+    if (!g_hash_table_contains(router->seen[change.member], 
+                               GUINT_TO_POINTER(change.key))) {
+        g_hash_table_add(router->seen[change.member], 
+                         GUINT_TO_POINTER(change.key));
+        g_array_append_val(router->changes, change);
+    }
+    m_group_schedule(router);
+    g_mutex_unlock(&router->lock);
+}
+
+static PyObject *m_group(PyObject *module, PyObject *members) 
+{
+    ModuleState *state = m_get_state(module);
+    DeepinGSettingsGroupObject *self = NULL;
+    DeepinGSettingsObject *settings = NULL;
+    GSettingsSchemaSource *source = g_settings_schema_source_get_default();
+    GSettingsSchema *schema = NULL;
+    GroupMember *member = NULL;
+    PyObject *seq = NULL;
+    PyObject *tag = NULL;
+    const gchar *schema_id = NULL;
+    const gchar *path = NULL;
+    Py_ssize_t n = 0;
+    Py_ssize_t i;
+
+    seq = PySequence_Fast(members, 
+                          "group takes a list of schema ids or "
+                          "(schema_id, path) pairs");
+    if (!seq)
         return NULL;
+    n = PySequence_Fast_GET_SIZE(seq);
 
-    self->handle = g_settings_new(schema_id);
-    if (!self->handle) {
-        ERROR("g_settings_new error");
-        m_delete(self);
+    self = PyObject_GC_New(DeepinGSettingsGroupObject, state->group_type);
+    if (!self) {
+        Py_DECREF(seq);
         return NULL;
     }
 
-    g_signal_connect(self->handle, "changed", G_CALLBACK(m_changed_cb), self);
+    self->weakreflist = NULL;
+    Py_INCREF(module);
+    self->module = module;
+    self->tags = PyTuple_New(n);
+    self->members = PyTuple_New(n);
+    self->index = PyDict_New();
+    self->handles = g_new0(GSettings *, n);
+    self->changed_ids = g_new0(gulong, n);
+    self->router = g_new0(GroupRouter, 1);
+    self->router->ref_count = 1;
+    self->router->state = state;
+    self->router->owner = self;
+    g_mutex_init(&self->router->lock);
+    self->router->changes = g_array_new(FALSE, FALSE, sizeof(GroupChange));
+    self->router->seen = g_new(GHashTable *, n);
+    for (i = 0; i < n; i++)
+        self->router->seen[i] = g_hash_table_new(NULL, NULL);
+    self->router->n_members = n;
+    self->handlers = NULL;
+    PyObject_GC_Track(self);
 
-    return self;
-}
+    if (!self->tags || !self->members || !self->index)
+        goto fail;
 
-static DeepinGSettingsObject *m_new_with_path(PyObject *dummy, PyObject *args)            
-{                                                                               
-    DeepinGSettingsObject *self = NULL;                                         
-    gchar *schema_id = NULL;
-    gchar *path = NULL;    
+    for (i = 0; i < n; i++) {
+        tag = PySequence_Fast_GET_ITEM(seq, i);
+        path = NULL;
+        if (PyTuple_Check(tag)) {
+            if (!PyArg_ParseTuple(tag, "ss", &schema_id, &path))
+                goto fail;
+        } else {
+            schema_id = m_object_as_utf8(tag);
+            if (!schema_id)
+                goto fail;
+        }
 
-    if (self) 
-        return self;
+        switch (PyDict_Contains(self->index, tag)) {
+        case 1:
+            PyErr_Format(PyExc_ValueError, "'%s' is twice in the group", 
+                         schema_id);
+            /* fall through */
+        case -1:
+            goto fail;
+        }
 
-    self = m_init_deepin_gsettings_object();                                    
-    if (!self)                                                                  
-        return NULL;                                                            
+        /* GSettings aborts on a missing schema */
+        schema = source ? 
+            g_settings_schema_source_lookup(source, schema_id, TRUE) : NULL;
+        if (!schema) {
+            PyErr_Format(PyExc_KeyError, "no schema '%s'", schema_id);
+            goto fail;
+        }
+        g_settings_schema_unref(schema);
+        if (path && !m_valid_path(path)) {
+            PyErr_Format(PyExc_ValueError, "invalid path '%s'", path);
+            goto fail;
+        }
 
-    if (!PyArg_ParseTuple(args, "ss", &schema_id, &path))                               
-        return NULL;                                                            
+        settings = m_new_from_cache(module, schema_id, path, FALSE);
+        if (!settings)
+            goto fail;
+        Py_INCREF(tag);
+        PyTuple_SET_ITEM(self->tags, i, tag);
+        PyTuple_SET_ITEM(self->members, i, (PyObject *) settings);
+        if (PyDict_SetItem(self->index, tag, (PyObject *) settings) < 0)
+            goto fail;
 
-    self->handle = g_settings_new_with_path(schema_id, path);                                   
-    if (!self->handle) {                                                        
-        ERROR("g_settings_new_with_path error");                                          
-        m_delete(self);                                                         
-        return NULL;                                                            
-    }                                                                           
+        member = g_new0(GroupMember, 1);
+        member->router = m_group_router_ref(self->router);
+        member->member = i;
+        self->handles[i] = g_object_ref(settings->handle);
+        self->changed_ids[i] = 
+            g_signal_connect_data(self->handles[i], 
+                                  "changed", 
+                                  G_CALLBACK(m_group_changed_cb), 
+                                  member, 
+                                  m_group_member_free, 
+                                  (GConnectFlags) 0);
+    }
+    Py_DECREF(seq);
 
-    g_signal_connect(self->handle, "changed", G_CALLBACK(m_changed_cb), self);  
+    return (PyObject *) self;
 
-    return self;
+fail:
+    Py_DECREF(seq);
+    Py_DECREF(self);
+    return NULL;
 }
 
-static PyObject *m_delete(DeepinGSettingsObject *self) 
+static void m_group_clear_handlers(DeepinGSettingsGroupObject *self) 
 {
-    if (self->handle) {
-        g_object_unref(self->handle);
-        self->handle = NULL;
-    }
+    GArray *handlers = self->handlers;
+    guint i;
 
-    self->changed_cb = NULL;
+    if (!handlers)
+        return;
 
-    Py_INCREF(Py_None);
-    return Py_None;
+    self->handlers = NULL;
+    g_atomic_int_set(&self->router->n_handlers, 0);
+    for (i = 0; i < handlers->len; i++)
+        Py_DECREF(g_array_index(handlers, GroupHandler, i).callback);
+    g_array_free(handlers, TRUE);
 }
 
-static PyObject *m_connect(DeepinGSettingsObject *self, PyObject *args) 
+static void m_group_dealloc(DeepinGSettingsGroupObject *self) 
 {
-    gchar *name = NULL;
-    PyObject *fptr = NULL;
+    Py_ssize_t n = self->members ? PyTuple_GET_SIZE(self->members) : 0;
+    Py_ssize_t i;
 
-    if (!PyArg_ParseTuple(args, "sO:set_callback", &name, &fptr)) { 
-        ERROR("invalid arguments to connect");
-        return NULL;
-    }
+    PyObject_GC_UnTrack(self);
 
-    if (!PyCallable_Check(fptr)) {
-        Py_INCREF(Py_False);
-        return Py_False;
-    }
-    
-    if (strcmp(name, "changed") == 0) { 
-        Py_XINCREF(fptr);
-        Py_XDECREF(self->changed_cb);
-        self->changed_cb = fptr;
+    if (self->weakreflist)
+        PyObject_ClearWeakRefs((PyObject *) self);
+    m_group_clear_handlers(self);
+
+    self->router->owner = NULL;
+    g_mutex_lock(&self->router->lock);
+    m_remove_source(&self->router->source);
+    g_mutex_unlock(&self->router->lock);
+    for (i = 0; i < n; i++) {
+        if (!self->handles[i])
+            continue;
+        g_signal_handler_disconnect(self->handles[i], self->changed_ids[i]);
+        g_object_unref(self->handles[i]);
     }
+    g_free(self->handles);
+    g_free(self->changed_ids);
+    m_group_router_unref(self->router);
 
-    Py_INCREF(Py_True);
-    return Py_True;
+    ZAP(self->tags);
+    ZAP(self->members);
+    ZAP(self->index);
+    ZAP(self->module);
+
+    PyObject_GC_Del(self);
 }
 
-static PyObject *m_reset(DeepinGSettingsObject *self, PyObject *args) 
+static int m_group_traverse(DeepinGSettingsGroupObject *self, 
+                            visitproc visit, 
+                            void *arg) 
 {
-    gchar *key = NULL;
-
-    if (!PyArg_ParseTuple(args, "s", &key)) {                                   
-        Py_INCREF(Py_False);                                                    
-        return Py_False;                                                        
-    }
+    guint i;
 
-    g_settings_reset(self->handle, key);
+    Py_VISIT(self->module);
+    Py_VISIT(self->tags);
+    Py_VISIT(self->members);
+    Py_VISIT(self->index);
+    for (i = 0; self->handlers && i < self->handlers->len; i++)
+        Py_VISIT(g_array_index(self->handlers, GroupHandler, i).callback);
 
-    Py_INCREF(Py_True);                                                         
-    return Py_True;        
+    return 0;
 }
 
-static PyObject *m_list_keys(DeepinGSettingsObject *self) 
+static int m_group_clear(DeepinGSettingsGroupObject *self) 
 {
-    gchar** keys = g_settings_list_keys(self->handle);
-    int len = g_strv_length(keys);
-    PyObject* list = PyList_New(len);
-    int i=0;
-    for (; i<len; i++) {
-        PyList_SetItem(list, i, PyString_FromString(keys[i]));
-    }
-    g_strfreev(keys);
-    return list;
+    m_group_clear_handlers(self);
+    return 0;
 }
 
-/* TIP: Please do not directly return Py_True, call Py_INCREF(Py_True) at first
- *      Python GC will free Py_True when reference counting is 0
- */
-static PyObject *m_get_boolean(DeepinGSettingsObject *self, PyObject *args) 
+#define GROUP_MEMBER(self, i) \
+    ((DeepinGSettingsObject *) PyTuple_GET_ITEM((self)->members, (i)))
+
+/* Begins a batch on every member, or on none when one of them fails */
+static gboolean m_group_begin(DeepinGSettingsGroupObject *self) 
 {
-    gchar *key = NULL;
+    Py_ssize_t n = PyTuple_GET_SIZE(self->members);
+    Py_ssize_t i;
 
-    if (!PyArg_ParseTuple(args, "s", &key)) {
-        Py_INCREF(Py_False);
-        return Py_False;
+    for (i = 0; i < n; i++) {
+        if (!m_begin_batch(GROUP_MEMBER(self, i)))
+            break;
     }
+    if (i == n)
+        return TRUE;
 
-    if (!g_settings_get_boolean(self->handle, key)) {
-        Py_INCREF(Py_False);
-        return Py_False;
-    }
+    while (i--)
+        m_close_batch(GROUP_MEMBER(self, i), FALSE);
 
-    Py_INCREF(Py_True);
-    return Py_True;
+    return FALSE;
 }
 
-/* TODO: When set_XXX, it need to check the variable data type, for example, 
- *       PyBool_Check()
+/* Ends the batch of every member. The outermost ones are applied in one 
+ * pass and synced once, whatever the members' sync policies, and a failure 
+ * in any member reverts them all
  */
-static PyObject *m_set_boolean(DeepinGSettingsObject *self, PyObject *args) 
+static gboolean m_group_end(DeepinGSettingsGroupObject *self, gboolean commit) 
 {
-    gchar *key = NULL;
-    PyObject *value = NULL;
+    Py_ssize_t n = PyTuple_GET_SIZE(self->members);
+    DeepinGSettingsObject *settings = NULL;
+    GSettings **handles = g_new0(GSettings *, n);
+    guint n_handles = 0;
+    Py_ssize_t i;
 
-    if (!PyArg_ParseTuple(args, "sO", &key, &value)) {
-        Py_INCREF(Py_False);
-        return Py_False;
+    for (i = 0; i < n; i++) {
+        settings = GROUP_MEMBER(self, i);
+        if (settings->batch_depth && settings->batch_failed)
+            commit = FALSE;
     }
 
-    if (!PyBool_Check(value)) {
-        Py_INCREF(Py_False);
-        return Py_False;
+    /* A member deleted meanwhile has lost its batch */
+    for (i = 0; i < n; i++) {
+        settings = GROUP_MEMBER(self, i);
+        if (!settings->batch_depth)
+            continue;
+        handles[n_handles] = m_close_batch(settings, commit);
+        if (handles[n_handles])
+            n_handles++;
     }
-    
-    if (value == Py_True) 
-        g_settings_set_boolean(self->handle, key, 1);
-    else
-        g_settings_set_boolean(self->handle, key, 0);
-    g_settings_sync();
-
-    Py_INCREF(Py_True);
-    return Py_True;
-}
 
-static PyObject *m_get_int(DeepinGSettingsObject *self, PyObject *args) 
-{
-    gchar *key = NULL;
-
-    if (!PyArg_ParseTuple(args, "s", &key)) {
-        ERROR("invalid arguments to get_int");
-        return NULL;
+    if (n_handles) {
+        m_group_hold(self->router, TRUE);
+        m_apply_batches(m_get_state(self->module), handles, n_handles, TRUE);
+        m_group_hold(self->router, FALSE);
     }
-    
-    return INT(g_settings_get_int(self->handle, key));
+    g_free(handles);
+
+    return commit;
 }
 
-static PyObject *m_set_int(DeepinGSettingsObject *self, PyObject *args) 
+static PyObject *m_group_enter(DeepinGSettingsGroupObject *self, 
+                               PyObject *Py_UNUSED(ignored)) 
 {
-    gchar *key = NULL;
-    gint value = -1;
-
-    if (!PyArg_ParseTuple(args, "si", &key, &value)) { 
-        ERROR("invalid arguments to set_int");
+    if (!m_group_begin(self))
         return NULL;
-    }
 
-    if (!g_settings_set_int(self->handle, key, value)) { 
-        Py_INCREF(Py_False);
-        return Py_False;
-    }
-    g_settings_sync();
-    
-    Py_INCREF(Py_True);
-    return Py_True;
+    Py_INCREF(self);
+    return (PyObject *) self;
 }
 
-static PyObject *m_get_uint(DeepinGSettingsObject *self, PyObject *args) 
+static PyObject *m_group_exit(DeepinGSettingsGroupObject *self, 
+                              PyObject *args) 
 {
-    gchar *key = NULL;
+    PyObject *exc_type = NULL;
+    PyObject *exc_value = NULL;
+    PyObject *traceback = NULL;
 
-    if (!PyArg_ParseTuple(args, "s", &key)) 
-        return INT(0);
+    if (!PyArg_ParseTuple(args, "OOO", &exc_type, &exc_value, &traceback)) {
+        ERROR("invalid arguments to __exit__");
+        return NULL;
+    }
 
-    if (!self->handle)
-        return INT(0);
+    m_group_end(self, exc_type == Py_None);
 
-    return INT(g_settings_get_uint(self->handle, key));
+    /* Never swallow the exception that caused the revert */
+    Py_INCREF(Py_False);
+    return Py_False;
 }
 
-static PyObject *m_set_uint(DeepinGSettingsObject *self, PyObject *args) 
+static PyObject *m_group_apply(DeepinGSettingsGroupObject *self, 
+                               PyObject *changes) 
 {
-    gchar *key = NULL;
-    unsigned int value = 0;
+    DeepinGSettingsObject *settings = NULL;
+    const KeyInfo *key_info = NULL;
+    GVariant *variant = NULL;
+    PyObject *tag = NULL;
+    PyObject *values = NULL;
+    PyObject *key = NULL;
+    PyObject *value = NULL;
+    Py_ssize_t pos = 0;
+    Py_ssize_t key_pos = 0;
+    gboolean written = TRUE;
 
-    if (!PyArg_ParseTuple(args, "sI", &key, &value)) { 
-        ERROR("invalid arguments to set_uint");
+    if (!PyDict_Check(changes)) {
+        ERROR("apply takes a dict of tag to a dict of key to value");
         return NULL;
     }
 
-    if (!g_settings_set_uint(self->handle, key, value)) { 
-        Py_INCREF(Py_False);
-        return Py_False;
-    }
-    g_settings_sync();
-    
-    Py_INCREF(Py_True);
-    return Py_True;
-}
+    if (!m_group_begin(self))
+        return NULL;
 
-static PyObject *m_get_double(DeepinGSettingsObject *self, PyObject *args) 
-{
-    gchar *key = NULL;
+    while (written && PyDict_Next(changes, &pos, &tag, &values)) {
+        settings = (DeepinGSettingsObject *) 
+            PyDict_GetItemWithError(self->index, tag);
+        if (!settings) {
+            if (!PyErr_Occurred())
+                PyErr_SetObject(PyExc_KeyError, tag);
+            goto fail;
+        }
+        if (!PyDict_Check(values)) {
+            ERROR("apply takes a dict of tag to a dict of key to value");
+            goto fail;
+        }
 
-    if (!PyArg_ParseTuple(args, "s", &key)) {
-        ERROR("invalid arguments to get_double");
-        return NULL;
+        key_pos = 0;
+        while (written && PyDict_Next(values, &key_pos, &key, &value)) {
+            key_info = m_key_info(settings, key, NULL);
+            if (!key_info)
+                goto fail;
+            variant = m_object_to_variant(value, key_info->type);
+            if (!variant)
+                goto fail;
+            written = m_write_value(settings, key_info, variant);
+        }
     }
 
-    return DOUBLE(g_settings_get_double(self->handle, key));
+    return PyBool_FromLong(m_group_end(self, written));
+
+fail:
+    m_group_end(self, FALSE);
+    return NULL;
 }
 
-static PyObject *m_set_double(DeepinGSettingsObject *self, PyObject *args) 
+/* Every key of every member, read in one pass without the GIL. Inside a 
+ * batch the values written so far are seen
+ */
+static PyObject *m_group_snapshot(DeepinGSettingsGroupObject *self, 
+                                  PyObject *Py_UNUSED(ignored)) 
 {
-    gchar *key = NULL;
-    gdouble value = 0.0;
+    Py_ssize_t n = PyTuple_GET_SIZE(self->members);
+    DeepinGSettingsObject *settings = NULL;
+    SchemaInfo *info = NULL;
+    GSettings **handles = g_new0(GSettings *, n);
+    GVariant **values = NULL;
+    PyObject *ret = NULL;
+    PyObject *keys = NULL;
+    PyObject *item = NULL;
+    gsize n_values = 0;
+    gsize offset = 0;
+    gsize j;
+    Py_ssize_t i;
 
-    if (!PyArg_ParseTuple(args, "sd", &key, &value)) { 
-        ERROR("invalid arguments to set_double");
-        return NULL;
+    for (i = 0; i < n; i++) {
+        settings = GROUP_MEMBER(self, i);
+        if (!settings->entry) {
+            ERROR("snapshot of a group with a deleted member");
+            goto out;
+        }
+        handles[i] = m_ref_handle(m_read_handle(settings));
+        n_values += settings->entry->info->n_keys;
     }
 
-    if (!g_settings_set_double(self->handle, key, value)) { 
-        Py_INCREF(Py_False);
-        return Py_False;
+    values = g_new(GVariant *, n_values);
+    Py_BEGIN_ALLOW_THREADS
+    for (i = 0; i < n; i++) {
+        info = GROUP_MEMBER(self, i)->entry->info;
+        for (j = 0; j < info->n_keys; j++)
+            values[offset++] = g_settings_get_value(handles[i], 
+                                                    info->keys[j].c_name);
     }
-    g_settings_sync();
+    Py_END_ALLOW_THREADS
 
-    Py_INCREF(Py_True);
-    return Py_True;
-}
+    ret = PyDict_New();
+    for (i = 0, offset = 0; ret && i < n; i++) {
+        info = GROUP_MEMBER(self, i)->entry->info;
+        keys = PyDict_New();
+        for (j = 0; keys && j < info->n_keys; j++) {
+            item = m_variant_to_object(values[offset + j]);
+            if (!item || PyDict_SetItem(keys, info->keys[j].name, item) < 0)
+                ZAP(keys);
+            Py_XDECREF(item);
+        }
+        offset += info->n_keys;
+        if (!keys || 
+            PyDict_SetItem(ret, PyTuple_GET_ITEM(self->tags, i), keys) < 0)
+            ZAP(ret);
+        Py_XDECREF(keys);
+    }
 
-static PyObject *m_get_string(DeepinGSettingsObject *self, PyObject *args) 
-{
-    gchar *key = NULL;
+    for (j = 0; j < n_values; j++)
+        g_variant_unref(values[j]);
+    g_free(values);
 
-    if (!PyArg_ParseTuple(args, "s", &key)) { 
-        ERROR("invalid arguments to get_string");
-        return NULL;
+out:
+    for (i = 0; i < n; i++) {
+        if (handles[i])
+            g_object_unref(handles[i]);
     }
+    g_free(handles);
 
-    gchar* str = g_settings_get_string(self->handle, key);
-    PyObject* ret = PyString_FromString(str);
-    g_free(str);
     return ret;
 }
 
-static PyObject *m_set_string(DeepinGSettingsObject *self, PyObject *args) 
+static PyObject *m_group_member(DeepinGSettingsGroupObject *self, 
+                                PyObject *tag) 
 {
-    gchar *key = NULL;
-    gchar *value = NULL;
+    PyObject *settings = PyDict_GetItemWithError(self->index, tag);
 
-    if (!PyArg_ParseTuple(args, "ss", &key, &value)) { 
-        ERROR("invalid arguments to set_string");
+    if (!settings) {
+        if (!PyErr_Occurred())
+            PyErr_SetObject(PyExc_KeyError, tag);
         return NULL;
     }
 
-    if (!g_settings_set_string(self->handle, key, value)) { 
-        Py_INCREF(Py_False);
-        return Py_False;
-    }
-    g_settings_sync();
+    Py_INCREF(settings);
+    return settings;
+}
 
-    Py_INCREF(Py_True);
-    return Py_True;
+static PyObject *m_group_tags(DeepinGSettingsGroupObject *self, 
+                              PyObject *Py_UNUSED(ignored)) 
+{
+    return PySequence_List(self->tags);
 }
 
-static PyObject *m_get_strv(DeepinGSettingsObject *self, PyObject *args) 
+static PyObject *m_group_connect(DeepinGSettingsGroupObject *self, 
+                                 PyObject *callback) 
 {
-    char* key = NULL;
-    if (!PyArg_ParseTuple(args, "s", &key)) { 
-        ERROR("invalid arguments to get_strv");
-        return NULL;
-    }
+    GroupHandler handler;
 
-    gchar** strv = g_settings_get_strv(self->handle, key);
-    int len = g_strv_length(strv);
-    PyObject *list = PyList_New(len);
-    int i=0;
-    for (; i<len; i++) {
-        PyList_SetItem(list, i, PyString_FromString(strv[i]));
+    if (!PyCallable_Check(callback)) {
+        Py_INCREF(Py_False);
+        return Py_False;
     }
-    g_strfreev(strv);
-    return list;
+
+    if (!self->handlers)
+        self->handlers = g_array_new(FALSE, FALSE, sizeof(GroupHandler));
+    handler.id = ++m_get_state(self->module)->last_handler_id;
+    handler.callback = callback;
+    Py_INCREF(callback);
+    g_array_append_val(self->handlers, handler);
+    g_atomic_int_inc(&self->router->n_handlers);
+
+    return PyLong_FromLong(handler.id);
 }
 
-static PyObject *m_set_strv(DeepinGSettingsObject *self, PyObject *args) 
+static PyObject *m_group_disconnect(DeepinGSettingsGroupObject *self, 
+                                    PyObject *id_obj) 
 {
-    gchar *key = NULL;
-    PyObject *value = NULL;
-    char *item_str = NULL;
-    int item_length = 0;
-    gchar **strv;
-    gsize length = 0;
-    int i;
+    PyObject *callback = NULL;
+    long id = PyLong_AsLong(id_obj);
+    guint i;
 
-    if (!PyArg_ParseTuple(args, "sO", &key, &value)) {
-        ERROR("invalid arguments to set_strv");
+    if (id == -1 && PyErr_Occurred())
         return NULL;
-    }
-    
-    if (!PyList_Check(value)) {
-        Py_INCREF(Py_False);
-        return Py_False;
-    }
-    
-    length = PyList_Size(value);
-    /* TODO: Allocation length + 1 for GSettings gchar** array 
-     *       Because there is no length argv any more 
-     */
-    strv = malloc((length + 1) * sizeof(gchar *));
-    if (!strv) {
-        Py_INCREF(Py_False);
-        return Py_False;
-    }
-    memset(strv, 0, (length + 1) * sizeof(gchar *));
-    
-    for (i = 0; i < length; i++) { 
-        item_str = PyString_AsString(PyList_GetItem(value, i));
-        item_length = (strlen(item_str) + 1) * sizeof(gchar);
-        strv[i] = malloc(item_length);
-        if (!strv[i]) { 
-            Py_INCREF(Py_False);
-            return Py_False;
-        }
-        memset(strv[i], 0, item_length);
-        strcpy(strv[i], item_str);
-    }
-    /* TODO: Tell GSettings the gchar** array size */
-    strv[length] = NULL;
 
-    if (!g_settings_set_strv(self->handle, key, strv)) {
-        g_strfreev(strv);
-        Py_INCREF(Py_False);
-        return Py_False;
-    }
-    g_settings_sync();
+    for (i = 0; self->handlers && i < self->handlers->len; i++) {
+        if (g_array_index(self->handlers, GroupHandler, i).id != id)
+            continue;
 
-    g_strfreev(strv);
+        callback = g_array_index(self->handlers, GroupHandler, i).callback;
+        g_array_remove_index(self->handlers, i);
+        g_atomic_int_add(&self->router->n_handlers, -1);
+        Py_DECREF(callback);
 
-    Py_INCREF(Py_True);
-    return Py_True;
+        Py_INCREF(Py_True);
+        return Py_True;
+    }
+
+    Py_INCREF(Py_False);
+    return Py_False;
 }
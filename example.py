@@ -1,4 +1,4 @@
-#! /usr/bin/env python
+#! /usr/bin/env python3
 # -*- coding: utf-8 -*-
 
 # Copyright (C) 2012 Deepin, Inc.
@@ -65,7 +65,7 @@ class DeepinGSettings:
         return self.handle.set_strv(key, value)
 
 def m_changed(key):
-    print "DEBUG changed", key
+    print("DEBUG changed", key)
 
 deepin_gsettings_instance1 = DeepinGSettings("org.gnome.settings-daemon.plugins.power")
 deepin_gsettings_instance1.connect("changed", m_changed)
@@ -75,22 +75,22 @@ dg3 = DeepinGSettings("org.gnome.system.locale")
 dg4 = DeepinGSettings("org.gnome.settings-daemon.peripherals.mouse")
 
 def test():
-    print "list_keys", dg3.list_keys()
-    print "get_int", dg4.get_int("motion-threshold")
-    print "list_keys", deepin_gsettings_instance1.list_keys()
-    print "get_boolean active", deepin_gsettings_instance1.get_boolean("active")
-    print "set_boolean idle-dim-battery", deepin_gsettings_instance1.set_boolean("idle-dim-battery", True)
-    print "get_int idle-brightness", deepin_gsettings_instance1.get_int("idle-brightness")
-    print "set_int idle-brightness", deepin_gsettings_instance1.set_int("idle-brightness", 31)
-    print "get_strv layouts", deepin_gsettings_instance2.get_strv("options")
-    print "reset layouts", deepin_gsettings_instance2.reset("options")
+    print("list_keys", dg3.list_keys())
+    print("get_int", dg4.get_int("motion-threshold"))
+    print("list_keys", deepin_gsettings_instance1.list_keys())
+    print("get_boolean active", deepin_gsettings_instance1.get_boolean("active"))
+    print("set_boolean idle-dim-battery", deepin_gsettings_instance1.set_boolean("idle-dim-battery", True))
+    print("get_int idle-brightness", deepin_gsettings_instance1.get_int("idle-brightness"))
+    print("set_int idle-brightness", deepin_gsettings_instance1.set_int("idle-brightness", 31))
+    print("get_strv layouts", deepin_gsettings_instance2.get_strv("options"))
+    print("reset layouts", deepin_gsettings_instance2.reset("options"))
 
 test()
 
 '''
 i = 0
 while i < 1000:
-    print "DEBUG %d times" % (i + 1)
+    print("DEBUG %d times" % (i + 1))
     test()
 
     i += 1
@@ -1,17 +1,25 @@
 #include <gtk/gtk.h>
 #include <gio/gio.h>
 
-static GSettings *m_settings = NULL;
+#include "deepin_gsettings.h"
+
+/* A drag writes the last value at most this often */
+#define FLUSH_INTERVAL 100
+
+static DeepinGSettings *m_settings = NULL;
 static GtkAdjustment *m_adjust = NULL;
 
-static void m_settings_changed(GSettings *settings, 
-                               gchar *key, 
+static void m_settings_changed(DeepinGSettings *settings, 
+                               const gchar *const *keys, 
+                               guint n_keys, 
                                gpointer user_data) 
 {
-    double value = g_settings_get_double(settings, "brightness");
+    double value = deepin_gsettings_get_double(settings, "brightness");
+    guint i;
 
     printf("%s\n", (gchar*) user_data);
-    printf("DEBUG %s key changed\n", key);
+    for (i = 0; i < n_keys; i++)
+        printf("DEBUG %s key changed\n", keys[i]);
     printf("DEBUG changed value %f\n", value);
 }
 
@@ -21,8 +29,7 @@ static void m_value_changed(GtkAdjustment *adjust, gpointer user_data)
 
     printf("%s\n", (gchar*) user_data);
     printf("DEBUG value %f\n", value);
-    g_settings_set_double(m_settings, "brightness", value / 100.0);
-    g_settings_sync();
+    deepin_gsettings_set_double(m_settings, "brightness", value / 100.0);
 }
 
 int main(int argc, char **argv)
@@ -33,11 +40,17 @@ int main(int argc, char **argv)
     g_type_init();
     gtk_init(&argc, &argv);
 
-    m_settings = g_settings_new("org.gnome.settings-daemon.plugins.xrandr");
-    g_signal_connect(m_settings, 
-                     "changed", 
-                     m_settings_changed, 
-                     "DEBUG GSettings changed signal");
+    m_settings = deepin_gsettings_get("org.gnome.settings-daemon.plugins.xrandr", 
+                                      NULL);
+    deepin_gsettings_set_sync_policy(m_settings, 
+                                     DEEPIN_GSETTINGS_SYNC_DEFERRED, 
+                                     FLUSH_INTERVAL);
+    deepin_gsettings_set_read_cache(m_settings, TRUE);
+    deepin_gsettings_connect_changes(m_settings, 
+                                     0, 
+                                     m_settings_changed, 
+                                     "DEBUG GSettings changed signal", 
+                                     NULL);
 
     window = gtk_window_new(GTK_WINDOW_TOPLEVEL);
     gtk_window_set_title(GTK_WINDOW(window), "GSettings Demo");
@@ -60,7 +73,7 @@ int main(int argc, char **argv)
     gtk_main();
 
     if (m_settings) {
-        g_object_unref(m_settings);
+        deepin_gsettings_release(m_settings);
         m_settings = NULL;
     }
 
@@ -1,16 +1,19 @@
-#! /usr/bin/env python
+#! /usr/bin/env python3
 
 from setuptools import setup, Extension
 import os
-import commands
+import subprocess
 
 def pkg_config_cflags(pkgs):
     '''List all include paths that output by `pkg-config --cflags pkgs`'''
-    return map(lambda path: path[2::], commands.getoutput('pkg-config --cflags-only-I %s' % (' '.join(pkgs))).split())
+    output = subprocess.check_output(['pkg-config', '--cflags-only-I'] + pkgs)
+    return [path[2::] for path in output.decode().split()]
 
+# The binding wraps libdeepin-gsettings, built and installed by scons
 deepin_gsettings_mod = Extension('deepin_gsettings', 
-                include_dirs = pkg_config_cflags(['gio-2.0']),
-                libraries = ['gio-2.0'],
+                include_dirs = ['.'] + pkg_config_cflags(['gio-2.0']),
+                library_dirs = ['.'],
+                libraries = ['deepin-gsettings', 'gio-2.0'],
                 sources = ['deepin_gsettings_python.c'])
 
 setup(name='deepin_gsettings',